@@ -235,11 +235,17 @@ class BaseTransactionCircuit : public GadgetT
     std::map<TxVariable, VariableT> uOutputs;
     std::map<TxVariable, VariableArrayT> aOutputs;
 
+    // The number of variables before the variables of this circuit were allocated
+    const size_t variablesBegin;
+    // The constraints of this circuit, set when its constraints are generated
+    size_t constraintsBegin = 0;
+    size_t constraintsEnd = 0;
+
     BaseTransactionCircuit( //
       ProtoboardT &pb,
       const TransactionState &_state,
       const std::string &prefix)
-        : GadgetT(pb, prefix), state(_state)
+        : GadgetT(pb, prefix), state(_state), variablesBegin(pb.num_variables())
     {
         aOutputs[TXV_STORAGE_A_ADDRESS] = VariableArrayT(NUM_BITS_STORAGE_ADDRESS, state.constants._0);
         uOutputs[TXV_STORAGE_A_DATA] = state.accountA.storage.data;
@@ -6,6 +6,8 @@
 #include "ethsnarks.hpp"
 #include "../Utils/Data.h"
 
+#include <istream>
+
 using namespace ethsnarks;
 
 namespace Loopring
@@ -21,10 +23,33 @@ class Circuit : public GadgetT
     virtual ~Circuit(){};
     virtual void generateConstraints(unsigned int blockSize) = 0;
     virtual bool generateWitness(const json &input) = 0;
+    // Generates the witness for a block that still needs to be read
+    virtual bool generateWitness(std::istream &stream)
+    {
+        json input;
+        stream >> input;
+        return generateWitness(input);
+    }
     virtual unsigned int getBlockType() = 0;
     virtual unsigned int getBlockSize() = 0;
     virtual void printInfo() = 0;
 
+    // Optionally reuses the witness of the parts of the circuit that are not used by a transaction
+    virtual void enableWitnessTemplates(){};
+
+    // Where constraint `index` comes from (e.g. the transaction), used to explain why a witness is invalid
+    virtual std::string describeConstraint(size_t index)
+    {
+        return "";
+    }
+
+    // The messages that need to be signed for the witness to be valid.
+    // Only available after the witness is generated, the messages are calculated in the circuit.
+    virtual std::vector<SignatureRequest> getSignatureRequests()
+    {
+        return {};
+    }
+
     libsnark::protoboard<FieldT> &getPb()
     {
         return pb;
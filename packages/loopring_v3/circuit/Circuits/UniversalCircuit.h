@@ -7,6 +7,11 @@
 #include "../Utils/Constants.h"
 #include "../Utils/Data.h"
 #include "../Utils/Utils.h"
+#include "../Utils/BlockReader.h"
+#include "../Utils/BoundedQueue.h"
+#include "../Utils/ThreadPool.h"
+#include "../Utils/Trace.h"
+#include "../Utils/WitnessTemplates.h"
 #include "../Gadgets/MatchingGadgets.h"
 #include "../Gadgets/AccountGadgets.h"
 #include "../Gadgets/StorageGadgets.h"
@@ -27,6 +32,10 @@
 #include "utils.hpp"
 #include "gadgets/subadd.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 using namespace ethsnarks;
 
 // Naming conventions:
@@ -39,6 +48,12 @@ using namespace ethsnarks;
 namespace Loopring
 {
 
+// Witness templates of the transaction circuits, shared by all transaction slots
+struct TransactionWitnessTemplates
+{
+    WitnessTemplateCache caches[(unsigned int)TransactionType::COUNT];
+};
+
 class SelectTransactionGadget : public BaseTransactionCircuit
 {
   public:
@@ -198,6 +213,15 @@ class TransactionGadget : public GadgetT
     UpdateBalanceGadget updateBalanceB_P;
     UpdateBalanceGadget updateBalanceA_P;
 
+    // The transaction circuits by TransactionType
+    std::vector<BaseTransactionCircuit *> circuits;
+    // Used for the inactive transaction circuits when set
+    TransactionWitnessTemplates *templates;
+    std::vector<WitnessTemplateLayout> templateLayouts;
+    // The constraints of this transaction slot, set when its constraints are generated
+    size_t constraintsBegin = 0;
+    size_t constraintsEnd = 0;
+
     TransactionGadget(
       ProtoboardT &pb,
       const jubjub::Params &params,
@@ -412,12 +436,171 @@ class TransactionGadget : public GadgetT
             tx.getArrayOutput(TXV_BALANCE_A_B_ADDRESS),
             {state.pool.balanceA.balance, state.pool.balanceA.weightAMM, state.pool.balanceA.storageRoot},
             {tx.getOutput(TXV_BALANCE_P_A_BALANCE), state.pool.balanceA.weightAMM, state.pool.balanceA.storageRoot},
-            FMT(prefix, ".updateBalanceA_P"))
+            FMT(prefix, ".updateBalanceA_P")),
 
+          circuits(
+            {&noop,
+             &deposit,
+             &withdraw,
+             &transfer,
+             &spotTrade,
+             &accountUpdate,
+             &ammUpdate,
+             &signatureVerification,
+             &nftMint,
+             &nftData}),
+          templates(nullptr)
     {
     }
 
     void generate_r1cs_witness(const UniversalTransaction &uTx)
+    {
+        generateInputsWitness(uTx);
+
+        for (unsigned int t = 0; t < circuits.size(); t++)
+        {
+            generateCircuitWitness(t, uTx);
+        }
+        tx.generate_r1cs_witness();
+
+        generateValidationWitness();
+
+        // Check signatures
+        signatureVerifierA.generate_r1cs_witness(uTx.witness.signatureA);
+        signatureVerifierB.generate_r1cs_witness(uTx.witness.signatureB);
+
+        generateUserAWitness(uTx.witness);
+        generateUserBWitness(uTx.witness);
+        generateOperatorWitness(uTx.witness);
+        generateProtocolPoolWitness(uTx.witness);
+    }
+
+    // Same as `generate_r1cs_witness`, but runs the independent stages as tasks of `job`:
+    // inputs -> transactions (parallel) -> select -> {validation, signatures, updates} (parallel).
+    // The Merkle updates of the different accounts only depend on the leaf values, not on each
+    // other's roots. The tasks are waited on before returning, so everything can be shared.
+    void generate_r1cs_witness_tasks(const UniversalTransaction &uTx, ThreadPool::Job &job)
+    {
+        generateInputsWitness(uTx);
+
+        {
+            ThreadPool::TaskGroup group(job);
+            for (unsigned int t = 0; t < circuits.size(); t++)
+            {
+                group.run([this, t, &uTx]() { generateCircuitWitness(t, uTx); });
+            }
+            group.wait();
+        }
+        tx.generate_r1cs_witness();
+
+        ThreadPool::TaskGroup group(job);
+        group.run([this]() { generateValidationWitness(); });
+        group.run([this, &uTx]() { signatureVerifierA.generate_r1cs_witness(uTx.witness.signatureA); });
+        group.run([this, &uTx]() { signatureVerifierB.generate_r1cs_witness(uTx.witness.signatureB); });
+        group.run([this, &uTx]() { generateUserAWitness(uTx.witness); });
+        group.run([this, &uTx]() { generateUserBWitness(uTx.witness); });
+        group.run([this, &uTx]() { generateOperatorWitness(uTx.witness); });
+        group.run([this, &uTx]() { generateProtocolPoolWitness(uTx.witness); });
+        group.wait();
+    }
+
+    // Generates the witness of the transaction circuit of type `t`.
+    // The inactive circuits only get the dummy data (patched with the owners of accounts A and B),
+    // so their witness only depends on the inputs of the circuit and can be taken from
+    // the witness templates. The active circuit is always fully evaluated.
+    void generateCircuitWitness(unsigned int t, const UniversalTransaction &uTx)
+    {
+        bool active = (uTx.type == FieldT(t));
+        if (templates == nullptr || active)
+        {
+            generateCircuitWitness(TransactionType(t), uTx);
+            return;
+        }
+
+        WitnessTemplateCache &cache = templates->caches[t];
+        if (!cache.apply(pb, templateLayouts[t]))
+        {
+            generateCircuitWitness(TransactionType(t), uTx);
+            cache.store(pb, templateLayouts[t]);
+        }
+    }
+
+    void generateCircuitWitness(TransactionType txType, const UniversalTransaction &uTx)
+    {
+        switch (txType)
+        {
+            case TransactionType::Noop:
+                noop.generate_r1cs_witness();
+                break;
+            case TransactionType::Deposit:
+                deposit.generate_r1cs_witness(uTx.deposit);
+                break;
+            case TransactionType::Withdrawal:
+                withdraw.generate_r1cs_witness(uTx.withdraw);
+                break;
+            case TransactionType::Transfer:
+                transfer.generate_r1cs_witness(uTx.transfer);
+                break;
+            case TransactionType::SpotTrade:
+                spotTrade.generate_r1cs_witness(uTx.spotTrade);
+                break;
+            case TransactionType::AccountUpdate:
+                accountUpdate.generate_r1cs_witness(uTx.accountUpdate);
+                break;
+            case TransactionType::AmmUpdate:
+                ammUpdate.generate_r1cs_witness(uTx.ammUpdate);
+                break;
+            case TransactionType::SignatureVerification:
+                signatureVerification.generate_r1cs_witness(uTx.signatureVerification);
+                break;
+            case TransactionType::NftMint:
+                nftMint.generate_r1cs_witness(uTx.nftMint);
+                break;
+            case TransactionType::NftData:
+                nftData.generate_r1cs_witness(uTx.nftData);
+                break;
+            default:
+                assert(false);
+        }
+    }
+
+    // Uses the witness templates for the inactive transaction circuits.
+    // Needs to be called after the constraints are generated.
+    void enableWitnessTemplates(TransactionWitnessTemplates *_templates)
+    {
+        // The circuits in the order their variables were allocated
+        std::vector<BaseTransactionCircuit *> allocationOrder = {
+          &noop,
+          &spotTrade,
+          &deposit,
+          &withdraw,
+          &accountUpdate,
+          &transfer,
+          &ammUpdate,
+          &signatureVerification,
+          &nftMint,
+          &nftData,
+          &tx};
+
+        templateLayouts.clear();
+        templateLayouts.resize(circuits.size());
+        for (unsigned int t = 0; t < circuits.size(); t++)
+        {
+            unsigned int i = std::find(allocationOrder.begin(), allocationOrder.end(), circuits[t]) -
+                             allocationOrder.begin();
+            WitnessTemplateLayout &layout = templateLayouts[t];
+            layout.begin = circuits[t]->variablesBegin;
+            layout.end = allocationOrder[i + 1]->variablesBegin;
+            layout.build(
+              pb,
+              circuits[t]->constraintsBegin,
+              circuits[t]->constraintsEnd,
+              {state.accountA.account.owner, state.accountB.account.owner});
+        }
+        templates = _templates;
+    }
+
+    void generateInputsWitness(const UniversalTransaction &uTx)
     {
         type.generate_r1cs_witness(pb, uTx.type);
         selector.generate_r1cs_witness();
@@ -436,49 +619,48 @@ class TransactionGadget : public GadgetT
           uTx.witness.balanceUpdateB_O.before,
           uTx.witness.balanceUpdateA_P.before,
           uTx.witness.balanceUpdateB_P.before);
+    }
 
-        noop.generate_r1cs_witness();
-        spotTrade.generate_r1cs_witness(uTx.spotTrade);
-        deposit.generate_r1cs_witness(uTx.deposit);
-        withdraw.generate_r1cs_witness(uTx.withdraw);
-        accountUpdate.generate_r1cs_witness(uTx.accountUpdate);
-        transfer.generate_r1cs_witness(uTx.transfer);
-        ammUpdate.generate_r1cs_witness(uTx.ammUpdate);
-        signatureVerification.generate_r1cs_witness(uTx.signatureVerification);
-        nftMint.generate_r1cs_witness(uTx.nftMint);
-        nftData.generate_r1cs_witness(uTx.nftData);
-        tx.generate_r1cs_witness();
-
-        // General validation
+    // General validation
+    void generateValidationWitness()
+    {
         accountA.generate_r1cs_witness();
         accountB.generate_r1cs_witness();
         validateAccountA.generate_r1cs_witness();
         validateAccountB.generate_r1cs_witness();
+    }
 
-        // Check signatures
-        signatureVerifierA.generate_r1cs_witness(uTx.witness.signatureA);
-        signatureVerifierB.generate_r1cs_witness(uTx.witness.signatureB);
-
-        // Update UserA
-        updateStorage_A.generate_r1cs_witness(uTx.witness.storageUpdate_A);
-        updateBalanceS_A.generate_r1cs_witness(uTx.witness.balanceUpdateS_A);
-        updateBalanceB_A.generate_r1cs_witness(uTx.witness.balanceUpdateB_A);
-        updateAccount_A.generate_r1cs_witness(uTx.witness.accountUpdate_A);
+    // Update UserA
+    void generateUserAWitness(const Witness &witness)
+    {
+        updateStorage_A.generate_r1cs_witness(witness.storageUpdate_A);
+        updateBalanceS_A.generate_r1cs_witness(witness.balanceUpdateS_A);
+        updateBalanceB_A.generate_r1cs_witness(witness.balanceUpdateB_A);
+        updateAccount_A.generate_r1cs_witness(witness.accountUpdate_A);
+    }
 
-        // Update UserB
-        updateStorage_B.generate_r1cs_witness(uTx.witness.storageUpdate_B);
-        updateBalanceS_B.generate_r1cs_witness(uTx.witness.balanceUpdateS_B);
-        updateBalanceB_B.generate_r1cs_witness(uTx.witness.balanceUpdateB_B);
-        updateAccount_B.generate_r1cs_witness(uTx.witness.accountUpdate_B);
+    // Update UserB
+    void generateUserBWitness(const Witness &witness)
+    {
+        updateStorage_B.generate_r1cs_witness(witness.storageUpdate_B);
+        updateBalanceS_B.generate_r1cs_witness(witness.balanceUpdateS_B);
+        updateBalanceB_B.generate_r1cs_witness(witness.balanceUpdateB_B);
+        updateAccount_B.generate_r1cs_witness(witness.accountUpdate_B);
+    }
 
-        // Update Operator
-        updateBalanceB_O.generate_r1cs_witness(uTx.witness.balanceUpdateB_O);
-        updateBalanceA_O.generate_r1cs_witness(uTx.witness.balanceUpdateA_O);
-        updateAccount_O.generate_r1cs_witness(uTx.witness.accountUpdate_O);
+    // Update Operator
+    void generateOperatorWitness(const Witness &witness)
+    {
+        updateBalanceB_O.generate_r1cs_witness(witness.balanceUpdateB_O);
+        updateBalanceA_O.generate_r1cs_witness(witness.balanceUpdateA_O);
+        updateAccount_O.generate_r1cs_witness(witness.accountUpdate_O);
+    }
 
-        // Update Protocol pool
-        updateBalanceB_P.generate_r1cs_witness(uTx.witness.balanceUpdateB_P);
-        updateBalanceA_P.generate_r1cs_witness(uTx.witness.balanceUpdateA_P);
+    // Update Protocol pool
+    void generateProtocolPoolWitness(const Witness &witness)
+    {
+        updateBalanceB_P.generate_r1cs_witness(witness.balanceUpdateB_P);
+        updateBalanceA_P.generate_r1cs_witness(witness.balanceUpdateA_P);
     }
 
     void generate_r1cs_constraints()
@@ -486,16 +668,16 @@ class TransactionGadget : public GadgetT
         type.generate_r1cs_constraints(true);
         selector.generate_r1cs_constraints();
 
-        noop.generate_r1cs_constraints();
-        spotTrade.generate_r1cs_constraints();
-        deposit.generate_r1cs_constraints();
-        withdraw.generate_r1cs_constraints();
-        accountUpdate.generate_r1cs_constraints();
-        transfer.generate_r1cs_constraints();
-        ammUpdate.generate_r1cs_constraints();
-        signatureVerification.generate_r1cs_constraints();
-        nftMint.generate_r1cs_constraints();
-        nftData.generate_r1cs_constraints();
+        generateCircuitConstraints(noop);
+        generateCircuitConstraints(spotTrade);
+        generateCircuitConstraints(deposit);
+        generateCircuitConstraints(withdraw);
+        generateCircuitConstraints(accountUpdate);
+        generateCircuitConstraints(transfer);
+        generateCircuitConstraints(ammUpdate);
+        generateCircuitConstraints(signatureVerification);
+        generateCircuitConstraints(nftMint);
+        generateCircuitConstraints(nftData);
         tx.generate_r1cs_constraints();
 
         // General validation
@@ -535,6 +717,14 @@ class TransactionGadget : public GadgetT
         return flatten({reverse(type.bits), tx.getPublicData()});
     }
 
+    // Also remembers which constraints belong to the circuit
+    template <typename CircuitT> void generateCircuitConstraints(CircuitT &circuit)
+    {
+        circuit.constraintsBegin = pb.num_constraints();
+        circuit.generate_r1cs_constraints();
+        circuit.constraintsEnd = pb.num_constraints();
+    }
+
     const VariableT &getNewAccountsRoot() const
     {
         return updateAccount_O.result();
@@ -577,6 +767,8 @@ class UniversalCircuit : public Circuit
     // Transactions
     unsigned int numTransactions;
     std::vector<TransactionGadget> transactions;
+    // Witness templates of the inactive transaction circuits (null when not enabled)
+    std::unique_ptr<TransactionWitnessTemplates> templates;
 
     // Update Protocol pool
     std::unique_ptr<UpdateAccountGadget> updateAccount_P;
@@ -661,7 +853,9 @@ class UniversalCircuit : public Circuit
               txProtocolBalancesRoot,
               (j == 0) ? constants._0 : transactions.back().tx.getOutput(TXV_NUM_CONDITIONAL_TXS),
               std::string("tx_") + std::to_string(j));
+            transactions.back().constraintsBegin = pb.num_constraints();
             transactions.back().generate_r1cs_constraints();
+            transactions.back().constraintsEnd = pb.num_constraints();
         }
 
         // Update Protocol pool
@@ -742,6 +936,142 @@ class UniversalCircuit : public Circuit
             return false;
         }
 
+        generateHeaderWitness(block);
+
+        // Transactions
+        // First set numConditionalTransactionsAfter which is a dependency between
+        // transactions. Once this is set the transactions can be processed in
+        // parallel.
+        for (unsigned int i = 0; i < block.transactions.size(); i++)
+        {
+            pb.val(transactions[i].tx.getOutput(TXV_NUM_CONDITIONAL_TXS)) =
+              block.transactions[i].witness.numConditionalTransactionsAfter;
+        }
+#ifdef MULTICORE
+        // Every transaction is a task which spawns tasks for its independent stages,
+        // so idle threads can help out on the transactions that take the longest.
+        // Runs on the shared thread pool with the thread budget of the calling thread.
+        ThreadPool::Job job(ThreadPool::get());
+        ThreadPool::TaskGroup group(job);
+        for (unsigned int i = 0; i < block.transactions.size(); i++)
+        {
+            group.run([this, i, &block, &job]() { generateTransactionWitness(i, block.transactions[i], &job); });
+        }
+        group.wait();
+#else
+        for (unsigned int i = 0; i < block.transactions.size(); i++)
+        {
+            // std::cout << "--------------- tx: " << i << " ( " <<
+            // block.transactions[i].type << " ) " << std::endl;
+            generateTransactionWitness(i, block.transactions[i]);
+        }
+#endif
+
+        generateFinalWitness(block);
+
+        return true;
+    }
+
+    bool generateWitness(const json &input) override
+    {
+        return generateWitness(input.get<Block>());
+    }
+
+    // Generates the witness while the block is being read.
+    // The stream is parsed on a separate thread, every transaction is processed as soon
+    // as it is decoded (and the block header is known). Only the block level updates
+    // and the signature are done after the complete block is read.
+    bool generateWitness(std::istream &stream) override
+    {
+        Block block;
+        json blockData;
+        std::atomic<bool> valid(true);
+        // Limits how far the reader can get ahead of the witness generation
+        BoundedQueue<std::pair<unsigned int, std::unique_ptr<UniversalTransaction>>> queue(64);
+
+        std::thread reader([&]() {
+            TraceScope scope("read", "parse");
+            bool success = BlockReader::read(
+              stream,
+              [&](const json &header) -> bool {
+                  if (header["blockSize"].get<unsigned int>() != numTransactions)
+                  {
+                      std::cout << "Invalid number of transactions: " << header["blockSize"] << std::endl;
+                      return false;
+                  }
+                  blockHeaderFromJson(header, block);
+                  generateHeaderWitness(block);
+                  return true;
+              },
+              [&](unsigned int i, std::unique_ptr<UniversalTransaction> transaction) -> bool {
+                  if (i >= numTransactions)
+                  {
+                      std::cout << "Invalid number of transactions: " << (i + 1) << std::endl;
+                      return false;
+                  }
+                  // Transaction i + 1 depends on this value, it is always set before
+                  // the transaction i + 1 is queued.
+                  pb.val(transactions[i].tx.getOutput(TXV_NUM_CONDITIONAL_TXS)) =
+                    transaction->witness.numConditionalTransactionsAfter;
+                  return queue.push(std::make_pair(i, std::move(transaction)));
+              },
+              blockData);
+            valid = success;
+            queue.close();
+        });
+
+        // Keep the transactions alive until all tasks are done
+        std::vector<std::unique_ptr<UniversalTransaction>> blockTransactions(numTransactions);
+        unsigned int numReceived = 0;
+#ifdef MULTICORE
+        ThreadPool::Job job(ThreadPool::get());
+        ThreadPool::TaskGroup group(job);
+#endif
+        {
+            std::pair<unsigned int, std::unique_ptr<UniversalTransaction>> item;
+            while (queue.pop(item))
+            {
+                unsigned int i = item.first;
+                UniversalTransaction *transaction = item.second.get();
+                blockTransactions[i] = std::move(item.second);
+                numReceived++;
+#ifdef MULTICORE
+                group.run([this, i, transaction, &job]() { generateTransactionWitness(i, *transaction, &job); });
+#else
+                generateTransactionWitness(i, *transaction);
+#endif
+            }
+        }
+#ifdef MULTICORE
+        group.wait();
+#endif
+        reader.join();
+
+        if (!valid)
+        {
+            return false;
+        }
+        if (numReceived != numTransactions)
+        {
+            std::cout << "Invalid number of transactions: " << numReceived << std::endl;
+            return false;
+        }
+        if (!blockData.contains("signature"))
+        {
+            std::cout << "Block signature missing" << std::endl;
+            return false;
+        }
+        block.signature = blockData["signature"].get<Signature>();
+
+        generateFinalWitness(block);
+
+        return true;
+    }
+
+    // Block data that is needed by the transactions
+    void generateHeaderWitness(const Block &block)
+    {
+        TraceScope scope("header", "witness");
         constants.generate_r1cs_witness();
 
         // State
@@ -759,26 +1089,35 @@ class UniversalCircuit : public Circuit
 
         // Increment the nonce of the Operator
         nonce_after.generate_r1cs_witness();
+    }
 
-        // Transactions
-        // First set numConditionalTransactionsAfter which is a dependency between
-        // transactions. Once this is set the transactions can be processed in
-        // parallel.
-        for (unsigned int i = 0; i < block.transactions.size(); i++)
+    // Needs numConditionalTransactionsAfter of the previous transaction to be set.
+    // The independent stages of the transaction are run as tasks of `job` when set.
+    void generateTransactionWitness(
+      unsigned int i,
+      const UniversalTransaction &transaction,
+      ThreadPool::Job *job = nullptr)
+    {
+        TraceScope scope("transaction", "witness");
+        if (scope.isActive())
         {
-            pb.val(transactions[i].tx.getOutput(TXV_NUM_CONDITIONAL_TXS)) =
-              block.transactions[i].witness.numConditionalTransactionsAfter;
+            scope.args["index"] = i;
+            scope.args["type"] = transaction.type.as_bigint().as_ulong();
         }
-#ifdef MULTICORE
-#pragma omp parallel for
-#endif
-        for (unsigned int i = 0; i < block.transactions.size(); i++)
+        if (job)
         {
-            // std::cout << "--------------- tx: " << i << " ( " <<
-            // block.transactions[i].type << " ) " << std::endl;
-            transactions[i].generate_r1cs_witness(block.transactions[i]);
+            transactions[i].generate_r1cs_witness_tasks(transaction, *job);
+        }
+        else
+        {
+            transactions[i].generate_r1cs_witness(transaction);
         }
+    }
 
+    // Everything that depends on all transactions
+    void generateFinalWitness(const Block &block)
+    {
+        TraceScope scope("block", "witness");
         // Update Protocol pool
         updateAccount_P->generate_r1cs_witness(block.accountUpdate_P);
 
@@ -794,13 +1133,71 @@ class UniversalCircuit : public Circuit
         // Signature
         hash.generate_r1cs_witness();
         signatureVerifier.generate_r1cs_witness(block.signature);
+    }
 
-        return true;
+    void enableWitnessTemplates() override
+    {
+        templates.reset(new TransactionWitnessTemplates());
+        for (unsigned int i = 0; i < transactions.size(); i++)
+        {
+            transactions[i].enableWitnessTemplates(templates.get());
+        }
     }
 
-    bool generateWitness(const json &input) override
+    // The transaction slot, the type of the transaction in the slot and the transaction circuit
+    std::string describeConstraint(size_t index) override
     {
-        return generateWitness(input.get<Block>());
+        auto it = std::upper_bound(
+          transactions.begin(), transactions.end(), index, [](size_t value, const TransactionGadget &transaction) {
+              return value < transaction.constraintsEnd;
+          });
+        if (it == transactions.end() || index < it->constraintsBegin)
+        {
+            return "block";
+        }
+        const unsigned int type = pb.val(it->type.packed).as_bigint().as_ulong();
+        std::string description = std::string("tx_") + std::to_string(it - transactions.begin()) + " (" +
+                                  getTransactionTypeName(type) + ")";
+        for (unsigned int t = 0; t < it->circuits.size(); t++)
+        {
+            if (index >= it->circuits[t]->constraintsBegin && index < it->circuits[t]->constraintsEnd)
+            {
+                description += std::string(", ") + getTransactionTypeName(t) + " circuit";
+            }
+        }
+        return description;
+    }
+
+    std::vector<SignatureRequest> getSignatureRequests() override
+    {
+        std::vector<SignatureRequest> requests;
+        for (unsigned int i = 0; i < transactions.size(); i++)
+        {
+            const SelectTransactionGadget &tx = transactions[i].tx;
+            if (pb.val(tx.getOutput(TXV_SIGNATURE_REQUIRED_A)) == FieldT::one())
+            {
+                requests.push_back(
+                  {i,
+                   "signatureA",
+                   jubjub::EdwardsPoint(pb.val(tx.getOutput(TXV_PUBKEY_X_A)), pb.val(tx.getOutput(TXV_PUBKEY_Y_A))),
+                   pb.val(tx.getOutput(TXV_HASH_A))});
+            }
+            if (pb.val(tx.getOutput(TXV_SIGNATURE_REQUIRED_B)) == FieldT::one())
+            {
+                requests.push_back(
+                  {i,
+                   "signatureB",
+                   jubjub::EdwardsPoint(pb.val(tx.getOutput(TXV_PUBKEY_X_B)), pb.val(tx.getOutput(TXV_PUBKEY_Y_B))),
+                   pb.val(tx.getOutput(TXV_HASH_B))});
+            }
+        }
+        // The block is signed by the operator
+        requests.push_back(
+          {numTransactions,
+           "signature",
+           jubjub::EdwardsPoint(pb.val(accountBefore_O.publicKey.x), pb.val(accountBefore_O.publicKey.y)),
+           pb.val(hash.result())});
+        return requests;
     }
 
     unsigned int getBlockType() override
@@ -129,6 +129,7 @@ using socket_t = SOCKET;
 #include <pthread.h>
 #include <sys/select.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 using socket_t = int;
@@ -476,6 +477,9 @@ public:
   void set_keep_alive_max_count(size_t count);
   void set_read_timeout(time_t sec, time_t usec);
   void set_payload_max_length(size_t length);
+  // AF_UNIX listens on the Unix domain socket at the path passed as host
+  // (the port is ignored)
+  void set_address_family(int family);
 
   bool bind_to_port(const char *host, int port, int socket_flags = 0);
   int bind_to_any_port(const char *host, int socket_flags = 0);
@@ -497,6 +501,7 @@ protected:
   time_t read_timeout_sec_;
   time_t read_timeout_usec_;
   size_t payload_max_length_;
+  int address_family_;
 
 private:
   using Handlers = std::vector<std::pair<std::regex, Handler>>;
@@ -2827,7 +2832,8 @@ inline Server::Server()
     : keep_alive_max_count_(CPPHTTPLIB_KEEPALIVE_MAX_COUNT),
       read_timeout_sec_(CPPHTTPLIB_READ_TIMEOUT_SECOND),
       read_timeout_usec_(CPPHTTPLIB_READ_TIMEOUT_USECOND),
-      payload_max_length_(CPPHTTPLIB_PAYLOAD_MAX_LENGTH), is_running_(false),
+      payload_max_length_(CPPHTTPLIB_PAYLOAD_MAX_LENGTH),
+      address_family_(AF_UNSPEC), is_running_(false),
       svr_sock_(INVALID_SOCKET) {
 #ifndef _WIN32
   signal(SIGPIPE, SIG_IGN);
@@ -2927,6 +2933,8 @@ inline void Server::set_payload_max_length(size_t length) {
   payload_max_length_ = length;
 }
 
+inline void Server::set_address_family(int family) { address_family_ = family; }
+
 inline bool Server::bind_to_port(const char *host, int port, int socket_flags) {
   if (bind_internal(host, port, socket_flags) < 0) return false;
   return true;
@@ -3241,6 +3249,26 @@ inline bool Server::handle_file_request(Request &req, Response &res, bool head)
 
 inline socket_t Server::create_server_socket(const char *host, int port,
                                              int socket_flags) const {
+#ifndef _WIN32
+  if (address_family_ == AF_UNIX) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(host) >= sizeof(addr.sun_path)) { return INVALID_SOCKET; }
+    strncpy(addr.sun_path, host, sizeof(addr.sun_path) - 1);
+
+    auto sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == INVALID_SOCKET) { return INVALID_SOCKET; }
+    if (fcntl(sock, F_SETFD, FD_CLOEXEC) == -1 ||
+        ::bind(sock, reinterpret_cast<struct sockaddr *>(&addr),
+               sizeof(addr)) ||
+        ::listen(sock, 5)) {
+      detail::close_socket(sock);
+      return INVALID_SOCKET;
+    }
+    return sock;
+  }
+#endif
   return detail::create_socket(
       host, port,
       [](socket_t sock, struct addrinfo &ai) -> bool {
@@ -3261,7 +3289,7 @@ inline int Server::bind_internal(const char *host, int port, int socket_flags) {
   svr_sock_ = create_server_socket(host, port, socket_flags);
   if (svr_sock_ == INVALID_SOCKET) { return -1; }
 
-  if (port == 0) {
+  if (port == 0 && address_family_ != AF_UNIX) {
     struct sockaddr_storage address;
     socklen_t len = sizeof(address);
     if (getsockname(svr_sock_, reinterpret_cast<struct sockaddr *>(&address),
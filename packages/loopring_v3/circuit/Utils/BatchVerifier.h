@@ -0,0 +1,160 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _BATCHVERIFIER_H_
+#define _BATCHVERIFIER_H_
+
+#include "ethsnarks.hpp"
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+using namespace ethsnarks;
+
+namespace Loopring
+{
+
+typedef std::pair<PrimaryInputT, ProofT> ProofWithInputs;
+
+// Verifies many Groth16 proofs for the same verification key with a single pairing check.
+// Every proof i is weighted with a random scalar r_i and all verification equations are added:
+//   prod_i e(r_i*A_i, B_i) == e(sum_i(r_i)*alpha, beta) * e(sum_i(r_i*IC(x_i)), gamma) * e(sum_i(r_i*C_i), delta)
+// An invalid proof only passes when the random scalars happen to cancel out its error,
+// which happens with a probability of 2^-128 for 128-bit scalars.
+// Only a single final exponentiation is needed and the Miller loops are done in parallel.
+// When the batch is invalid the invalid proofs are found by splitting the batch in halves.
+class BatchVerifier
+{
+  public:
+    BatchVerifier(const VerificationKeyT &_vk)
+        : vk(_vk),
+          betaPrecomp(ppT::precompute_G2(vk.beta_g2)),
+          gammaPrecomp(ppT::precompute_G2(vk.gamma_g2)),
+          deltaPrecomp(ppT::precompute_G2(vk.delta_g2))
+    {
+    }
+
+    // Returns the indices of the invalid proofs
+    std::vector<size_t> verify(const std::vector<ProofWithInputs> &proofs)
+    {
+        std::vector<size_t> invalid;
+        findInvalid(proofs, 0, proofs.size(), invalid);
+        return invalid;
+    }
+
+    // Checks proofs [begin, end) with a single pairing check
+    bool verifyBatch(const std::vector<ProofWithInputs> &proofs, size_t begin, size_t end)
+    {
+        const size_t count = end - begin;
+        if (count == 0)
+        {
+            return true;
+        }
+        for (size_t i = begin; i < end; i++)
+        {
+            if (proofs[i].first.size() != vk.gamma_ABC_g1.domain_size() || !proofs[i].second.is_well_formed())
+            {
+                return false;
+            }
+        }
+
+        std::vector<FieldT> r(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            r[i] = randomScalar();
+        }
+
+        // The public inputs are combined first so IC is only evaluated once:
+        // sum_i(r_i*IC(x_i)) = sum_i(r_i)*IC_0 + sum_j(sum_i(r_i*x_ij)*IC_j)
+        const size_t numInputs = proofs[begin].first.size();
+        FieldT sumR = FieldT::zero();
+        std::vector<FieldT> combinedInputs(numInputs, FieldT::zero());
+        for (size_t i = 0; i < count; i++)
+        {
+            sumR += r[i];
+            const PrimaryInputT &inputs = proofs[begin + i].first;
+            for (size_t j = 0; j < numInputs; j++)
+            {
+                combinedInputs[j] += r[i] * inputs[j];
+            }
+        }
+        const G1T firstIC = vk.gamma_ABC_g1.first;
+        const G1T combinedIC =
+          vk.gamma_ABC_g1.template accumulate_chunk<FieldT>(combinedInputs.begin(), combinedInputs.end(), 0).first -
+          firstIC + sumR * firstIC;
+
+        // The Miller loops of the proofs, the C's are weighted at the same time
+        std::vector<FqkT> millerLoops(count);
+        std::vector<G1T> weightedC(count);
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+        for (size_t i = 0; i < count; i++)
+        {
+            const ProofT &proof = proofs[begin + i].second;
+            millerLoops[i] =
+              ppT::miller_loop(ppT::precompute_G1(r[i] * proof.g_A), ppT::precompute_G2(proof.g_B));
+            weightedC[i] = r[i] * proof.g_C;
+        }
+        G1T sumC = G1T::zero();
+        FqkT product = FqkT::one();
+        for (size_t i = 0; i < count; i++)
+        {
+            sumC = sumC + weightedC[i];
+            product = product * millerLoops[i];
+        }
+
+        // Move the right hand side to the left so only a single final exponentiation is needed
+        product = product * ppT::miller_loop(ppT::precompute_G1(-(sumR * vk.alpha_g1)), betaPrecomp);
+        product = product * ppT::miller_loop(ppT::precompute_G1(-combinedIC), gammaPrecomp);
+        product = product * ppT::miller_loop(ppT::precompute_G1(-sumC), deltaPrecomp);
+        return ppT::final_exponentiation(product) == GTT::one();
+    }
+
+  private:
+    typedef libff::G1<ppT> G1T;
+    typedef libff::G2_precomp<ppT> G2PrecompT;
+    typedef libff::Fqk<ppT> FqkT;
+    typedef libff::GT<ppT> GTT;
+
+    const VerificationKeyT vk;
+    const G2PrecompT betaPrecomp;
+    const G2PrecompT gammaPrecomp;
+    const G2PrecompT deltaPrecomp;
+    std::random_device randomDevice;
+
+    void findInvalid(const std::vector<ProofWithInputs> &proofs, size_t begin, size_t end, std::vector<size_t> &invalid)
+    {
+        if (verifyBatch(proofs, begin, end))
+        {
+            return;
+        }
+        if (end - begin == 1)
+        {
+            invalid.push_back(begin);
+            return;
+        }
+        const size_t mid = begin + (end - begin) / 2;
+        findInvalid(proofs, begin, mid, invalid);
+        findInvalid(proofs, mid, end, invalid);
+    }
+
+    // A 128-bit scalar from the system's secure random source
+    FieldT randomScalar()
+    {
+        libff::bigint<FieldT::num_limbs> value(0ul);
+        for (unsigned int i = 0; i < 128 / 32; i++)
+        {
+            value.data[i / 2] |= mp_limb_t(randomDevice()) << (32 * (i % 2));
+        }
+        return FieldT(value);
+    }
+};
+
+} // namespace Loopring
+
+#endif
@@ -0,0 +1,1127 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _BLOCKGENERATOR_H_
+#define _BLOCKGENERATOR_H_
+
+#include "Constants.h"
+#include "Data.h"
+#include "EdDSA.h"
+#include "Poseidon.h"
+#include "Utils.h"
+
+#include "ethsnarks.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <map>
+#include <random>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+namespace Loopring
+{
+
+// Decimal string of a field element
+static std::string fieldToString(const FieldT &value)
+{
+    const unsigned int numLimbs = FieldT::num_limbs;
+    libff::bigint<FieldT::num_limbs> limbs = value.as_bigint();
+    // Repeatedly divide by 10^19, the largest power of 10 that fits in a limb
+    const uint64_t base = 10000000000000000000ULL;
+    std::vector<uint64_t> digits;
+    bool isZero = false;
+    while (!isZero)
+    {
+        __uint128_t remainder = 0;
+        isZero = true;
+        for (int i = numLimbs - 1; i >= 0; i--)
+        {
+            const __uint128_t current = (remainder << 64) | uint64_t(limbs.data[i]);
+            limbs.data[i] = uint64_t(current / base);
+            remainder = current % base;
+            isZero = isZero && (limbs.data[i] == 0);
+        }
+        digits.push_back(uint64_t(remainder));
+    }
+    std::string result = std::to_string(digits.back());
+    for (int i = int(digits.size()) - 2; i >= 0; i--)
+    {
+        const std::string part = std::to_string(digits[i]);
+        result += std::string(19 - part.size(), '0') + part;
+    }
+    return result;
+}
+
+static json toJSON(const std::vector<FieldT> &values)
+{
+    json j = json::array();
+    for (const FieldT &value : values)
+    {
+        j.push_back(fieldToString(value));
+    }
+    return j;
+}
+
+static json toJSON(const StorageLeaf &leaf)
+{
+    json j;
+    j["data"] = fieldToString(leaf.data);
+    j["storageID"] = fieldToString(leaf.storageID);
+    return j;
+}
+
+static json toJSON(const BalanceLeaf &leaf)
+{
+    json j;
+    j["balance"] = fieldToString(leaf.balance);
+    j["weightAMM"] = fieldToString(leaf.weightAMM);
+    j["storageRoot"] = fieldToString(leaf.storageRoot);
+    return j;
+}
+
+static json toJSON(const AccountLeaf &leaf)
+{
+    json j;
+    j["owner"] = fieldToString(leaf.owner);
+    j["publicKeyX"] = fieldToString(leaf.publicKey.x);
+    j["publicKeyY"] = fieldToString(leaf.publicKey.y);
+    j["nonce"] = fieldToUint64(leaf.nonce);
+    j["feeBipsAMM"] = fieldToUint64(leaf.feeBipsAMM);
+    j["balancesRoot"] = fieldToString(leaf.balancesRoot);
+    return j;
+}
+
+static json toJSON(const Signature &signature)
+{
+    json j;
+    j["Rx"] = fieldToString(signature.R.x);
+    j["Ry"] = fieldToString(signature.R.y);
+    j["s"] = fieldToString(signature.s);
+    return j;
+}
+
+static FieldT hashLeaf(const StorageLeaf &leaf)
+{
+    return NativeHashStorageLeaf::hash({leaf.data, leaf.storageID});
+}
+
+static FieldT hashLeaf(const BalanceLeaf &leaf)
+{
+    return NativeHashBalanceLeaf::hash({leaf.balance, leaf.weightAMM, leaf.storageRoot});
+}
+
+static FieldT hashLeaf(const AccountLeaf &leaf)
+{
+    return NativeHashAccountLeaf::hash(
+      {leaf.owner, leaf.publicKey.x, leaf.publicKey.y, leaf.nonce, leaf.feeBipsAMM, leaf.balancesRoot});
+}
+
+// A sparse quad Merkle tree with the same hashes as the Merkle trees in the circuit (see MerkleTree.h).
+// Only nodes that differ from an empty tree are stored.
+class NativeMerkleTree
+{
+  public:
+    // The roots of empty subtrees of every height, starting with the empty leaf
+    static std::vector<FieldT> createEmptyHashes(unsigned int depth, const FieldT &emptyLeaf)
+    {
+        std::vector<FieldT> hashes = {emptyLeaf};
+        for (unsigned int level = 0; level < depth; level++)
+        {
+            const FieldT child = hashes.back();
+            hashes.push_back(NativeHashMerkleTree::hash({child, child, child, child}));
+        }
+        return hashes;
+    }
+
+    // `_emptyHashes` needs to outlive the tree
+    NativeMerkleTree(const std::vector<FieldT> &_emptyHashes)
+        : emptyHashes(&_emptyHashes), nodes(_emptyHashes.size())
+    {
+    }
+
+    const FieldT &getRoot() const
+    {
+        return getNode(getDepth(), 0);
+    }
+
+    // The 3 siblings on every level, starting at the leaf (the format of the proofs in the block)
+    std::vector<FieldT> createProof(uint64_t address) const
+    {
+        std::vector<FieldT> proof;
+        proof.reserve(getDepth() * 3);
+        for (unsigned int level = 0; level < getDepth(); level++)
+        {
+            const uint64_t first = address & ~uint64_t(3);
+            for (uint64_t sibling = first; sibling < first + 4; sibling++)
+            {
+                if (sibling != address)
+                {
+                    proof.push_back(getNode(level, sibling));
+                }
+            }
+            address >>= 2;
+        }
+        return proof;
+    }
+
+    void update(uint64_t address, const FieldT &leaf)
+    {
+        nodes[0][address] = leaf;
+        for (unsigned int level = 0; level < getDepth(); level++)
+        {
+            const uint64_t first = address & ~uint64_t(3);
+            const FieldT parent = NativeHashMerkleTree::hash(
+              {getNode(level, first), getNode(level, first + 1), getNode(level, first + 2), getNode(level, first + 3)});
+            address >>= 2;
+            nodes[level + 1][address] = parent;
+        }
+    }
+
+  private:
+    const std::vector<FieldT> *emptyHashes;
+    std::vector<std::unordered_map<uint64_t, FieldT>> nodes;
+
+    unsigned int getDepth() const
+    {
+        return nodes.size() - 1;
+    }
+
+    const FieldT &getNode(unsigned int level, uint64_t index) const
+    {
+        auto it = nodes[level].find(index);
+        return (it != nodes[level].end()) ? it->second : (*emptyHashes)[level];
+    }
+};
+
+struct NativeBalance
+{
+    FieldT balance;
+    FieldT weightAMM;
+    NativeMerkleTree storageTree;
+    std::unordered_map<uint64_t, StorageLeaf> storage;
+
+    NativeBalance() : balance(FieldT::zero()), weightAMM(FieldT::zero()), storageTree(getEmptyHashes())
+    {
+    }
+
+    static const std::vector<FieldT> &getEmptyHashes()
+    {
+        static const std::vector<FieldT> hashes = NativeMerkleTree::createEmptyHashes(
+          TREE_DEPTH_STORAGE, hashLeaf(StorageLeaf{FieldT::zero(), FieldT::zero()}));
+        return hashes;
+    }
+
+    StorageLeaf getStorage(uint64_t slot) const
+    {
+        auto it = storage.find(slot);
+        return (it != storage.end()) ? it->second : StorageLeaf{FieldT::zero(), FieldT::zero()};
+    }
+
+    BalanceLeaf getLeaf() const
+    {
+        return BalanceLeaf{balance, weightAMM, storageTree.getRoot()};
+    }
+};
+
+struct NativeAccount
+{
+    FieldT owner;
+    jubjub::EdwardsPoint publicKey;
+    FieldT nonce;
+    FieldT feeBipsAMM;
+    NativeMerkleTree balancesTree;
+    std::unordered_map<uint64_t, NativeBalance> balances;
+
+    NativeAccount()
+        : owner(FieldT::zero()),
+          publicKey(FieldT::zero(), FieldT::zero()),
+          nonce(FieldT::zero()),
+          feeBipsAMM(FieldT::zero()),
+          balancesTree(getEmptyHashes())
+    {
+    }
+
+    static const std::vector<FieldT> &getEmptyHashes()
+    {
+        static const std::vector<FieldT> hashes =
+          NativeMerkleTree::createEmptyHashes(TREE_DEPTH_TOKENS, hashLeaf(NativeBalance().getLeaf()));
+        return hashes;
+    }
+
+    NativeBalance &getBalance(uint64_t tokenID)
+    {
+        return balances[tokenID];
+    }
+
+    AccountLeaf getLeaf() const
+    {
+        return AccountLeaf{owner, publicKey, nonce, feeBipsAMM, balancesTree.getRoot()};
+    }
+};
+
+// How a transaction changes the state, the same as `executeTransaction` in the Python operator (state.py).
+// Everything not set is left unchanged, the defaults are the same as in the Python operator.
+struct TransactionChanges
+{
+    struct Account
+    {
+        uint64_t accountID = 1;
+        bool setOwner = false;
+        FieldT owner = FieldT::zero();
+        bool setPublicKey = false;
+        jubjub::EdwardsPoint publicKey;
+        unsigned int nonceIncrement = 0;
+        uint64_t tokenS = 0;
+        FieldT deltaS = FieldT::zero();
+        uint64_t tokenB = 0;
+        FieldT deltaB = FieldT::zero();
+        // When no storage is set the leaf in slot 0 is rewritten unchanged
+        bool setStorage = false;
+        uint64_t storageID = 0;
+        FieldT storageData = FieldT::zero();
+        // The new weights of the balances (the virtual balances of AMMs or the NFT data), unchanged when not set
+        bool setWeightS = false;
+        FieldT weightS = FieldT::zero();
+        bool setWeightB = false;
+        FieldT weightB = FieldT::zero();
+    };
+    Account accountA;
+    Account accountB;
+
+    // Operator and protocol fees, in tokenB of account A and tokenB of account B
+    FieldT deltaA_O = FieldT::zero();
+    FieldT deltaB_O = FieldT::zero();
+    FieldT deltaA_P = FieldT::zero();
+    FieldT deltaB_P = FieldT::zero();
+
+    unsigned int numConditionalTransactions = 0;
+};
+
+// Generates blocks with valid transactions for any block size and mix of transaction types (see `-genblock`).
+// The state starts from scratch with funded accounts and is kept between blocks, so consecutive blocks
+// can be generated.
+//
+// The mix is a JSON object, all fields except `transactions` are optional:
+// {
+//   "seed": 1,
+//   "numAccounts": 64,
+//   "numAmmAccounts": 1,
+//   "numTokens": 4,
+//   "timestamp": 1600000000,
+//   "transactions": {"transfer": 4, "spotTrade": 2, "ammSwap": 1, "nftMint": 1, "withdraw": 1, "deposit": 1,
+//                    "accountUpdate": 1, "noop": 1}
+// }
+// The weights in `transactions` are the fractions of the block used by every transaction type.
+// `ammSwap` is a spot trade of a user with an AMM account (an AMM order checked against the AMM curve),
+// `nftMint` mints an NFT on L2 to the minter's own account.
+//
+// Transactions that need a signature are only signed in `sign`: the messages are hashes of the
+// transaction data that are calculated in the circuit (see `Circuit::getSignatureRequests`).
+class BlockGenerator
+{
+  public:
+    BlockGenerator(const json &mix)
+        : rng(mix.contains("seed") ? mix["seed"].get<uint64_t>() : 1),
+          numAccounts(mix.contains("numAccounts") ? mix["numAccounts"].get<unsigned int>() : 64),
+          numAmmAccounts(mix.contains("numAmmAccounts") ? mix["numAmmAccounts"].get<unsigned int>() : 1),
+          numTokens(mix.contains("numTokens") ? mix["numTokens"].get<unsigned int>() : 4),
+          timestamp(mix.contains("timestamp") ? mix["timestamp"].get<unsigned int>() : std::time(nullptr)),
+          protocolTakerFeeBips(
+            mix.contains("protocolTakerFeeBips") ? mix["protocolTakerFeeBips"].get<unsigned int>() : 50),
+          protocolMakerFeeBips(
+            mix.contains("protocolMakerFeeBips") ? mix["protocolMakerFeeBips"].get<unsigned int>() : 25),
+          operatorAccountID(1),
+          accountsTree(getEmptyHashes()),
+          numConditionalTransactions(0)
+    {
+        if (mix.contains("transactions"))
+        {
+            for (auto it = mix["transactions"].begin(); it != mix["transactions"].end(); ++it)
+            {
+                weights[it.key()] = it.value().get<double>();
+            }
+        }
+        exchange = randomBits(160);
+
+        // Account 0 receives the protocol fees, account 1 is the operator, followed by the users and the AMMs.
+        // The operator pays the protocol fees that are larger than the trading fees it receives.
+        createAccount(0, FieldT::zero(), jubjub::EdwardsPoint(FieldT::zero(), FieldT::zero()), FieldT::zero());
+        const FieldT initialBalance("1000000000000000000000000");
+        createAccount(operatorAccountID, randomBits(160), createKeyPair().publicKey, initialBalance);
+        for (unsigned int i = 0; i < numAccounts; i++)
+        {
+            createAccount(getFirstUserAccountID() + i, randomBits(160), createKeyPair().publicKey, initialBalance);
+        }
+        // The virtual balances of the AMMs are the same as their balances
+        for (unsigned int i = 0; i < numAmmAccounts; i++)
+        {
+            createAccount(getFirstAmmAccountID() + i, randomBits(160), createKeyPair().publicKey, initialBalance, 20);
+        }
+    }
+
+    static std::vector<std::string> getSupportedTypes()
+    {
+        return {"noop", "deposit", "transfer", "withdraw", "accountUpdate", "spotTrade", "ammSwap", "nftMint"};
+    }
+
+    // Generates the next block, the signatures are still missing
+    bool generate(unsigned int blockSize, json &block)
+    {
+        std::vector<std::string> types;
+        if (!pickTypes(blockSize, types))
+        {
+            return false;
+        }
+
+        block = json();
+        block["blockType"] = 0;
+        block["blockSize"] = blockSize;
+        block["exchange"] = fieldToString(exchange);
+        block["merkleRootBefore"] = fieldToString(accountsTree.getRoot());
+        block["timestamp"] = timestamp;
+        block["protocolTakerFeeBips"] = protocolTakerFeeBips;
+        block["protocolMakerFeeBips"] = protocolMakerFeeBips;
+        block["operatorAccountID"] = operatorAccountID;
+
+        const AccountLeaf protocolAccountBefore = getAccount(0).getLeaf();
+        numConditionalTransactions = 0;
+        block["transactions"] = json::array();
+        for (const std::string &type : types)
+        {
+            block["transactions"].push_back(generateTransaction(type));
+        }
+
+        // The protocol fees are only added to the accounts tree at the end of the block
+        json update = beginAccountUpdate(0);
+        update["before"] = toJSON(protocolAccountBefore);
+        block["accountUpdate_P"] = endAccountUpdate(0, update);
+
+        NativeAccount &operatorAccount = getAccount(operatorAccountID);
+        update = beginAccountUpdate(operatorAccountID);
+        operatorAccount.nonce += FieldT::one();
+        block["accountUpdate_O"] = endAccountUpdate(operatorAccountID, update);
+
+        block["merkleRootAfter"] = fieldToString(accountsTree.getRoot());
+        block["signature"] = dummySignature;
+        return true;
+    }
+
+    // Signs all requested messages with the keys of the accounts
+    bool sign(json &block, const std::vector<SignatureRequest> &requests)
+    {
+        for (const SignatureRequest &request : requests)
+        {
+            auto it = keyPairs.find(getKeyID(request.publicKey));
+            if (it == keyPairs.end())
+            {
+                std::cerr << "No secret key for " << request.name << " of transaction " << request.txIdx << std::endl;
+                return false;
+            }
+            const Signature signature = eddsa.sign(it->second, request.message, NativeEdDSA::randomScalar(rng));
+            if (request.txIdx < block["transactions"].size())
+            {
+                block["transactions"][request.txIdx]["witness"][request.name] = toJSON(signature);
+            }
+            else
+            {
+                block[request.name] = toJSON(signature);
+            }
+        }
+        return true;
+    }
+
+  private:
+    std::mt19937_64 rng;
+    unsigned int numAccounts;
+    unsigned int numAmmAccounts;
+    unsigned int numTokens;
+    unsigned int timestamp;
+    unsigned int protocolTakerFeeBips;
+    unsigned int protocolMakerFeeBips;
+    unsigned int operatorAccountID;
+    FieldT exchange;
+    std::map<std::string, double> weights;
+
+    NativeEdDSA eddsa;
+    // All keys ever used, old keys are kept after an account update
+    std::map<std::string, KeyPair> keyPairs;
+
+    NativeMerkleTree accountsTree;
+    std::unordered_map<uint64_t, NativeAccount> accounts;
+    std::unordered_map<uint64_t, uint64_t> nextStorageIDs;
+    std::unordered_map<uint64_t, uint64_t> nextNftTokenIDs;
+    unsigned int numConditionalTransactions;
+
+    static const std::vector<FieldT> &getEmptyHashes()
+    {
+        static const std::vector<FieldT> hashes =
+          NativeMerkleTree::createEmptyHashes(TREE_DEPTH_ACCOUNTS, hashLeaf(NativeAccount().getLeaf()));
+        return hashes;
+    }
+
+    static std::string getKeyID(const jubjub::EdwardsPoint &publicKey)
+    {
+        return fieldToString(publicKey.x) + "." + fieldToString(publicKey.y);
+    }
+
+    static unsigned int getFirstUserAccountID()
+    {
+        return 2;
+    }
+
+    unsigned int getFirstAmmAccountID() const
+    {
+        return getFirstUserAccountID() + numAccounts;
+    }
+
+    // Converts the weights to transaction counts (largest remainder) and shuffles the transactions
+    bool pickTypes(unsigned int blockSize, std::vector<std::string> &types)
+    {
+        const std::vector<std::string> supported = getSupportedTypes();
+        double total = 0.0;
+        for (const auto &weight : weights)
+        {
+            if (std::find(supported.begin(), supported.end(), weight.first) == supported.end())
+            {
+                std::cerr << "Unsupported transaction type: " << weight.first << ". Supported types:";
+                for (const std::string &type : supported)
+                {
+                    std::cerr << " " << type;
+                }
+                std::cerr << std::endl;
+                return false;
+            }
+            total += std::max(weight.second, 0.0);
+        }
+        if (total <= 0.0)
+        {
+            std::cerr << "The transaction mix needs at least one transaction type with a positive weight" << std::endl;
+            return false;
+        }
+        const bool hasTrades = weights.count("spotTrade") > 0 || weights.count("ammSwap") > 0;
+        if (numAccounts < 2 || (hasTrades && numTokens < 2) || numTokens < 1)
+        {
+            std::cerr << "The transaction mix needs at least 2 accounts and 2 tokens for trades" << std::endl;
+            return false;
+        }
+        if (weights.count("ammSwap") > 0 && numAmmAccounts < 1)
+        {
+            std::cerr << "The transaction mix needs at least 1 AMM account for AMM swaps" << std::endl;
+            return false;
+        }
+
+        std::vector<std::pair<double, std::string>> remainders;
+        for (const auto &weight : weights)
+        {
+            const double exact = blockSize * std::max(weight.second, 0.0) / total;
+            const unsigned int count = (unsigned int)exact;
+            types.insert(types.end(), count, weight.first);
+            remainders.push_back({exact - count, weight.first});
+        }
+        std::stable_sort(
+          remainders.begin(),
+          remainders.end(),
+          [](const std::pair<double, std::string> &a, const std::pair<double, std::string> &b) {
+              return a.first > b.first;
+          });
+        for (unsigned int i = 0; types.size() < blockSize; i++)
+        {
+            types.push_back(remainders[i % remainders.size()].second);
+        }
+        std::shuffle(types.begin(), types.end(), rng);
+
+        std::cout << "Transactions:";
+        for (const auto &weight : weights)
+        {
+            std::cout << " " << weight.first << " " << std::count(types.begin(), types.end(), weight.first);
+        }
+        std::cout << std::endl;
+        return true;
+    }
+
+    uint64_t randomInt(uint64_t min, uint64_t max)
+    {
+        return std::uniform_int_distribution<uint64_t>(min, max)(rng);
+    }
+
+    FieldT randomBits(unsigned int numBits)
+    {
+        FieldT value = FieldT::zero();
+        for (unsigned int i = 0; i < numBits; i++)
+        {
+            value = value + value + (randomInt(0, 1) ? FieldT::one() : FieldT::zero());
+        }
+        return value;
+    }
+
+    // An amount that can be represented exactly in `encoding`, small compared to the initial balances
+    FieldT randomAmount(const FloatEncoding &encoding)
+    {
+        const uint64_t mantissa = randomInt(1, (1 << encoding.numBitsMantissa) - 1);
+        return FieldT(mantissa) * FieldT("1000000000000");
+    }
+
+    uint64_t randomUserAccountID()
+    {
+        return randomInt(getFirstUserAccountID(), getFirstUserAccountID() + numAccounts - 1);
+    }
+
+    uint64_t randomAmmAccountID()
+    {
+        return randomInt(getFirstAmmAccountID(), getFirstAmmAccountID() + numAmmAccounts - 1);
+    }
+
+    uint64_t randomTokenID()
+    {
+        return randomInt(0, numTokens - 1);
+    }
+
+    uint64_t nextStorageID(uint64_t accountID)
+    {
+        return nextStorageIDs[accountID]++;
+    }
+
+    // Every NFT is minted in a new token slot of the account
+    uint64_t nextNftTokenID(uint64_t accountID)
+    {
+        return NFT_TOKEN_ID_START + nextNftTokenIDs[accountID]++;
+    }
+
+    KeyPair createKeyPair()
+    {
+        const KeyPair keyPair = eddsa.createKeyPair(NativeEdDSA::randomScalar(rng));
+        keyPairs[getKeyID(keyPair.publicKey)] = keyPair;
+        return keyPair;
+    }
+
+    NativeAccount &getAccount(uint64_t accountID)
+    {
+        return accounts[accountID];
+    }
+
+    // An AMM account is created when `feeBipsAMM` is not 0, its virtual balances are set to `balance`
+    void createAccount(
+      uint64_t accountID,
+      const FieldT &owner,
+      const jubjub::EdwardsPoint &publicKey,
+      const FieldT &balance,
+      unsigned int feeBipsAMM = 0)
+    {
+        NativeAccount &account = getAccount(accountID);
+        account.owner = owner;
+        account.publicKey = publicKey;
+        account.feeBipsAMM = FieldT(feeBipsAMM);
+        if (balance != FieldT::zero())
+        {
+            for (uint64_t tokenID = 0; tokenID < numTokens; tokenID++)
+            {
+                account.getBalance(tokenID).balance = balance;
+                account.getBalance(tokenID).weightAMM = (feeBipsAMM != 0) ? balance : FieldT::zero();
+                account.balancesTree.update(tokenID, hashLeaf(account.getBalance(tokenID).getLeaf()));
+            }
+        }
+        accountsTree.update(accountID, hashLeaf(account.getLeaf()));
+    }
+
+    json beginAccountUpdate(uint64_t accountID)
+    {
+        json update;
+        update["accountID"] = accountID;
+        update["proof"] = toJSON(accountsTree.createProof(accountID));
+        update["rootBefore"] = fieldToString(accountsTree.getRoot());
+        update["before"] = toJSON(getAccount(accountID).getLeaf());
+        return update;
+    }
+
+    json endAccountUpdate(uint64_t accountID, json &update)
+    {
+        const AccountLeaf leaf = getAccount(accountID).getLeaf();
+        accountsTree.update(accountID, hashLeaf(leaf));
+        update["rootAfter"] = fieldToString(accountsTree.getRoot());
+        update["after"] = toJSON(leaf);
+        return update;
+    }
+
+    // Updates the balance of `tokenID`, `change` modifies the balance before the leaf is updated
+    template <typename F> json updateBalance(NativeAccount &account, uint64_t tokenID, F change)
+    {
+        NativeBalance &balance = account.getBalance(tokenID);
+        json update;
+        update["tokenID"] = tokenID;
+        update["proof"] = toJSON(account.balancesTree.createProof(tokenID));
+        update["rootBefore"] = fieldToString(account.balancesTree.getRoot());
+        update["before"] = toJSON(balance.getLeaf());
+        change(balance);
+        const BalanceLeaf leaf = balance.getLeaf();
+        account.balancesTree.update(tokenID, hashLeaf(leaf));
+        update["rootAfter"] = fieldToString(account.balancesTree.getRoot());
+        update["after"] = toJSON(leaf);
+        return update;
+    }
+
+    json updateBalance(NativeAccount &account, uint64_t tokenID, const FieldT &delta)
+    {
+        return updateBalance(account, tokenID, [&](NativeBalance &balance) { balance.balance += delta; });
+    }
+
+    json updateStorage(NativeBalance &balance, uint64_t storageID, const FieldT &data)
+    {
+        const uint64_t slot = storageID % NUM_STORAGE_SLOTS;
+        json update;
+        update["storageID"] = std::to_string(storageID);
+        update["proof"] = toJSON(balance.storageTree.createProof(slot));
+        update["rootBefore"] = fieldToString(balance.storageTree.getRoot());
+        update["before"] = toJSON(balance.getStorage(slot));
+        const StorageLeaf leaf{data, FieldT(storageID)};
+        balance.storage[slot] = leaf;
+        balance.storageTree.update(slot, hashLeaf(leaf));
+        update["rootAfter"] = fieldToString(balance.storageTree.getRoot());
+        update["after"] = toJSON(leaf);
+        return update;
+    }
+
+    void updateAccount(const TransactionChanges::Account &changes, const std::string &suffix, json &witness)
+    {
+        NativeAccount &account = getAccount(changes.accountID);
+        json update = beginAccountUpdate(changes.accountID);
+
+        json storageUpdate;
+        const json balanceUpdateS = updateBalance(account, changes.tokenS, [&](NativeBalance &balance) {
+            uint64_t storageID = changes.storageID;
+            FieldT data = changes.storageData;
+            if (!changes.setStorage)
+            {
+                const StorageLeaf leaf = balance.getStorage(0);
+                storageID = fieldToUint64(leaf.storageID);
+                data = leaf.data;
+            }
+            storageUpdate = updateStorage(balance, storageID, data);
+            balance.balance += changes.deltaS;
+            if (changes.setWeightS)
+            {
+                balance.weightAMM = changes.weightS;
+            }
+        });
+        witness["storageUpdate_" + suffix] = storageUpdate;
+        witness["balanceUpdateS_" + suffix] = balanceUpdateS;
+        witness["balanceUpdateB_" + suffix] = updateBalance(account, changes.tokenB, [&](NativeBalance &balance) {
+            balance.balance += changes.deltaB;
+            if (changes.setWeightB)
+            {
+                balance.weightAMM = changes.weightB;
+            }
+        });
+
+        if (changes.setOwner)
+        {
+            account.owner = changes.owner;
+        }
+        if (changes.setPublicKey)
+        {
+            account.publicKey = changes.publicKey;
+        }
+        account.nonce += FieldT(changes.nonceIncrement);
+        witness["accountUpdate_" + suffix] = endAccountUpdate(changes.accountID, update);
+    }
+
+    json execute(const TransactionChanges &changes)
+    {
+        json witness;
+        updateAccount(changes.accountA, "A", witness);
+        updateAccount(changes.accountB, "B", witness);
+
+        NativeAccount &operatorAccount = getAccount(operatorAccountID);
+        json update = beginAccountUpdate(operatorAccountID);
+        witness["balanceUpdateB_O"] = updateBalance(operatorAccount, changes.accountB.tokenB, changes.deltaB_O);
+        witness["balanceUpdateA_O"] = updateBalance(operatorAccount, changes.accountA.tokenB, changes.deltaA_O);
+        witness["accountUpdate_O"] = endAccountUpdate(operatorAccountID, update);
+
+        NativeAccount &protocolAccount = getAccount(0);
+        witness["balanceUpdateB_P"] = updateBalance(protocolAccount, changes.accountB.tokenB, changes.deltaB_P);
+        witness["balanceUpdateA_P"] = updateBalance(protocolAccount, changes.accountA.tokenB, changes.deltaA_P);
+
+        numConditionalTransactions += changes.numConditionalTransactions;
+        witness["numConditionalTransactionsAfter"] = numConditionalTransactions;
+        return witness;
+    }
+
+    json generateTransaction(const std::string &type)
+    {
+        TransactionChanges changes;
+        json tx;
+        // The key of the transaction data in the block
+        std::string key = type;
+        if (type == "deposit")
+        {
+            tx = generateDeposit(changes);
+        }
+        else if (type == "transfer")
+        {
+            tx = generateTransfer(changes);
+        }
+        else if (type == "withdraw")
+        {
+            tx = generateWithdrawal(changes);
+        }
+        else if (type == "accountUpdate")
+        {
+            tx = generateAccountUpdate(changes);
+        }
+        else if (type == "spotTrade")
+        {
+            tx = generateSpotTrade(changes, false);
+        }
+        else if (type == "ammSwap")
+        {
+            tx = generateSpotTrade(changes, true);
+            key = "spotTrade";
+        }
+        else if (type == "nftMint")
+        {
+            tx = generateNftMint(changes);
+        }
+        else
+        {
+            tx["txType"] = "Noop";
+        }
+
+        json transaction;
+        transaction["witness"] = execute(changes);
+        transaction[key] = tx;
+        return transaction;
+    }
+
+    json generateDeposit(TransactionChanges &changes)
+    {
+        const uint64_t accountID = randomUserAccountID();
+        const uint64_t tokenID = randomTokenID();
+        const FieldT amount = randomAmount(Float24Encoding);
+        const FieldT owner = getAccount(accountID).owner;
+
+        changes.accountA.accountID = accountID;
+        changes.accountA.setOwner = true;
+        changes.accountA.owner = owner;
+        changes.accountA.tokenS = tokenID;
+        changes.accountA.deltaS = amount;
+        changes.numConditionalTransactions = 1;
+
+        json tx;
+        tx["txType"] = "Deposit";
+        tx["owner"] = fieldToString(owner);
+        tx["accountID"] = accountID;
+        tx["tokenID"] = tokenID;
+        tx["amount"] = fieldToString(amount);
+        return tx;
+    }
+
+    json generateTransfer(TransactionChanges &changes)
+    {
+        const uint64_t fromAccountID = randomUserAccountID();
+        uint64_t toAccountID = randomUserAccountID();
+        while (toAccountID == fromAccountID)
+        {
+            toAccountID = randomUserAccountID();
+        }
+        const uint64_t tokenID = randomTokenID();
+        const uint64_t feeTokenID = randomTokenID();
+        const FieldT amount = randomAmount(Float24Encoding);
+        const FieldT fee = randomAmount(Float16Encoding);
+        const uint64_t storageID = nextStorageID(fromAccountID);
+        const FieldT from = getAccount(fromAccountID).owner;
+        const FieldT to = getAccount(toAccountID).owner;
+
+        changes.accountA.accountID = fromAccountID;
+        changes.accountA.tokenS = tokenID;
+        changes.accountA.deltaS = -amount;
+        changes.accountA.tokenB = feeTokenID;
+        changes.accountA.deltaB = -fee;
+        changes.accountA.setStorage = true;
+        changes.accountA.storageID = storageID;
+        changes.accountA.storageData = FieldT::one();
+        changes.accountB.accountID = toAccountID;
+        changes.accountB.setOwner = true;
+        changes.accountB.owner = to;
+        changes.accountB.tokenB = tokenID;
+        changes.accountB.deltaB = amount;
+        changes.deltaA_O = fee;
+
+        json tx;
+        tx["txType"] = "Transfer";
+        tx["type"] = 0;
+        tx["fromAccountID"] = fromAccountID;
+        tx["toAccountID"] = toAccountID;
+        tx["tokenID"] = tokenID;
+        tx["toTokenID"] = tokenID;
+        tx["amount"] = fieldToString(amount);
+        tx["feeTokenID"] = feeTokenID;
+        tx["fee"] = fieldToString(fee);
+        tx["maxFee"] = fieldToString(fee);
+        tx["storageID"] = std::to_string(storageID);
+        tx["from"] = fieldToString(from);
+        tx["to"] = fieldToString(to);
+        tx["validUntil"] = 0xFFFFFFFF;
+        tx["dualAuthorX"] = "0";
+        tx["dualAuthorY"] = "0";
+        tx["payerToAccountID"] = toAccountID;
+        tx["payerTo"] = fieldToString(to);
+        tx["payeeToAccountID"] = toAccountID;
+        tx["putAddressesInDA"] = false;
+        return tx;
+    }
+
+    json generateWithdrawal(TransactionChanges &changes)
+    {
+        const uint64_t accountID = randomUserAccountID();
+        const uint64_t tokenID = randomTokenID();
+        const uint64_t feeTokenID = randomTokenID();
+        const FieldT amount = randomAmount(Float24Encoding);
+        const FieldT fee = randomAmount(Float16Encoding);
+        const uint64_t storageID = nextStorageID(accountID);
+
+        changes.accountA.accountID = accountID;
+        changes.accountA.tokenS = tokenID;
+        changes.accountA.deltaS = -amount;
+        changes.accountA.tokenB = feeTokenID;
+        changes.accountA.deltaB = -fee;
+        changes.accountA.setStorage = true;
+        changes.accountA.storageID = storageID;
+        changes.accountA.storageData = FieldT::one();
+        changes.accountB.tokenB = tokenID;
+        changes.deltaA_O = fee;
+        changes.numConditionalTransactions = 1;
+
+        json tx;
+        tx["txType"] = "Withdraw";
+        tx["type"] = 0;
+        tx["owner"] = fieldToString(getAccount(accountID).owner);
+        tx["accountID"] = accountID;
+        tx["storageID"] = std::to_string(storageID);
+        tx["tokenID"] = tokenID;
+        tx["amount"] = fieldToString(amount);
+        tx["feeTokenID"] = feeTokenID;
+        tx["fee"] = fieldToString(fee);
+        tx["maxFee"] = fieldToString(fee);
+        tx["onchainDataHash"] = "0";
+        tx["validUntil"] = 0xFFFFFFFF;
+        return tx;
+    }
+
+    // Sets a new key, the transaction is signed with the current key
+    json generateAccountUpdate(TransactionChanges &changes)
+    {
+        const uint64_t accountID = randomUserAccountID();
+        const uint64_t feeTokenID = randomTokenID();
+        const FieldT fee = randomAmount(Float16Encoding);
+        const NativeAccount &account = getAccount(accountID);
+        const KeyPair keyPair = createKeyPair();
+
+        changes.accountA.accountID = accountID;
+        changes.accountA.setOwner = true;
+        changes.accountA.owner = account.owner;
+        changes.accountA.setPublicKey = true;
+        changes.accountA.publicKey = keyPair.publicKey;
+        changes.accountA.nonceIncrement = 1;
+        changes.accountA.tokenS = feeTokenID;
+        changes.accountA.deltaS = -fee;
+        changes.accountA.tokenB = feeTokenID;
+        changes.deltaA_O = fee;
+
+        json tx;
+        tx["txType"] = "AccountUpdate";
+        tx["type"] = 0;
+        tx["owner"] = fieldToString(account.owner);
+        tx["accountID"] = accountID;
+        tx["nonce"] = fieldToString(account.nonce);
+        tx["validUntil"] = 0xFFFFFFFF;
+        tx["publicKeyX"] = fieldToString(keyPair.publicKey.x);
+        tx["publicKeyY"] = fieldToString(keyPair.publicKey.y);
+        tx["feeTokenID"] = feeTokenID;
+        tx["fee"] = fieldToString(fee);
+        tx["maxFee"] = fieldToString(fee);
+        return tx;
+    }
+
+    json createOrder(uint64_t accountID, uint64_t tokenS, uint64_t tokenB, const FieldT &amountS, const FieldT &amountB)
+    {
+        json order;
+        order["storageID"] = std::to_string(nextStorageID(accountID));
+        order["accountID"] = accountID;
+        order["tokenS"] = tokenS;
+        order["tokenB"] = tokenB;
+        order["amountS"] = fieldToString(amountS);
+        order["amountB"] = fieldToString(amountB);
+        order["validUntil"] = 0xFFFFFFFF;
+        order["maxFeeBips"] = 20;
+        order["feeBips"] = randomInt(0, 20);
+        order["fillAmountBorS"] = randomInt(0, 1) == 1;
+        order["taker"] = "0";
+        order["nftDataB"] = "0";
+        order["amm"] = false;
+        return order;
+    }
+
+    // The maximum amount an AMM sells for `amountIn`, the same calculation as CalcOutGivenInAMMGadget
+    static FieldT calcOutGivenIn(
+      const FieldT &balanceIn,
+      const FieldT &balanceOut,
+      const FieldT &feeBips,
+      const FieldT &amountIn)
+    {
+        const BigInt fixedBase(FIXED_BASE);
+        const BigInt fee = toBigInt(amountIn) * toBigInt(feeBips) / BigInt(10000);
+        const BigInt y = toBigInt(balanceIn) * fixedBase / (toBigInt(balanceIn) + toBigInt(amountIn) - fee);
+        const BigInt amountOut = toBigInt(balanceOut) * (fixedBase - y) / fixedBase;
+        return FieldT(amountOut.to_string().c_str());
+    }
+
+    // Two orders with opposite amounts that fill each other completely, so the fills are exact in Float24.
+    // With `amm` order B is the order of an AMM, that sells the maximum amount on its curve.
+    json generateSpotTrade(TransactionChanges &changes, bool amm)
+    {
+        const uint64_t accountA = randomUserAccountID();
+        uint64_t accountB = amm ? randomAmmAccountID() : randomUserAccountID();
+        while (accountB == accountA)
+        {
+            accountB = randomUserAccountID();
+        }
+        const uint64_t tokenA = randomTokenID();
+        uint64_t tokenB = randomTokenID();
+        while (tokenB == tokenA)
+        {
+            tokenB = randomTokenID();
+        }
+        const FieldT fillA = randomAmount(Float24Encoding);
+        FieldT fillB = randomAmount(Float24Encoding);
+        if (amm)
+        {
+            NativeAccount &ammAccount = getAccount(accountB);
+            const FieldT amountOut = calcOutGivenIn(
+              ammAccount.getBalance(tokenA).weightAMM,
+              ammAccount.getBalance(tokenB).weightAMM,
+              ammAccount.feeBipsAMM,
+              fillA);
+            fillB = roundToFloatValue(amountOut, Float24Encoding);
+        }
+
+        json tx;
+        tx["txType"] = "SpotTrade";
+        tx["orderA"] = createOrder(accountA, tokenA, tokenB, fillA, fillB);
+        tx["orderB"] = createOrder(accountB, tokenB, tokenA, fillB, fillA);
+        if (amm)
+        {
+            // AMM orders don't pay fees and are not signed
+            tx["orderB"]["amm"] = true;
+            tx["orderB"]["feeBips"] = 0;
+        }
+        tx["fFillS_A"] = toFloat(fillA, Float24Encoding);
+        tx["fFillS_B"] = toFloat(fillB, Float24Encoding);
+
+        // Fees are paid in the bought tokens
+        auto calculateFee = [](const FieldT &amount, unsigned int bips, unsigned int divisor) {
+            const BigInt fee = toBigInt(amount) * BigInt((long long)bips) / BigInt((long long)divisor);
+            return FieldT(fee.to_string().c_str());
+        };
+        const FieldT fee_BA = calculateFee(fillB, tx["orderA"]["feeBips"].get<unsigned int>(), 10000);
+        const FieldT fee_BB = calculateFee(fillA, tx["orderB"]["feeBips"].get<unsigned int>(), 10000);
+        const FieldT protocolFee_BA = calculateFee(fillB, protocolTakerFeeBips, 100000);
+        const FieldT protocolFee_BB = calculateFee(fillA, protocolMakerFeeBips, 100000);
+
+        auto setOrderChanges = [&](
+                                 const json &order,
+                                 const FieldT &fillS,
+                                 const FieldT &fillB,
+                                 const FieldT &fee,
+                                 TransactionChanges::Account &account) {
+            account.accountID = order["accountID"].get<uint64_t>();
+            account.tokenS = order["tokenS"].get<uint64_t>();
+            account.deltaS = -fillS;
+            account.tokenB = order["tokenB"].get<uint64_t>();
+            account.deltaB = fillB - fee;
+            account.setStorage = true;
+            account.storageID = std::stoull(order["storageID"].get<std::string>());
+            account.storageData = order["fillAmountBorS"].get<bool>() ? fillB : fillS;
+            // The virtual balances of an AMM follow the trade
+            if (order["amm"].get<bool>())
+            {
+                NativeAccount &ammAccount = getAccount(account.accountID);
+                account.setWeightS = true;
+                account.weightS = ammAccount.getBalance(account.tokenS).weightAMM - fillS;
+                account.setWeightB = true;
+                account.weightB = ammAccount.getBalance(account.tokenB).weightAMM + fillB;
+            }
+        };
+        setOrderChanges(tx["orderA"], fillA, fillB, fee_BA, changes.accountA);
+        setOrderChanges(tx["orderB"], fillB, fillA, fee_BB, changes.accountB);
+        changes.deltaA_O = fee_BA - protocolFee_BA;
+        changes.deltaB_O = fee_BB - protocolFee_BB;
+        changes.deltaA_P = protocolFee_BA;
+        changes.deltaB_P = protocolFee_BB;
+        return tx;
+    }
+
+    // Mints an NFT on L2 to the minter's own account (not conditional), for a token contract owned by another account
+    json generateNftMint(TransactionChanges &changes)
+    {
+        const uint64_t minterAccountID = randomUserAccountID();
+        uint64_t tokenAccountID = randomUserAccountID();
+        while (tokenAccountID == minterAccountID)
+        {
+            tokenAccountID = randomUserAccountID();
+        }
+        const uint64_t feeTokenID = randomTokenID();
+        const uint64_t toTokenID = nextNftTokenID(minterAccountID);
+        const FieldT fee = randomAmount(Float16Encoding);
+        const FieldT amount(randomInt(1, 100));
+        const uint64_t storageID = nextStorageID(minterAccountID);
+        const FieldT minter = getAccount(minterAccountID).owner;
+        const FieldT tokenAddress = getAccount(tokenAccountID).owner;
+        const unsigned int nftType = randomInt(0, 1);
+        const unsigned int creatorFeeBips = randomInt(0, 50);
+        const FieldT nftIDLo = randomBits(NUM_BITS_NFT_ID / 2);
+        const FieldT nftIDHi = randomBits(NUM_BITS_NFT_ID / 2);
+        // The same hash as NftDataGadget
+        const FieldT nftData =
+          PoseidonNative_6::hash({minter, FieldT(nftType), tokenAddress, nftIDLo, nftIDHi, FieldT(creatorFeeBips)});
+
+        changes.accountA.accountID = minterAccountID;
+        changes.accountA.tokenS = feeTokenID;
+        changes.accountA.deltaS = -fee;
+        changes.accountA.setStorage = true;
+        changes.accountA.storageID = storageID;
+        changes.accountA.storageData = FieldT::one();
+        changes.accountA.tokenB = toTokenID;
+        changes.accountA.deltaB = amount;
+        changes.accountA.setWeightB = true;
+        changes.accountA.weightB = nftData;
+        changes.accountB.accountID = tokenAccountID;
+        changes.accountB.tokenS = toTokenID;
+        changes.accountB.tokenB = feeTokenID;
+        changes.deltaB_O = fee;
+
+        json tx;
+        tx["txType"] = "NftMint";
+        tx["type"] = 0;
+        tx["minterAccountID"] = minterAccountID;
+        tx["tokenAccountID"] = tokenAccountID;
+        tx["nftType"] = nftType;
+        tx["tokenAddress"] = fieldToString(tokenAddress);
+        tx["nftIDLo"] = fieldToString(nftIDLo);
+        tx["nftIDHi"] = fieldToString(nftIDHi);
+        tx["creatorFeeBips"] = creatorFeeBips;
+        tx["amount"] = fieldToString(amount);
+        tx["feeTokenID"] = feeTokenID;
+        tx["fee"] = fieldToString(fee);
+        tx["maxFee"] = fieldToString(fee);
+        tx["validUntil"] = 0xFFFFFFFF;
+        tx["toAccountID"] = minterAccountID;
+        tx["toTokenID"] = toTokenID;
+        tx["to"] = fieldToString(minter);
+        tx["storageID"] = storageID;
+        return tx;
+    }
+};
+
+} // namespace Loopring
+
+#endif
@@ -0,0 +1,327 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _BLOCKREADER_H_
+#define _BLOCKREADER_H_
+
+#include "Data.h"
+
+#include <algorithm>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace Loopring
+{
+
+// Reads a block from a stream without first building the complete JSON document.
+// Every transaction is decoded and passed on as soon as it is parsed.
+class BlockReader
+{
+  public:
+    // Both callbacks return false to stop reading
+    typedef std::function<bool(const json &header)> HeaderCallbackT;
+    typedef std::function<bool(unsigned int index, std::unique_ptr<UniversalTransaction> transaction)>
+      TransactionCallbackT;
+
+    // The block data needed before any transaction can be processed.
+    // The block signature is only needed after all transactions are processed.
+    static const std::vector<std::string> &headerFields()
+    {
+        static const std::vector<std::string> fields = {
+          "blockSize",
+          "exchange",
+          "merkleRootBefore",
+          "merkleRootAfter",
+          "timestamp",
+          "protocolTakerFeeBips",
+          "protocolMakerFeeBips",
+          "accountUpdate_P",
+          "operatorAccountID",
+          "accountUpdate_O"};
+        return fields;
+    }
+
+    // `onHeader` is called once all header fields are known, `onTransaction` is called
+    // for every transaction in order. Transactions that are parsed before the header is
+    // complete are kept until the header is known. Blocks with the header fields before
+    // the transactions can therefore be processed while they are being read.
+    // `header` contains all block data except the transactions after reading.
+    // Returns false if the block is invalid or if a callback stopped the reading.
+    static bool read(
+      std::istream &stream,
+      const HeaderCallbackT &onHeader,
+      const TransactionCallbackT &onTransaction,
+      json &header)
+    {
+        std::string key;
+        bool headerDone = false;
+        bool stopped = false;
+        unsigned int numTransactions = 0;
+        std::vector<std::unique_ptr<UniversalTransaction>> pending;
+
+        auto isHeaderComplete = [&header]() -> bool {
+            for (const std::string &field : headerFields())
+            {
+                if (!header.contains(field))
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        json::parser_callback_t callback = [&](int depth, json::parse_event_t event, json &parsed) -> bool {
+            if (stopped)
+            {
+                // Don't read the rest of the block
+                throw StopReading();
+            }
+            if (depth == 1 && event == json::parse_event_t::key)
+            {
+                key = parsed.get<std::string>();
+                return true;
+            }
+            if (depth == 2 && event == json::parse_event_t::object_end && key == "transactions")
+            {
+                std::unique_ptr<UniversalTransaction> transaction(
+                  new UniversalTransaction(parsed.get<UniversalTransaction>()));
+                if (headerDone)
+                {
+                    stopped = !onTransaction(numTransactions, std::move(transaction));
+                }
+                else
+                {
+                    pending.push_back(std::move(transaction));
+                }
+                numTransactions++;
+                return false;
+            }
+            if (depth == 1 && (event == json::parse_event_t::value || event == json::parse_event_t::object_end))
+            {
+                header[key] = std::move(parsed);
+                if (!headerDone && isHeaderComplete())
+                {
+                    headerDone = true;
+                    stopped = !onHeader(header);
+                    for (unsigned int i = 0; i < pending.size() && !stopped; i++)
+                    {
+                        stopped = !onTransaction(i, std::move(pending[i]));
+                    }
+                    pending.clear();
+                }
+                return false;
+            }
+            return true;
+        };
+
+        try
+        {
+            json::parse(stream, callback);
+        }
+        catch (const StopReading &)
+        {
+            return false;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Failed to read block: " << e.what() << std::endl;
+            return false;
+        }
+        if (!headerDone)
+        {
+            std::cerr << "Failed to read block: incomplete block data" << std::endl;
+            return false;
+        }
+        return !stopped;
+    }
+
+    // Only reads the block data without the transactions.
+    // The top level of the block is scanned without parsing the values that are not needed, so the
+    // transactions are skipped over without being parsed. Reading stops as soon as all `fields` are
+    // known (all block data is read when empty), the rest of the block isn't read at all.
+    // Returns null if the block is invalid.
+    static json readHeader(std::istream &stream, const std::vector<std::string> &fields = {})
+    {
+        std::streambuf &buffer = *stream.rdbuf();
+        json header = json::object();
+        auto isComplete = [&]() -> bool {
+            for (const std::string &field : fields)
+            {
+                if (!header.contains(field))
+                {
+                    return false;
+                }
+            }
+            return fields.size() > 0;
+        };
+        try
+        {
+            expect(buffer, '{');
+            if (skipWhitespace(buffer) == '}')
+            {
+                return header;
+            }
+            while (true)
+            {
+                expect(buffer, '"');
+                std::string key;
+                skipString(buffer, &key);
+                expect(buffer, ':');
+                bool needed = (fields.size() == 0) ? (key != "transactions")
+                                                   : (std::find(fields.begin(), fields.end(), key) != fields.end());
+                if (needed)
+                {
+                    std::string value;
+                    skipValue(buffer, &value);
+                    header[key] = json::parse(value);
+                    if (isComplete())
+                    {
+                        return header;
+                    }
+                }
+                else
+                {
+                    skipValue(buffer, nullptr);
+                }
+                int c = skipWhitespace(buffer);
+                buffer.sbumpc();
+                if (c == '}')
+                {
+                    return header;
+                }
+                if (c != ',')
+                {
+                    throw std::runtime_error("expected ',' or '}'");
+                }
+            }
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Failed to read block: " << e.what() << std::endl;
+            return json();
+        }
+    }
+
+  private:
+    struct StopReading
+    {
+    };
+
+    // Returns the next character that isn't whitespace without consuming it
+    static int skipWhitespace(std::streambuf &buffer)
+    {
+        int c = buffer.sgetc();
+        while (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+        {
+            c = buffer.snextc();
+        }
+        if (c == std::char_traits<char>::eof())
+        {
+            throw std::runtime_error("unexpected end of block data");
+        }
+        return c;
+    }
+
+    static void expect(std::streambuf &buffer, char expected)
+    {
+        if (skipWhitespace(buffer) != expected)
+        {
+            throw std::runtime_error(std::string("expected '") + expected + "'");
+        }
+        buffer.sbumpc();
+    }
+
+    // Skips the rest of a string (the opening quote is already read).
+    // The raw characters (without the quotes) are appended to `text` when set.
+    static void skipString(std::streambuf &buffer, std::string *text)
+    {
+        while (true)
+        {
+            int c = buffer.sbumpc();
+            if (c == std::char_traits<char>::eof())
+            {
+                throw std::runtime_error("unexpected end of block data");
+            }
+            if (c == '"')
+            {
+                return;
+            }
+            if (text)
+            {
+                text->push_back(char(c));
+            }
+            if (c == '\\')
+            {
+                c = buffer.sbumpc();
+                if (c == std::char_traits<char>::eof())
+                {
+                    throw std::runtime_error("unexpected end of block data");
+                }
+                if (text)
+                {
+                    text->push_back(char(c));
+                }
+            }
+        }
+    }
+
+    // Skips a JSON value without parsing it, the raw text of the value is appended to `text` when set
+    static void skipValue(std::streambuf &buffer, std::string *text)
+    {
+        // The closing brackets of the objects and arrays the value is in
+        std::string closing;
+        int c = skipWhitespace(buffer);
+        do
+        {
+            c = buffer.sbumpc();
+            if (c == std::char_traits<char>::eof())
+            {
+                throw std::runtime_error("unexpected end of block data");
+            }
+            if (text)
+            {
+                text->push_back(char(c));
+            }
+            if (c == '"')
+            {
+                skipString(buffer, text);
+                if (text)
+                {
+                    text->push_back('"');
+                }
+            }
+            else if (c == '{' || c == '[')
+            {
+                closing.push_back((c == '{') ? '}' : ']');
+            }
+            else if (c == '}' || c == ']')
+            {
+                if (closing.empty() || closing.back() != c)
+                {
+                    throw std::runtime_error("unexpected end of value");
+                }
+                closing.pop_back();
+            }
+            else if (closing.empty())
+            {
+                // Numbers, true, false and null end at the next separator
+                c = buffer.sgetc();
+                while (c != ',' && c != '}' && c != ']' && c != ' ' && c != '\n' && c != '\r' && c != '\t' &&
+                       c != std::char_traits<char>::eof())
+                {
+                    if (text)
+                    {
+                        text->push_back(char(c));
+                    }
+                    c = buffer.snextc();
+                }
+            }
+        } while (!closing.empty());
+    }
+};
+
+} // namespace Loopring
+
+#endif
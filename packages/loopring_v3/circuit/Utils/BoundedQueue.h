@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _BOUNDEDQUEUE_H_
+#define _BOUNDEDQUEUE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace Loopring
+{
+
+// Thread safe FIFO queue with a maximum size.
+// `push` blocks while the queue is full, `pop` blocks while the queue is empty.
+// After `close` no new items can be pushed and `pop` returns false once the queue is empty.
+template <typename T> class BoundedQueue
+{
+  public:
+    BoundedQueue(size_t _capacity) : capacity(_capacity), closed(false)
+    {
+    }
+
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        notFull.wait(lock, [this]() { return items.size() < capacity || closed; });
+        if (closed)
+        {
+            return false;
+        }
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        notEmpty.wait(lock, [this]() { return !items.empty() || closed; });
+        if (items.empty())
+        {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return items.size();
+    }
+
+  private:
+    const size_t capacity;
+    bool closed;
+    std::deque<T> items;
+    std::mutex mtx;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+};
+
+} // namespace Loopring
+
+#endif
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _CONSTRAINTCHECKER_H_
+#define _CONSTRAINTCHECKER_H_
+
+#include "ethsnarks.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+using namespace ethsnarks;
+
+namespace Loopring
+{
+
+// Returns the first `maxFailures` constraints (in order) that are not satisfied by the witness in `pb`.
+// Same check as `pb.is_satisfied()`, but the constraints are checked in parallel in chunks and the
+// witness is not copied. Chunks after the last failure that is still needed are skipped.
+static std::vector<size_t> findUnsatisfiedConstraints(
+  const ProtoboardT &pb,
+  size_t maxFailures = 1,
+  size_t chunkSize = 4096)
+{
+    const auto &constraints = pb.constraint_system.constraints;
+    const auto &assignment = pb.values;
+    const unsigned int numChunks = (constraints.size() + chunkSize - 1) / chunkSize;
+
+    std::vector<std::vector<size_t>> failures(numChunks);
+    // Constraints from this index on cannot be in the result anymore
+    std::atomic<size_t> limit(constraints.size());
+#ifdef MULTICORE
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (unsigned int c = 0; c < numChunks; c++)
+    {
+        const size_t end = std::min((c + 1) * chunkSize, constraints.size());
+        for (size_t i = c * chunkSize; i < end && i < limit; i++)
+        {
+            const auto &constraint = constraints[i];
+            const FieldT valueA = constraint->getA().evaluate(assignment);
+            const FieldT valueB = constraint->getB().evaluate(assignment);
+            const FieldT valueC = constraint->getC().evaluate(assignment);
+            if (valueA * valueB != valueC)
+            {
+                failures[c].push_back(i);
+                if (failures[c].size() == maxFailures)
+                {
+                    size_t current = limit;
+                    while (i + 1 < current && !limit.compare_exchange_weak(current, i + 1))
+                    {
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    std::vector<size_t> result;
+    for (const std::vector<size_t> &chunkFailures : failures)
+    {
+        for (size_t i = 0; i < chunkFailures.size() && result.size() < maxFailures; i++)
+        {
+            result.push_back(chunkFailures[i]);
+        }
+    }
+    return result;
+}
+
+// The annotation of the gadget that created the constraint.
+// Only available when the constraints were generated in a DEBUG build.
+static std::string getConstraintAnnotation(const ProtoboardT &pb, size_t index)
+{
+#ifdef DEBUG
+    auto it = pb.constraint_system.constraint_annotations.find(index);
+    if (it != pb.constraint_system.constraint_annotations.end())
+    {
+        return it->second;
+    }
+#endif
+    return "";
+}
+
+} // namespace Loopring
+
+#endif
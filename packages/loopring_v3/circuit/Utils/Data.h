@@ -174,6 +174,22 @@ enum class TransactionType
     COUNT
 };
 
+static const char *getTransactionTypeName(unsigned int type)
+{
+    static const char *names[] = {
+      "Noop",
+      "Deposit",
+      "Withdrawal",
+      "Transfer",
+      "SpotTrade",
+      "AccountUpdate",
+      "AmmUpdate",
+      "SignatureVerification",
+      "NftMint",
+      "NftData"};
+    return (type < (unsigned int)TransactionType::COUNT) ? names[type] : "Unknown";
+}
+
 class Proof
 {
   public:
@@ -321,6 +337,16 @@ static void from_json(const json &j, Signature &signature)
     signature.s = ethsnarks::FieldT(j.at("s").get<std::string>().c_str());
 }
 
+// A message that needs to be signed with the key of `publicKey` for the block to be valid.
+// `name` is the signature field of the transaction `txIdx`, the block signature uses txIdx == blockSize.
+struct SignatureRequest
+{
+    unsigned int txIdx;
+    std::string name;
+    ethsnarks::jubjub::EdwardsPoint publicKey;
+    ethsnarks::FieldT message;
+};
+
 class Order
 {
   public:
@@ -677,20 +703,53 @@ class UniversalTransaction
     NftData nftData;
 };
 
+// The dummy data of all tx types, only decoded a single time
+struct DummyTransactions
+{
+    SpotTrade spotTrade;
+    Transfer transfer;
+    Withdrawal withdraw;
+    Deposit deposit;
+    AccountUpdateTx accountUpdate;
+    AmmUpdate ammUpdate;
+    SignatureVerification signatureVerification;
+    NftMint nftMint;
+    NftData nftData;
+};
+
+static const DummyTransactions &getDummyTransactions()
+{
+    static const DummyTransactions dummies = []() {
+        DummyTransactions d;
+        d.spotTrade = dummySpotTrade.get<Loopring::SpotTrade>();
+        d.transfer = dummyTransfer.get<Loopring::Transfer>();
+        d.withdraw = dummyWithdraw.get<Loopring::Withdrawal>();
+        d.deposit = dummyDeposit.get<Loopring::Deposit>();
+        d.accountUpdate = dummyAccountUpdate.get<Loopring::AccountUpdateTx>();
+        d.ammUpdate = dummyAmmUpdate.get<Loopring::AmmUpdate>();
+        d.signatureVerification = dummySignatureVerification.get<Loopring::SignatureVerification>();
+        d.nftMint = dummyNftMint.get<Loopring::NftMint>();
+        d.nftData = dummyNftData.get<Loopring::NftData>();
+        return d;
+    }();
+    return dummies;
+}
+
 static void from_json(const json &j, UniversalTransaction &transaction)
 {
     transaction.witness = j.at("witness").get<Witness>();
 
     // Fill in dummy data for all tx types
-    transaction.spotTrade = dummySpotTrade.get<Loopring::SpotTrade>();
-    transaction.transfer = dummyTransfer.get<Loopring::Transfer>();
-    transaction.withdraw = dummyWithdraw.get<Loopring::Withdrawal>();
-    transaction.deposit = dummyDeposit.get<Loopring::Deposit>();
-    transaction.accountUpdate = dummyAccountUpdate.get<Loopring::AccountUpdateTx>();
-    transaction.ammUpdate = dummyAmmUpdate.get<Loopring::AmmUpdate>();
-    transaction.signatureVerification = dummySignatureVerification.get<Loopring::SignatureVerification>();
-    transaction.nftMint = dummyNftMint.get<Loopring::NftMint>();
-    transaction.nftData = dummyNftData.get<Loopring::NftData>();
+    const DummyTransactions &dummies = getDummyTransactions();
+    transaction.spotTrade = dummies.spotTrade;
+    transaction.transfer = dummies.transfer;
+    transaction.withdraw = dummies.withdraw;
+    transaction.deposit = dummies.deposit;
+    transaction.accountUpdate = dummies.accountUpdate;
+    transaction.ammUpdate = dummies.ammUpdate;
+    transaction.signatureVerification = dummies.signatureVerification;
+    transaction.nftMint = dummies.nftMint;
+    transaction.nftData = dummies.nftData;
 
     // Patch some of the dummy tx's so they are valid against the current state
     // Deposit
@@ -777,7 +836,8 @@ class Block
     std::vector<Loopring::UniversalTransaction> transactions;
 };
 
-static void from_json(const json &j, Block &block)
+// Reads all block data except the transactions and the signature
+static void blockHeaderFromJson(const json &j, Block &block)
 {
     block.exchange = ethsnarks::FieldT(j["exchange"].get<std::string>().c_str());
 
@@ -789,12 +849,16 @@ static void from_json(const json &j, Block &block)
     block.protocolTakerFeeBips = ethsnarks::FieldT(j["protocolTakerFeeBips"].get<unsigned int>());
     block.protocolMakerFeeBips = ethsnarks::FieldT(j["protocolMakerFeeBips"].get<unsigned int>());
 
-    block.signature = j.at("signature").get<Signature>();
-
     block.accountUpdate_P = j.at("accountUpdate_P").get<AccountUpdate>();
 
     block.operatorAccountID = ethsnarks::FieldT(j.at("operatorAccountID"));
     block.accountUpdate_O = j.at("accountUpdate_O").get<AccountUpdate>();
+}
+
+static void from_json(const json &j, Block &block)
+{
+    blockHeaderFromJson(j, block);
+    block.signature = j.at("signature").get<Signature>();
 
     // Read transactions
     json jTransactions = j["transactions"];
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _EDDSA_H_
+#define _EDDSA_H_
+
+#include "Data.h"
+#include "Poseidon.h"
+#include "Utils.h"
+
+#include "ethsnarks.hpp"
+#include "jubjub/point.hpp"
+
+#include <random>
+
+using namespace ethsnarks;
+
+namespace Loopring
+{
+
+// The order of the subgroup generated by the base point
+static const std::string JUBJUB_SUBGROUP_ORDER =
+  "2736030358979909402780800718157159386076813972158567259200215660948447373041";
+
+struct KeyPair
+{
+    FieldT secretKey;
+    jubjub::EdwardsPoint publicKey;
+};
+
+// EdDSA on Baby Jubjub with the message hashed with Poseidon, evaluated natively.
+// Signatures created here are valid for EdDSA_Poseidon (see SignatureGadgets.h):
+// B*s == R + A*H(R, A, M) with H the full Poseidon_5 hash.
+class NativeEdDSA
+{
+  public:
+    jubjub::Params params;
+
+    jubjub::EdwardsPoint getBase() const
+    {
+        return jubjub::EdwardsPoint(params.Gx, params.Gy);
+    }
+
+    // Twisted Edwards addition, complete on Baby Jubjub so no special cases are needed
+    jubjub::EdwardsPoint add(const jubjub::EdwardsPoint &p, const jubjub::EdwardsPoint &q) const
+    {
+        const FieldT x1x2 = p.x * q.x;
+        const FieldT y1y2 = p.y * q.y;
+        const FieldT dxy = params.d * x1x2 * y1y2;
+        return jubjub::EdwardsPoint(
+          (p.x * q.y + p.y * q.x) * (FieldT::one() + dxy).inverse(),
+          (y1y2 - params.a * x1x2) * (FieldT::one() - dxy).inverse());
+    }
+
+    // Double-and-add over all bits of `scalar`
+    jubjub::EdwardsPoint multiply(const jubjub::EdwardsPoint &p, const FieldT &scalar) const
+    {
+        const auto bits = scalar.as_bigint();
+        jubjub::EdwardsPoint result(FieldT::zero(), FieldT::one());
+        for (long i = long(bits.num_bits()) - 1; i >= 0; i--)
+        {
+            result = add(result, result);
+            if (bits.test_bit(i))
+            {
+                result = add(result, p);
+            }
+        }
+        return result;
+    }
+
+    KeyPair createKeyPair(const FieldT &secretKey) const
+    {
+        return {secretKey, multiply(getBase(), secretKey)};
+    }
+
+    static FieldT hashRAM(const jubjub::EdwardsPoint &R, const jubjub::EdwardsPoint &A, const FieldT &message)
+    {
+        return PoseidonNative_5::hash({R.x, R.y, A.x, A.y, message});
+    }
+
+    // `nonce` needs to be secret and must never be reused for a different message with the same key
+    Signature sign(const KeyPair &keyPair, const FieldT &message, const FieldT &nonce) const
+    {
+        const jubjub::EdwardsPoint R = multiply(getBase(), nonce);
+        const FieldT h = hashRAM(R, keyPair.publicKey, message);
+        // s = r + h*k (mod l)
+        const BigInt order(JUBJUB_SUBGROUP_ORDER);
+        const BigInt s = (toBigInt(nonce) + toBigInt(h) * toBigInt(keyPair.secretKey)) % order;
+        return Signature(R, FieldT(s.to_string().c_str()));
+    }
+
+    bool verify(const jubjub::EdwardsPoint &publicKey, const FieldT &message, const Signature &signature) const
+    {
+        const FieldT h = hashRAM(signature.R, publicKey, message);
+        const jubjub::EdwardsPoint lhs = multiply(getBase(), signature.s);
+        const jubjub::EdwardsPoint rhs = add(signature.R, multiply(publicKey, h));
+        return lhs.x == rhs.x && lhs.y == rhs.y;
+    }
+
+    // A uniformly random scalar in [0, l) (256 random bits reduced mod l)
+    template <typename RNG> static FieldT randomScalar(RNG &rng)
+    {
+        BigInt value = 0;
+        std::uniform_int_distribution<uint32_t> distribution;
+        for (unsigned int i = 0; i < 8; i++)
+        {
+            value = value * BigInt(4294967296LL) + BigInt((long long)distribution(rng));
+        }
+        value = value % BigInt(JUBJUB_SUBGROUP_ORDER);
+        return FieldT(value.to_string().c_str());
+    }
+};
+
+} // namespace Loopring
+
+#endif
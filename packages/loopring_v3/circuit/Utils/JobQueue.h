@@ -0,0 +1,396 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _JOBQUEUE_H_
+#define _JOBQUEUE_H_
+
+#include "ethsnarks.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+using json = nlohmann::json;
+
+namespace Loopring
+{
+
+enum class JobState
+{
+    Queued = 0,
+    Running,
+    Done,
+    Failed,
+    Cancelled
+};
+
+static const char *jobStateName(JobState state)
+{
+    switch (state)
+    {
+        case JobState::Queued:
+            return "queued";
+        case JobState::Running:
+            return "running";
+        case JobState::Done:
+            return "done";
+        case JobState::Failed:
+            return "failed";
+        case JobState::Cancelled:
+            return "cancelled";
+        default:
+            return "unknown";
+    }
+}
+
+// A request to prove a block.
+// The request data is immutable, everything else is owned by the JobQueue.
+struct ProverJob
+{
+    typedef std::chrono::steady_clock Clock;
+
+    unsigned int id;
+    // Jobs with a higher priority are proven first (e.g. blocks with forced withdrawals)
+    int priority;
+    std::string blockFilename;
+    // The block uploaded with the request, used instead of the block file (released when the job is finished)
+    std::shared_ptr<const std::string> blockData;
+    std::string proofFilename;
+    bool validate;
+    // Record a trace of the job
+    bool trace = false;
+
+    JobState state = JobState::Queued;
+    std::string phase;
+    bool cancelRequested = false;
+    std::string error;
+    std::string proof;
+    // The Chrome trace of the job when requested
+    std::string traceData;
+
+    Clock::time_point submitted;
+    Clock::time_point started;
+    Clock::time_point finished;
+    Clock::time_point phaseStarted;
+    // The duration of every finished phase in ms
+    std::vector<std::pair<std::string, unsigned int>> phaseTimes;
+
+    bool isFinished() const
+    {
+        return state == JobState::Done || state == JobState::Failed || state == JobState::Cancelled;
+    }
+};
+
+// Bounded queue of prover jobs, ordered by priority and then by submission order.
+// Jobs are processed by a single worker calling `next`. Finished jobs are kept
+// (up to `maxFinished`) so their state and proof can still be fetched.
+class JobQueue
+{
+  public:
+    typedef std::function<void(const ProverJob &job)> FinishedCallbackT;
+
+    JobQueue(size_t _maxQueued, size_t _maxFinished = 64)
+        : maxQueued(_maxQueued), maxFinished(_maxFinished), nextID(1), closed(false)
+    {
+    }
+
+    // Returns null when the queue is full or closed
+    std::shared_ptr<ProverJob> submit(
+      const std::string &blockFilename,
+      const std::string &proofFilename,
+      bool validate,
+      int priority,
+      bool trace = false,
+      const std::shared_ptr<const std::string> &blockData = nullptr)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (closed || queued.size() >= maxQueued)
+        {
+            return nullptr;
+        }
+        std::shared_ptr<ProverJob> job = std::make_shared<ProverJob>();
+        job->id = nextID++;
+        job->priority = priority;
+        job->blockFilename = blockFilename;
+        job->blockData = blockData;
+        job->proofFilename = proofFilename;
+        job->validate = validate;
+        job->trace = trace;
+        job->submitted = ProverJob::Clock::now();
+        jobs[job->id] = job;
+
+        // Insert after all jobs with the same or a higher priority
+        auto it = queued.begin();
+        while (it != queued.end() && (*it)->priority >= priority)
+        {
+            ++it;
+        }
+        queued.insert(it, job);
+        jobAvailable.notify_one();
+        return job;
+    }
+
+    // Blocks until a job is available, returns null once the queue is closed
+    std::shared_ptr<ProverJob> next()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        jobAvailable.wait(lock, [this]() { return !queued.empty() || closed; });
+        if (closed)
+        {
+            return nullptr;
+        }
+        std::shared_ptr<ProverJob> job = queued.front();
+        queued.pop_front();
+        job->state = JobState::Running;
+        job->started = ProverJob::Clock::now();
+        job->phaseStarted = job->started;
+        return job;
+    }
+
+    // Starts the next phase of a running job.
+    // Returns false if the job was cancelled and should be stopped.
+    bool enterPhase(const std::shared_ptr<ProverJob> &job, const std::string &phase)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        endPhase(*job);
+        job->phase = phase;
+        return !job->cancelRequested;
+    }
+
+    // Finishes a running job, the job failed when `error` is not empty
+    void finish(const std::shared_ptr<ProverJob> &job, const std::string &proof, const std::string &error)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        endPhase(*job);
+        job->phase.clear();
+        job->finished = ProverJob::Clock::now();
+        job->proof = proof;
+        job->error = error;
+        if (job->cancelRequested && error.length() > 0)
+        {
+            job->state = JobState::Cancelled;
+        }
+        else
+        {
+            job->state = (error.length() == 0) ? JobState::Done : JobState::Failed;
+        }
+        retire(job);
+    }
+
+    void setTrace(const std::shared_ptr<ProverJob> &job, const std::string &traceData)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        job->traceData = traceData;
+    }
+
+    // Queued jobs are cancelled immediately, running jobs are stopped at the next phase.
+    // Returns false if the job is unknown or already finished.
+    bool cancel(unsigned int id)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::shared_ptr<ProverJob> job = find(id);
+        if (!job || job->isFinished())
+        {
+            return false;
+        }
+        job->cancelRequested = true;
+        if (job->state == JobState::Queued)
+        {
+            queued.erase(std::find(queued.begin(), queued.end(), job));
+            job->state = JobState::Cancelled;
+            job->error = "Cancelled";
+            job->finished = ProverJob::Clock::now();
+            retire(job);
+        }
+        return true;
+    }
+
+    // Blocks until the job is finished, returns a copy of the finished job.
+    // Also works for jobs that are already removed from the finished jobs.
+    ProverJob wait(const std::shared_ptr<ProverJob> &job)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        jobFinished.wait(lock, [&job]() { return job->isFinished(); });
+        return *job;
+    }
+
+    // Stops handing out jobs, all queued jobs are cancelled
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = true;
+        for (const std::shared_ptr<ProverJob> &job : queued)
+        {
+            job->cancelRequested = true;
+            job->state = JobState::Cancelled;
+            job->error = "Prover stopped";
+            job->finished = ProverJob::Clock::now();
+            retire(job);
+        }
+        queued.clear();
+        jobAvailable.notify_all();
+        jobFinished.notify_all();
+    }
+
+    bool isClosed()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return closed;
+    }
+
+    // Blocks until the queue is closed
+    void waitClosed()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        jobFinished.wait(lock, [this]() { return closed; });
+    }
+
+    // A copy of the job that is safe to read, null if the job is unknown
+    std::shared_ptr<ProverJob> get(unsigned int id)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::shared_ptr<ProverJob> job = find(id);
+        return job ? std::make_shared<ProverJob>(*job) : nullptr;
+    }
+
+    json getStatus(unsigned int id)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::shared_ptr<ProverJob> job = find(id);
+        return job ? toJson(*job) : json();
+    }
+
+    json getStatus()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        json status;
+        status["queued"] = queued.size();
+        status["jobs"] = json::array();
+        for (const auto &it : jobs)
+        {
+            status["jobs"].push_back(toJson(*it.second));
+        }
+        return status;
+    }
+
+    // The running job, null when idle
+    std::shared_ptr<ProverJob> getRunning()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (const auto &it : jobs)
+        {
+            if (it.second->state == JobState::Running)
+            {
+                return std::make_shared<ProverJob>(*it.second);
+            }
+        }
+        return nullptr;
+    }
+
+    size_t numQueued()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return queued.size();
+    }
+
+    // Called for every finished job while the queue is locked, so it can't use the queue
+    void setFinishedCallback(const FinishedCallbackT &callback)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        onFinished = callback;
+    }
+
+  private:
+    const size_t maxQueued;
+    const size_t maxFinished;
+    unsigned int nextID;
+    bool closed;
+    // All known jobs by ID
+    std::map<unsigned int, std::shared_ptr<ProverJob>> jobs;
+    std::deque<std::shared_ptr<ProverJob>> queued;
+    std::deque<unsigned int> finished;
+    std::mutex mtx;
+    std::condition_variable jobAvailable;
+    std::condition_variable jobFinished;
+    FinishedCallbackT onFinished;
+
+    std::shared_ptr<ProverJob> find(unsigned int id)
+    {
+        auto it = jobs.find(id);
+        return (it != jobs.end()) ? it->second : nullptr;
+    }
+
+    static unsigned int durationMs(ProverJob::Clock::time_point begin, ProverJob::Clock::time_point end)
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
+    }
+
+    static void endPhase(ProverJob &job)
+    {
+        ProverJob::Clock::time_point now = ProverJob::Clock::now();
+        if (job.phase.length() > 0)
+        {
+            job.phaseTimes.push_back({job.phase, durationMs(job.phaseStarted, now)});
+        }
+        job.phaseStarted = now;
+    }
+
+    // Keeps the finished job around until `maxFinished` newer jobs are finished
+    void retire(const std::shared_ptr<ProverJob> &job)
+    {
+        job->blockData.reset();
+        if (onFinished)
+        {
+            onFinished(*job);
+        }
+        finished.push_back(job->id);
+        while (finished.size() > maxFinished)
+        {
+            jobs.erase(finished.front());
+            finished.pop_front();
+        }
+        jobFinished.notify_all();
+    }
+
+    static json toJson(const ProverJob &job)
+    {
+        ProverJob::Clock::time_point now = ProverJob::Clock::now();
+        json j;
+        j["id"] = job.id;
+        j["state"] = jobStateName(job.state);
+        j["priority"] = job.priority;
+        j["block_filename"] = job.blockFilename;
+        j["proof_filename"] = job.proofFilename;
+        if (job.state == JobState::Running)
+        {
+            j["phase"] = job.phase;
+        }
+        if (job.error.length() > 0)
+        {
+            j["error"] = job.error;
+        }
+
+        // Timings in ms
+        json timing;
+        bool started = job.state != JobState::Queued && job.started != ProverJob::Clock::time_point();
+        timing["queued"] = durationMs(job.submitted, started ? job.started : (job.isFinished() ? job.finished : now));
+        if (started)
+        {
+            timing["running"] = durationMs(job.started, job.isFinished() ? job.finished : now);
+        }
+        for (const auto &phaseTime : job.phaseTimes)
+        {
+            timing["phases"][phaseTime.first] = phaseTime.second;
+        }
+        j["timing"] = timing;
+        return j;
+    }
+};
+
+} // namespace Loopring
+
+#endif
@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _MAPPEDPROVINGKEY_H_
+#define _MAPPEDPROVINGKEY_H_
+
+#include "ethsnarks.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Loopring
+{
+
+// Proving key file with all points stored in their in-memory representation.
+// Every section starts on a page boundary so it can be used directly from a mapping
+// of the file. The file can only be read by a prover built with the same point types.
+//
+// Layout:
+// - MappedProvingKeyHeader
+// - alpha_g1, beta_g1, beta_g2, delta_g1, delta_g2 (each on its own page)
+// - A_query, B_query, H_query, L_query
+struct MappedProvingKeyHeader
+{
+    static const uint64_t MAGIC = 0x59454b50474e524cULL; // "LRNGPKEY"
+    static const uint64_t VERSION = 1;
+    static const uint64_t ALIGNMENT = 4096;
+
+    uint64_t magic;
+    uint64_t version;
+    uint64_t sizeG1;
+    uint64_t sizeG2;
+    // Number of points in A_query, B_query, H_query and L_query
+    uint64_t numA;
+    uint64_t numB;
+    uint64_t numH;
+    uint64_t numL;
+};
+
+class MappedProvingKey
+{
+  public:
+    typedef ethsnarks::ProvingKeyT KeyT;
+    typedef decltype(KeyT::alpha_g1) G1T;
+    typedef decltype(KeyT::beta_g2) G2T;
+
+    // Returns true if the file is a mapped proving key
+    static bool isMappedFile(const std::string &filename)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        uint64_t magic = 0;
+        file.read((char *)&magic, sizeof(magic));
+        return file.good() && magic == MappedProvingKeyHeader::MAGIC;
+    }
+
+    static bool write(const KeyT &pk, const std::string &filename)
+    {
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cerr << "Cannot create proving key file: " << filename << std::endl;
+            return false;
+        }
+        MappedProvingKeyHeader header = getHeader(pk);
+        file.write((const char *)&header, sizeof(header));
+        writeSection(file, &pk.alpha_g1, 1);
+        writeSection(file, &pk.beta_g1, 1);
+        writeSection(file, &pk.beta_g2, 1);
+        writeSection(file, &pk.delta_g1, 1);
+        writeSection(file, &pk.delta_g2, 1);
+        writeSection(file, pk.A_query.data(), pk.A_query.size());
+        writeSection(file, pk.B_query.data(), pk.B_query.size());
+        writeSection(file, pk.H_query.data(), pk.H_query.size());
+        writeSection(file, pk.L_query.data(), pk.L_query.size());
+        file.close();
+        return !file.fail();
+    }
+
+    // Maps the file and fills the key directly from the mapping.
+    // Every section is released from the mapping once it is copied,
+    // so the memory needed is never much more than the size of the key.
+    static bool load(const std::string &filename, KeyT &pk)
+    {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            std::cerr << "Cannot open proving key file: " << filename << std::endl;
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(MappedProvingKeyHeader))
+        {
+            std::cerr << "Invalid proving key file: " << filename << std::endl;
+            close(fd);
+            return false;
+        }
+        int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        flags |= MAP_POPULATE;
+#endif
+        size_t size = st.st_size;
+        void *mapping = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            std::cerr << "Cannot map proving key file: " << filename << std::endl;
+            return false;
+        }
+        madvise(mapping, size, MADV_SEQUENTIAL);
+
+        const char *data = (const char *)mapping;
+        MappedProvingKeyHeader header;
+        memcpy(&header, data, sizeof(header));
+        MappedProvingKeyHeader expected = getHeader(pk);
+        bool valid = header.magic == expected.magic && header.version == expected.version &&
+                     header.sizeG1 == expected.sizeG1 && header.sizeG2 == expected.sizeG2 &&
+                     getSize(header) == size;
+        if (!valid)
+        {
+            std::cerr << "Proving key file " << filename << " was not created for this prover" << std::endl;
+            munmap(mapping, size);
+            return false;
+        }
+
+        size_t offset = align(sizeof(header));
+        offset = readSection(data, offset, &pk.alpha_g1, 1);
+        offset = readSection(data, offset, &pk.beta_g1, 1);
+        offset = readSection(data, offset, &pk.beta_g2, 1);
+        offset = readSection(data, offset, &pk.delta_g1, 1);
+        offset = readSection(data, offset, &pk.delta_g2, 1);
+        offset = readQuery(data, offset, header.numA, pk.A_query);
+        offset = readQuery(data, offset, header.numB, pk.B_query);
+        offset = readQuery(data, offset, header.numH, pk.H_query);
+        offset = readQuery(data, offset, header.numL, pk.L_query);
+        munmap(mapping, size);
+        return true;
+    }
+
+  private:
+    static size_t align(size_t offset)
+    {
+        const size_t alignment = MappedProvingKeyHeader::ALIGNMENT;
+        return ((offset + alignment - 1) / alignment) * alignment;
+    }
+
+    static MappedProvingKeyHeader getHeader(const KeyT &pk)
+    {
+        MappedProvingKeyHeader header;
+        header.magic = MappedProvingKeyHeader::MAGIC;
+        header.version = MappedProvingKeyHeader::VERSION;
+        header.sizeG1 = sizeof(G1T);
+        header.sizeG2 = sizeof(G2T);
+        header.numA = pk.A_query.size();
+        header.numB = pk.B_query.size();
+        header.numH = pk.H_query.size();
+        header.numL = pk.L_query.size();
+        return header;
+    }
+
+    // The size of a file with this header
+    static size_t getSize(const MappedProvingKeyHeader &header)
+    {
+        typedef typename std::decay<decltype(KeyT::A_query[0])>::type AT;
+        typedef typename std::decay<decltype(KeyT::B_query[0])>::type BT;
+        typedef typename std::decay<decltype(KeyT::H_query[0])>::type HT;
+        typedef typename std::decay<decltype(KeyT::L_query[0])>::type LT;
+        size_t size = align(sizeof(header));
+        size += align(sizeof(G1T)) * 3 + align(sizeof(G2T)) * 2;
+        size += align(header.numA * sizeof(AT));
+        size += align(header.numB * sizeof(BT));
+        size += align(header.numH * sizeof(HT));
+        size += align(header.numL * sizeof(LT));
+        return size;
+    }
+
+    template <typename T> static void writeSection(std::ofstream &file, const T *values, size_t count)
+    {
+        // Pad to the start of the section
+        size_t offset = file.tellp();
+        std::vector<char> padding(align(offset) - offset, 0);
+        file.write(padding.data(), padding.size());
+        file.write((const char *)values, count * sizeof(T));
+        // Pad the end of the file
+        offset = file.tellp();
+        padding.assign(align(offset) - offset, 0);
+        file.write(padding.data(), padding.size());
+    }
+
+    template <typename T> static size_t readSection(const char *data, size_t offset, T *values, size_t count)
+    {
+        memcpy((void *)values, data + offset, count * sizeof(T));
+        return align(offset + count * sizeof(T));
+    }
+
+    template <typename VectorT> static size_t readQuery(const char *data, size_t offset, size_t count, VectorT &query)
+    {
+        typedef typename VectorT::value_type T;
+        const T *values = (const T *)(data + offset);
+        query.assign(values, values + count);
+        // The mapped pages are not needed anymore
+        size_t end = align(offset + count * sizeof(T));
+        madvise((void *)(data + offset), end - offset, MADV_DONTNEED);
+        return end;
+    }
+};
+
+} // namespace Loopring
+
+#endif
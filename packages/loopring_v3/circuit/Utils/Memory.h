@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _MEMORY_H_
+#define _MEMORY_H_
+
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+namespace Loopring
+{
+
+static const double GB = 1024.0 * 1024.0 * 1024.0;
+
+// Reads a memory field (e.g. "VmRSS") in bytes from /proc/self/status, 0 when not available
+static size_t getProcessMemory(const std::string &field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, field.size() + 1, field + ":") == 0)
+        {
+            // The value is in kB
+            return size_t(std::strtoull(line.c_str() + field.size() + 1, nullptr, 10)) * 1024;
+        }
+    }
+    return 0;
+}
+
+// The memory used by the process right now
+static size_t getResidentMemory()
+{
+    return getProcessMemory("VmRSS");
+}
+
+// The maximum memory used by the process since the start
+static size_t getPeakResidentMemory()
+{
+    return getProcessMemory("VmHWM");
+}
+
+} // namespace Loopring
+
+#endif
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _MEMORYSTREAM_H_
+#define _MEMORYSTREAM_H_
+
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+
+namespace Loopring
+{
+
+// Reads from data in memory without copying it (e.g. a block uploaded to the prover server),
+// so everything that reads from a file can read from the data as well.
+// The data is kept alive while the stream is in use.
+class MemoryStream : public std::istream
+{
+  public:
+    MemoryStream(const std::shared_ptr<const std::string> &_data) : std::istream(nullptr), data(_data), buffer(*data)
+    {
+        // The buffer is only constructed after the stream
+        rdbuf(&buffer);
+    }
+
+  private:
+    class Buffer : public std::streambuf
+    {
+      public:
+        Buffer(const std::string &data)
+        {
+            char *begin = const_cast<char *>(data.data());
+            setg(begin, begin, begin + data.size());
+        }
+
+      protected:
+        pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+        {
+            char *base = (dir == std::ios_base::beg) ? eback() : ((dir == std::ios_base::cur) ? gptr() : egptr());
+            char *target = base + offset;
+            if (!(which & std::ios_base::in) || target < eback() || target > egptr())
+            {
+                return pos_type(off_type(-1));
+            }
+            setg(eback(), target, egptr());
+            return pos_type(target - eback());
+        }
+
+        pos_type seekpos(pos_type position, std::ios_base::openmode which) override
+        {
+            return seekoff(off_type(position), std::ios_base::beg, which);
+        }
+    };
+
+    std::shared_ptr<const std::string> data;
+    Buffer buffer;
+};
+
+} // namespace Loopring
+
+#endif
@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Loopring
+{
+
+enum class MetricType
+{
+    Counter = 0,
+    Gauge,
+    Histogram
+};
+
+// Counters, gauges and histograms exported in the Prometheus text format.
+// Metrics are identified by their name and a label set, e.g.
+// `metrics.increment("prover_failures_total", Metrics::labels({{"reason", "Block is invalid"}}))`.
+class Metrics
+{
+  public:
+    // The process wide metrics
+    static Metrics &get()
+    {
+        static Metrics metrics;
+        return metrics;
+    }
+
+    // Registers a metric, needs to be done before the metric is used
+    void add(
+      const std::string &name,
+      MetricType type,
+      const std::string &help,
+      const std::vector<double> &buckets = defaultBuckets())
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        Family &family = families[name];
+        family.type = type;
+        family.help = help;
+        family.buckets = buckets;
+    }
+
+    void increment(const std::string &name, const std::string &labels = "", double value = 1.0)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        getValue(name, labels).sum += value;
+    }
+
+    void set(const std::string &name, double value, const std::string &labels = "")
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        getValue(name, labels).sum = value;
+    }
+
+    void observe(const std::string &name, double value, const std::string &labels = "")
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        Family &family = families[name];
+        Value &v = getValue(name, labels);
+        if (v.counts.size() != family.buckets.size())
+        {
+            v.counts.resize(family.buckets.size(), 0);
+        }
+        for (size_t i = 0; i < family.buckets.size(); i++)
+        {
+            if (value <= family.buckets[i])
+            {
+                v.counts[i]++;
+            }
+        }
+        v.sum += value;
+        v.count++;
+    }
+
+    // Formats a label set, e.g. `{phase="witness"}`
+    static std::string labels(const std::vector<std::pair<std::string, std::string>> &values)
+    {
+        if (values.size() == 0)
+        {
+            return "";
+        }
+        std::string result = "{";
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            result += (i > 0 ? "," : "") + values[i].first + "=\"" + escape(values[i].second) + "\"";
+        }
+        return result + "}";
+    }
+
+    // Seconds, from fast witness phases up to full proofs of large blocks
+    static std::vector<double> defaultBuckets()
+    {
+        return {0.01, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60, 120, 300, 600, 1200};
+    }
+
+    // All metrics in the Prometheus text exposition format
+    std::string serialize()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::stringstream ss;
+        for (const auto &it : families)
+        {
+            const std::string &name = it.first;
+            const Family &family = it.second;
+            ss << "# HELP " << name << " " << family.help << "\n";
+            ss << "# TYPE " << name << " " << typeName(family.type) << "\n";
+            for (const auto &value : family.values)
+            {
+                const std::string &labels = value.first;
+                const Value &v = value.second;
+                if (family.type != MetricType::Histogram)
+                {
+                    ss << name << labels << " " << formatNumber(v.sum) << "\n";
+                    continue;
+                }
+                for (size_t i = 0; i < family.buckets.size(); i++)
+                {
+                    uint64_t count = (i < v.counts.size()) ? v.counts[i] : 0;
+                    ss << name << "_bucket" << addLabel(labels, "le", formatNumber(family.buckets[i])) << " "
+                       << count << "\n";
+                }
+                ss << name << "_bucket" << addLabel(labels, "le", "+Inf") << " " << v.count << "\n";
+                ss << name << "_sum" << labels << " " << formatNumber(v.sum) << "\n";
+                ss << name << "_count" << labels << " " << v.count << "\n";
+            }
+        }
+        return ss.str();
+    }
+
+  private:
+    struct Value
+    {
+        // The value of counters and gauges, the sum of all observations of histograms
+        double sum = 0;
+        uint64_t count = 0;
+        // Cumulative bucket counts of histograms
+        std::vector<uint64_t> counts;
+    };
+
+    struct Family
+    {
+        MetricType type = MetricType::Gauge;
+        std::string help;
+        std::vector<double> buckets;
+        std::map<std::string, Value> values;
+    };
+
+    std::map<std::string, Family> families;
+    std::mutex mtx;
+
+    Value &getValue(const std::string &name, const std::string &labels)
+    {
+        return families[name].values[labels];
+    }
+
+    static const char *typeName(MetricType type)
+    {
+        switch (type)
+        {
+            case MetricType::Counter:
+                return "counter";
+            case MetricType::Histogram:
+                return "histogram";
+            default:
+                return "gauge";
+        }
+    }
+
+    static std::string escape(const std::string &value)
+    {
+        std::string result;
+        for (char c : value)
+        {
+            if (c == '\\' || c == '"')
+            {
+                result += '\\';
+                result += c;
+            }
+            else if (c == '\n')
+            {
+                result += "\\n";
+            }
+            else
+            {
+                result += c;
+            }
+        }
+        return result;
+    }
+
+    static std::string addLabel(const std::string &labels, const std::string &name, const std::string &value)
+    {
+        std::string label = name + "=\"" + value + "\"";
+        if (labels.length() == 0)
+        {
+            return "{" + label + "}";
+        }
+        return labels.substr(0, labels.length() - 1) + "," + label + "}";
+    }
+
+    static std::string formatNumber(double value)
+    {
+        std::stringstream ss;
+        ss.precision(12);
+        ss << value;
+        return ss.str();
+    }
+};
+
+} // namespace Loopring
+
+#endif
@@ -0,0 +1,415 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _POSEIDON_H_
+#define _POSEIDON_H_
+
+#include "Constants.h"
+#include "Data.h"
+
+#include "ethsnarks.hpp"
+#include "gadgets/poseidon.hpp"
+
+#include <array>
+
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+using namespace ethsnarks;
+
+namespace Loopring
+{
+
+// Native (out of circuit) Poseidon permutation using exactly the same constants as
+// Poseidon_gadget_T<param_t, 1, param_F, param_P, ...>.
+//
+// Independent permutations are evaluated together in groups of NUM_LANES states.
+// All states in a group go through a round before the next round starts, so the
+// round constant and every matrix entry are loaded once per group and the field
+// multiplications of the different lanes have no dependencies on each other.
+// The lanes are plain FieldT loops (no SIMD), independent groups run on the OpenMP threads.
+template <unsigned param_t, unsigned param_F, unsigned param_P> class PoseidonPermutation
+{
+  public:
+    static const unsigned NUM_LANES = 8;
+    static const unsigned NUM_ROUNDS = param_F + param_P;
+
+    typedef std::array<FieldT, param_t> State;
+
+    static const PoseidonConstants &constants()
+    {
+        return poseidon_params<param_t, param_F, param_P>();
+    }
+
+    static bool isFullRound(unsigned int round)
+    {
+        return (round < param_F / 2) || (round >= param_F / 2 + param_P);
+    }
+
+    static FieldT sbox(const FieldT &x)
+    {
+        const FieldT x2 = x.squared();
+        return x2.squared() * x;
+    }
+
+    // Permutes `numStates` states starting at `states` in lockstep
+    static void permute(State *states, unsigned int numStates)
+    {
+        const PoseidonConstants &params = constants();
+        const std::vector<FieldT> &C = params.C;
+        const std::vector<FieldT> &M = params.M;
+
+        for (unsigned int begin = 0; begin < numStates; begin += NUM_LANES)
+        {
+            const unsigned int numLanes = std::min(NUM_LANES, numStates - begin);
+            State *lanes = states + begin;
+            State mixed[NUM_LANES];
+            for (unsigned int r = 0; r < NUM_ROUNDS; r++)
+            {
+                // Add round constant + sbox
+                const bool fullRound = isFullRound(r);
+                for (unsigned int l = 0; l < numLanes; l++)
+                {
+                    for (unsigned int j = 0; j < param_t; j++)
+                    {
+                        lanes[l][j] += C[r];
+                    }
+                }
+                if (fullRound)
+                {
+                    for (unsigned int j = 0; j < param_t; j++)
+                    {
+                        for (unsigned int l = 0; l < numLanes; l++)
+                        {
+                            lanes[l][j] = sbox(lanes[l][j]);
+                        }
+                    }
+                }
+                else
+                {
+                    for (unsigned int l = 0; l < numLanes; l++)
+                    {
+                        lanes[l][0] = sbox(lanes[l][0]);
+                    }
+                }
+
+                // Mix
+                for (unsigned int i = 0; i < param_t; i++)
+                {
+                    for (unsigned int l = 0; l < numLanes; l++)
+                    {
+                        mixed[l][i] = FieldT::zero();
+                    }
+                    for (unsigned int j = 0; j < param_t; j++)
+                    {
+                        const FieldT &m = M[i * param_t + j];
+                        for (unsigned int l = 0; l < numLanes; l++)
+                        {
+                            mixed[l][i] += m * lanes[l][j];
+                        }
+                    }
+                }
+                for (unsigned int l = 0; l < numLanes; l++)
+                {
+                    lanes[l] = mixed[l];
+                }
+            }
+        }
+    }
+
+    static void permute(std::vector<State> &states)
+    {
+        const unsigned int numGroups = (states.size() + NUM_LANES - 1) / NUM_LANES;
+#ifdef MULTICORE
+#pragma omp parallel for if (numGroups > 1)
+#endif
+        for (unsigned int g = 0; g < numGroups; g++)
+        {
+            const unsigned int begin = g * NUM_LANES;
+            permute(states.data() + begin, std::min<unsigned int>(NUM_LANES, states.size() - begin));
+        }
+    }
+
+    static State toState(const std::vector<FieldT> &inputs)
+    {
+        assert(inputs.size() < param_t);
+        State state;
+        for (unsigned int j = 0; j < param_t; j++)
+        {
+            state[j] = (j < inputs.size()) ? inputs[j] : FieldT::zero();
+        }
+        return state;
+    }
+
+    static FieldT hash(const std::vector<FieldT> &inputs)
+    {
+        State state = toState(inputs);
+        permute(&state, 1);
+        return state[0];
+    }
+
+    // Hashes all inputs, the result of inputs[i] is stored in outputs[i]
+    static std::vector<FieldT> hash(const std::vector<std::vector<FieldT>> &inputs)
+    {
+        std::vector<State> states;
+        states.reserve(inputs.size());
+        for (const auto &input : inputs)
+        {
+            states.push_back(toState(input));
+        }
+        permute(states);
+
+        std::vector<FieldT> outputs;
+        outputs.reserve(states.size());
+        for (const auto &state : states)
+        {
+            outputs.push_back(state[0]);
+        }
+        return outputs;
+    }
+};
+
+// Native versions of all Poseidon permutations used (see MathGadgets.h)
+using PoseidonNative_2 = PoseidonPermutation<3, 6, 51>;
+using PoseidonNative_3 = PoseidonPermutation<4, 6, 52>;
+using PoseidonNative_4 = PoseidonPermutation<5, 6, 52>;
+using PoseidonNative_5 = PoseidonPermutation<6, 6, 52>;
+using PoseidonNative_6 = PoseidonPermutation<7, 6, 52>;
+using PoseidonNative_8 = PoseidonPermutation<9, 6, 53>;
+using PoseidonNative_9 = PoseidonPermutation<10, 6, 53>;
+using PoseidonNative_10 = PoseidonPermutation<11, 6, 53>;
+using PoseidonNative_11 = PoseidonPermutation<12, 6, 53>;
+using PoseidonNative_12 = PoseidonPermutation<13, 6, 53>;
+
+// Same parameters as the in-circuit Merkle tree hashes (see MerkleTree.h)
+using NativeHashMerkleTree = PoseidonNative_4;
+using NativeHashAccountLeaf = PoseidonNative_6;
+using NativeHashBalanceLeaf = PoseidonNative_4;
+using NativeHashStorageLeaf = PoseidonNative_4;
+
+static uint64_t fieldToUint64(const FieldT &value)
+{
+    return value.as_bigint().as_ulong();
+}
+
+// A Merkle path in a quad tree that is evaluated natively.
+// Every step of all paths is done together so the hashes on the same level of all paths are batched.
+struct NativeMerklePath
+{
+    uint64_t address;
+    unsigned int depth;
+    FieldT leaf;
+    const std::vector<FieldT> *proof;
+    FieldT root;
+};
+
+// Calculates the root of all paths
+static void computeMerkleRoots(std::vector<NativeMerklePath> &paths)
+{
+    unsigned int maxDepth = 0;
+    for (auto &path : paths)
+    {
+        path.root = path.leaf;
+        maxDepth = std::max(maxDepth, path.depth);
+    }
+
+    std::vector<NativeHashMerkleTree::State> states;
+    std::vector<unsigned int> active;
+    states.reserve(paths.size());
+    active.reserve(paths.size());
+    for (unsigned int level = 0; level < maxDepth; level++)
+    {
+        states.clear();
+        active.clear();
+        for (unsigned int p = 0; p < paths.size(); p++)
+        {
+            const NativeMerklePath &path = paths[p];
+            if (level >= path.depth)
+            {
+                continue;
+            }
+            // The position of the current node amongst its siblings
+            const unsigned int position = (path.address >> (level * 2)) & 3;
+            const std::vector<FieldT> &proof = *path.proof;
+            assert(proof.size() >= path.depth * 3);
+
+            NativeHashMerkleTree::State state;
+            unsigned int s = 0;
+            for (unsigned int c = 0; c < 4; c++)
+            {
+                state[c] = (c == position) ? path.root : proof[level * 3 + s++];
+            }
+            state[4] = FieldT::zero();
+            states.push_back(state);
+            active.push_back(p);
+        }
+        NativeHashMerkleTree::permute(states);
+        for (unsigned int i = 0; i < active.size(); i++)
+        {
+            paths[active[i]].root = states[i][0];
+        }
+    }
+}
+
+struct MerkleProofError
+{
+    unsigned int txIdx;
+    std::string update;
+};
+
+// Verifies the Merkle proofs of all state updates in a block natively (without the circuit).
+// Returns exactly which updates are invalid, used to check generated blocks in the tests.
+static std::vector<MerkleProofError> verifyMerkleProofs(const Block &block)
+{
+    struct Check
+    {
+        unsigned int txIdx;
+        std::string update;
+        FieldT expectedRootBefore;
+        FieldT expectedRootAfter;
+    };
+    std::vector<Check> checks;
+    std::vector<std::vector<FieldT>> accountLeafs, balanceLeafs, storageLeafs;
+    std::vector<NativeMerklePath> paths;
+
+    // Leafs are hashed first, the index of the leaf hash is stored in `leaf` until the hashes are known
+    struct PendingPath
+    {
+        NativeMerklePath path;
+        std::vector<std::vector<FieldT>> *leafs;
+        unsigned int leafIdx;
+    };
+    std::vector<PendingPath> pending;
+
+    auto addPaths = [&](
+                      unsigned int txIdx,
+                      const std::string &name,
+                      uint64_t address,
+                      unsigned int depth,
+                      const Proof &proof,
+                      const FieldT &rootBefore,
+                      const FieldT &rootAfter,
+                      std::vector<std::vector<FieldT>> &leafs,
+                      const std::vector<FieldT> &leafBefore,
+                      const std::vector<FieldT> &leafAfter) {
+        checks.push_back({txIdx, name, rootBefore, rootAfter});
+        for (const auto *leaf : {&leafBefore, &leafAfter})
+        {
+            leafs.push_back(*leaf);
+            NativeMerklePath path = {address, depth, FieldT::zero(), &proof.data, FieldT::zero()};
+            pending.push_back({path, &leafs, (unsigned int)(leafs.size() - 1)});
+        }
+    };
+    auto addAccount = [&](unsigned int txIdx, const std::string &name, const AccountUpdate &update) {
+        auto leaf = [](const AccountLeaf &l) -> std::vector<FieldT> {
+            return {l.owner, l.publicKey.x, l.publicKey.y, l.nonce, l.feeBipsAMM, l.balancesRoot};
+        };
+        addPaths(
+          txIdx,
+          name,
+          fieldToUint64(update.accountID),
+          TREE_DEPTH_ACCOUNTS,
+          update.proof,
+          update.rootBefore,
+          update.rootAfter,
+          accountLeafs,
+          leaf(update.before),
+          leaf(update.after));
+    };
+    auto addBalance = [&](unsigned int txIdx, const std::string &name, const BalanceUpdate &update) {
+        auto leaf = [](const BalanceLeaf &l) -> std::vector<FieldT> {
+            return {l.balance, l.weightAMM, l.storageRoot};
+        };
+        addPaths(
+          txIdx,
+          name,
+          fieldToUint64(update.tokenID),
+          TREE_DEPTH_TOKENS,
+          update.proof,
+          update.rootBefore,
+          update.rootAfter,
+          balanceLeafs,
+          leaf(update.before),
+          leaf(update.after));
+    };
+    auto addStorage = [&](unsigned int txIdx, const std::string &name, const StorageUpdate &update) {
+        auto leaf = [](const StorageLeaf &l) -> std::vector<FieldT> {
+            return {l.data, l.storageID};
+        };
+        addPaths(
+          txIdx,
+          name,
+          fieldToUint64(update.storageID) % NUM_STORAGE_SLOTS,
+          TREE_DEPTH_STORAGE,
+          update.proof,
+          update.rootBefore,
+          update.rootAfter,
+          storageLeafs,
+          leaf(update.before),
+          leaf(update.after));
+    };
+
+    for (unsigned int i = 0; i < block.transactions.size(); i++)
+    {
+        const Witness &witness = block.transactions[i].witness;
+        addStorage(i, "storageUpdate_A", witness.storageUpdate_A);
+        addBalance(i, "balanceUpdateS_A", witness.balanceUpdateS_A);
+        addBalance(i, "balanceUpdateB_A", witness.balanceUpdateB_A);
+        addAccount(i, "accountUpdate_A", witness.accountUpdate_A);
+        addStorage(i, "storageUpdate_B", witness.storageUpdate_B);
+        addBalance(i, "balanceUpdateS_B", witness.balanceUpdateS_B);
+        addBalance(i, "balanceUpdateB_B", witness.balanceUpdateB_B);
+        addAccount(i, "accountUpdate_B", witness.accountUpdate_B);
+        addBalance(i, "balanceUpdateB_O", witness.balanceUpdateB_O);
+        addBalance(i, "balanceUpdateA_O", witness.balanceUpdateA_O);
+        addAccount(i, "accountUpdate_O", witness.accountUpdate_O);
+        addBalance(i, "balanceUpdateB_P", witness.balanceUpdateB_P);
+        addBalance(i, "balanceUpdateA_P", witness.balanceUpdateA_P);
+    }
+    addAccount(block.transactions.size(), "accountUpdate_P", block.accountUpdate_P);
+    addAccount(block.transactions.size(), "accountUpdate_O", block.accountUpdate_O);
+
+    // Hash all leafs
+    const std::vector<FieldT> accountHashes = NativeHashAccountLeaf::hash(accountLeafs);
+    const std::vector<FieldT> balanceHashes = NativeHashBalanceLeaf::hash(balanceLeafs);
+    const std::vector<FieldT> storageHashes = NativeHashStorageLeaf::hash(storageLeafs);
+
+    // Calculate all roots
+    paths.reserve(pending.size());
+    for (const auto &p : pending)
+    {
+        NativeMerklePath path = p.path;
+        if (p.leafs == &accountLeafs)
+        {
+            path.leaf = accountHashes[p.leafIdx];
+        }
+        else if (p.leafs == &balanceLeafs)
+        {
+            path.leaf = balanceHashes[p.leafIdx];
+        }
+        else
+        {
+            path.leaf = storageHashes[p.leafIdx];
+        }
+        paths.push_back(path);
+    }
+    computeMerkleRoots(paths);
+
+    std::vector<MerkleProofError> errors;
+    for (unsigned int i = 0; i < checks.size(); i++)
+    {
+        if (paths[i * 2 + 0].root != checks[i].expectedRootBefore)
+        {
+            errors.push_back({checks[i].txIdx, checks[i].update + ".rootBefore"});
+        }
+        if (paths[i * 2 + 1].root != checks[i].expectedRootAfter)
+        {
+            errors.push_back({checks[i].txIdx, checks[i].update + ".rootAfter"});
+        }
+    }
+    return errors;
+}
+
+} // namespace Loopring
+
+#endif
@@ -0,0 +1,241 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _PROOFCACHE_H_
+#define _PROOFCACHE_H_
+
+#include "ethsnarks.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+using namespace ethsnarks;
+
+namespace Loopring
+{
+
+// Persistent cache of small values (e.g. proofs) stored as files in a directory.
+// Every entry is a file named after its key, so the cache survives restarts and can be shared
+// by multiple processes (entries are written to a temporary file first and then renamed).
+// The total size of the entries is bounded: when an entry is added the least recently used
+// entries (the oldest modification times, reading an entry touches it) are removed until the
+// entries fit in `maxBytes`.
+class ProofCache
+{
+  public:
+    ProofCache(const std::string &_directory, uint64_t _maxBytes) : directory(_directory), maxBytes(_maxBytes)
+    {
+        if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+        {
+            std::cerr << "Failed to create proof cache directory " << directory << std::endl;
+        }
+    }
+
+    // Returns true with `value` set when the key is in the cache
+    bool get(const std::string &key, std::string &value)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        const std::string filename = getFilename(key);
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        if (file.bad())
+        {
+            return false;
+        }
+        value = buffer.str();
+        // Mark as recently used
+        utime(filename.c_str(), nullptr);
+        return true;
+    }
+
+    // Adds (or replaces) an entry, evicts the least recently used entries when the cache is full
+    bool put(const std::string &key, const std::string &value)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        const std::string filename = getFilename(key);
+        const std::string tempFilename = filename + ".tmp" + std::to_string(getpid());
+        {
+            std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+            file.write(value.data(), value.size());
+            if (!file.good())
+            {
+                std::remove(tempFilename.c_str());
+                return false;
+            }
+        }
+        if (std::rename(tempFilename.c_str(), filename.c_str()) != 0)
+        {
+            std::remove(tempFilename.c_str());
+            return false;
+        }
+        evict(filename);
+        return true;
+    }
+
+    // Total size of the entries in the cache
+    uint64_t getSize() const
+    {
+        uint64_t size = 0;
+        for (const Entry &entry : getEntries())
+        {
+            size += entry.size;
+        }
+        return size;
+    }
+
+    // Hash of the contents of a file, returns false when the file can't be read.
+    // FNV-1a, so only usable for files from a trusted source (collisions can be created on purpose).
+    static bool hashFile(const std::string &filename, uint64_t &hash)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        hash = FNV_OFFSET;
+        std::vector<char> buffer(1 << 16);
+        while (file)
+        {
+            file.read(buffer.data(), buffer.size());
+            hash = hashBytes(hash, buffer.data(), file.gcount());
+        }
+        return !file.bad();
+    }
+
+    static uint64_t hashString(const std::string &data)
+    {
+        return hashBytes(FNV_OFFSET, data.data(), data.size());
+    }
+
+    static std::string toHex(uint64_t value)
+    {
+        char buffer[17];
+        snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)value);
+        return std::string(buffer);
+    }
+
+    // The primary inputs of the protoboard as hex (the full values, not a hash)
+    static std::string primaryInputToHex(const ProtoboardT &pb)
+    {
+        std::string hex;
+        for (size_t i = 0; i < pb.constraint_system.primary_input_size; i++)
+        {
+            const auto value = pb.values[i].as_bigint();
+            for (size_t j = value.N; j > 0; j--)
+            {
+                hex += toHex(value.data[j - 1]);
+            }
+        }
+        return hex;
+    }
+
+  private:
+    static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+    static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+    struct Entry
+    {
+        std::string filename;
+        uint64_t size;
+        // Modification time in nanoseconds
+        uint64_t modified;
+    };
+
+    const std::string directory;
+    const uint64_t maxBytes;
+    std::mutex mtx;
+
+    static uint64_t hashBytes(uint64_t hash, const char *data, size_t length)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            hash ^= (unsigned char)data[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    std::string getFilename(const std::string &key) const
+    {
+        return directory + "/" + key;
+    }
+
+    // The entries in the cache directory (temporary files of writes in progress are skipped)
+    std::vector<Entry> getEntries() const
+    {
+        std::vector<Entry> entries;
+        DIR *dir = opendir(directory.c_str());
+        if (!dir)
+        {
+            return entries;
+        }
+        while (struct dirent *dirEntry = readdir(dir))
+        {
+            const std::string name = dirEntry->d_name;
+            if (name[0] == '.' || name.find(".tmp") != std::string::npos)
+            {
+                continue;
+            }
+            struct stat info;
+            const std::string filename = getFilename(name);
+            if (stat(filename.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+            {
+                uint64_t modified = uint64_t(info.st_mtim.tv_sec) * 1000000000ULL + info.st_mtim.tv_nsec;
+                entries.push_back(Entry{filename, uint64_t(info.st_size), modified});
+            }
+        }
+        closedir(dir);
+        return entries;
+    }
+
+    // Removes the least recently used entries until the cache fits, `keep` is never removed
+    void evict(const std::string &keep)
+    {
+        std::vector<Entry> entries = getEntries();
+        uint64_t size = 0;
+        for (const Entry &entry : entries)
+        {
+            size += entry.size;
+        }
+        if (size <= maxBytes)
+        {
+            return;
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+            return a.modified < b.modified;
+        });
+        for (const Entry &entry : entries)
+        {
+            if (size <= maxBytes)
+            {
+                break;
+            }
+            if (entry.filename == keep)
+            {
+                continue;
+            }
+            std::remove(entry.filename.c_str());
+            size -= entry.size;
+        }
+    }
+};
+
+} // namespace Loopring
+
+#endif
@@ -0,0 +1,433 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _R1CSFILE_H_
+#define _R1CSFILE_H_
+
+#include "ethsnarks.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+using namespace ethsnarks;
+
+namespace Loopring
+{
+
+// Constraint systems (.r1cs) and witnesses (.wtns) in the binary formats of circom/snarkjs,
+// so other provers can be run on exactly the same constraint system and witness.
+//
+// Both formats are a magic, a version and a list of sections (type, size, data).
+// All integers are little endian and all field elements are in standard (non-Montgomery)
+// form, little endian, in `n8` bytes. Wire 0 is the constant 1, wire `i` is variable `i`
+// of the protoboard, so the primary inputs are wires 1 to `primary_input_size`.
+//
+// The constraints and values are serialized in parallel in chunks, the chunks are written in order.
+class R1CSFile
+{
+  public:
+    static const uint32_t R1CS_MAGIC = 0x73633172; // "r1cs"
+    static const uint32_t R1CS_VERSION = 1;
+    static const uint32_t WTNS_MAGIC = 0x736e7477; // "wtns"
+    static const uint32_t WTNS_VERSION = 2;
+
+    enum R1CSSection
+    {
+        R1CS_HEADER = 1,
+        R1CS_CONSTRAINTS = 2,
+        R1CS_WIRE_TO_LABEL = 3
+    };
+
+    enum WtnsSection
+    {
+        WTNS_HEADER = 1,
+        WTNS_VALUES = 2
+    };
+
+    // The number of bytes of a field element
+    static uint32_t getFieldSize()
+    {
+        return FieldT::num_limbs * sizeof(mp_limb_t);
+    }
+
+    static bool writeConstraints(const ProtoboardT &pb, const std::string &filename, size_t chunkSize = 1 << 14)
+    {
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cerr << "Cannot create r1cs file: " << filename << std::endl;
+            return false;
+        }
+        const auto &cs = pb.constraint_system;
+        const uint32_t numWires = 1 + cs.primary_input_size + cs.auxiliary_input_size;
+
+        std::vector<char> buffer;
+        appendUint32(buffer, R1CS_MAGIC);
+        appendUint32(buffer, R1CS_VERSION);
+        appendUint32(buffer, 3);
+
+        // Header
+        appendSectionHeader(buffer, R1CS_HEADER, 4 + getFieldSize() + 4 * 4 + 8 + 4);
+        appendUint32(buffer, getFieldSize());
+        appendBigInt(buffer, FieldT::mod);
+        appendUint32(buffer, numWires);
+        // Number of public outputs
+        appendUint32(buffer, 0);
+        appendUint32(buffer, cs.primary_input_size);
+        appendUint32(buffer, cs.auxiliary_input_size);
+        // Number of labels
+        appendUint64(buffer, numWires);
+        appendUint32(buffer, cs.constraints.size());
+        file.write(buffer.data(), buffer.size());
+
+        // Constraints, the size of the section is only known when all constraints are written
+        buffer.clear();
+        appendSectionHeader(buffer, R1CS_CONSTRAINTS, 0);
+        const std::streamoff sizeOffset = file.tellp() + std::streamoff(4);
+        file.write(buffer.data(), buffer.size());
+        auto serializeConstraint = [&cs](size_t i, std::vector<char> &out) {
+            appendLinearCombination(out, cs.constraints[i]->getA());
+            appendLinearCombination(out, cs.constraints[i]->getB());
+            appendLinearCombination(out, cs.constraints[i]->getC());
+        };
+        uint64_t sectionSize = writeChunks(file, cs.constraints.size(), chunkSize, serializeConstraint);
+        const std::streamoff end = file.tellp();
+        file.seekp(sizeOffset);
+        file.write((const char *)&sectionSize, sizeof(sectionSize));
+        file.seekp(end);
+
+        // Wire to label map, the labels are the variable indices
+        buffer.clear();
+        appendSectionHeader(buffer, R1CS_WIRE_TO_LABEL, uint64_t(numWires) * 8);
+        file.write(buffer.data(), buffer.size());
+        writeChunks(file, numWires, chunkSize, [](size_t i, std::vector<char> &out) { appendUint64(out, i); });
+
+        file.close();
+        return !file.fail();
+    }
+
+    static bool writeWitness(const ProtoboardT &pb, const std::string &filename, size_t chunkSize = 1 << 16)
+    {
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cerr << "Cannot create wtns file: " << filename << std::endl;
+            return false;
+        }
+        const uint32_t numWires = 1 + pb.values.size();
+
+        std::vector<char> buffer;
+        appendUint32(buffer, WTNS_MAGIC);
+        appendUint32(buffer, WTNS_VERSION);
+        appendUint32(buffer, 2);
+        appendSectionHeader(buffer, WTNS_HEADER, 4 + getFieldSize() + 4);
+        appendUint32(buffer, getFieldSize());
+        appendBigInt(buffer, FieldT::mod);
+        appendUint32(buffer, numWires);
+        appendSectionHeader(buffer, WTNS_VALUES, uint64_t(numWires) * getFieldSize());
+        appendField(buffer, FieldT::one());
+        file.write(buffer.data(), buffer.size());
+        auto serializeValue = [&pb](size_t i, std::vector<char> &out) { appendField(out, pb.values[i]); };
+        writeChunks(file, pb.values.size(), chunkSize, serializeValue);
+
+        file.close();
+        return !file.fail();
+    }
+
+    // Creates the variables and constraints of the file in an empty protoboard
+    static bool readConstraints(const std::string &filename, ProtoboardT &pb)
+    {
+        std::map<uint32_t, std::vector<char>> sections;
+        if (!readSections(filename, R1CS_MAGIC, R1CS_VERSION, sections) || !sections.count(R1CS_HEADER) ||
+            !sections.count(R1CS_CONSTRAINTS))
+        {
+            std::cerr << "Invalid r1cs file: " << filename << std::endl;
+            return false;
+        }
+        const std::vector<char> &header = sections[R1CS_HEADER];
+        size_t offset = 0;
+        if (!checkFieldHeader(header, offset) || header.size() < offset + 4 * 5 + 8)
+        {
+            std::cerr << "r1cs file " << filename << " is not for this field" << std::endl;
+            return false;
+        }
+        const uint32_t numWires = readUint32(header, offset);
+        const uint32_t numPublicOutputs = readUint32(header, offset);
+        const uint32_t numPublicInputs = readUint32(header, offset);
+        // The number of private inputs and labels follow from the number of wires
+        readUint32(header, offset);
+        readUint64(header, offset);
+        const uint32_t numConstraints = readUint32(header, offset);
+
+        for (uint32_t i = 1; i < numWires; i++)
+        {
+            VariableT variable;
+            variable.allocate(pb, "wire");
+        }
+        pb.set_input_sizes(numPublicOutputs + numPublicInputs);
+
+        const std::vector<char> &data = sections[R1CS_CONSTRAINTS];
+        offset = 0;
+        for (uint32_t i = 0; i < numConstraints; i++)
+        {
+            LinearCombinationT a, b, c;
+            if (!readLinearCombination(data, offset, numWires, a) ||
+                !readLinearCombination(data, offset, numWires, b) ||
+                !readLinearCombination(data, offset, numWires, c))
+            {
+                std::cerr << "r1cs file " << filename << " is truncated" << std::endl;
+                return false;
+            }
+            pb.add_r1cs_constraint(ConstraintT(a, b, c), "constraint");
+        }
+        return true;
+    }
+
+    // Reads the witness into `pb.values`, the file needs to have a value for every variable
+    static bool readWitness(const std::string &filename, ProtoboardT &pb, size_t chunkSize = 1 << 16)
+    {
+        std::map<uint32_t, std::vector<char>> sections;
+        if (!readSections(filename, WTNS_MAGIC, WTNS_VERSION, sections) || !sections.count(WTNS_HEADER) ||
+            !sections.count(WTNS_VALUES))
+        {
+            std::cerr << "Invalid wtns file: " << filename << std::endl;
+            return false;
+        }
+        const std::vector<char> &header = sections[WTNS_HEADER];
+        size_t offset = 0;
+        if (!checkFieldHeader(header, offset) || header.size() < offset + 4)
+        {
+            std::cerr << "wtns file " << filename << " is not for this field" << std::endl;
+            return false;
+        }
+        const uint32_t numWires = readUint32(header, offset);
+        const std::vector<char> &data = sections[WTNS_VALUES];
+        if (numWires != 1 + pb.values.size() || data.size() != size_t(numWires) * getFieldSize())
+        {
+            std::cerr << "wtns file " << filename << " does not match the circuit" << std::endl;
+            return false;
+        }
+
+        const size_t numValues = pb.values.size();
+        const size_t numChunks = (numValues + chunkSize - 1) / chunkSize;
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+        for (size_t c = 0; c < numChunks; c++)
+        {
+            const size_t end = std::min((c + 1) * chunkSize, numValues);
+            for (size_t i = c * chunkSize; i < end; i++)
+            {
+                // Skip the constant
+                pb.values[i] = toField(data.data() + (i + 1) * getFieldSize());
+            }
+        }
+        return true;
+    }
+
+  private:
+    static void appendUint32(std::vector<char> &buffer, uint32_t value)
+    {
+        buffer.insert(buffer.end(), (const char *)&value, (const char *)&value + sizeof(value));
+    }
+
+    static void appendUint64(std::vector<char> &buffer, uint64_t value)
+    {
+        buffer.insert(buffer.end(), (const char *)&value, (const char *)&value + sizeof(value));
+    }
+
+    static void appendSectionHeader(std::vector<char> &buffer, uint32_t type, uint64_t size)
+    {
+        appendUint32(buffer, type);
+        appendUint64(buffer, size);
+    }
+
+    template <typename BigIntT> static void appendBigInt(std::vector<char> &buffer, const BigIntT &value)
+    {
+        buffer.insert(buffer.end(), (const char *)value.data, (const char *)value.data + getFieldSize());
+    }
+
+    static void appendField(std::vector<char> &buffer, const FieldT &value)
+    {
+        appendBigInt(buffer, value.as_bigint());
+    }
+
+    // The terms sorted on wire, with the coefficients of the same wire combined
+    template <typename LinearCombination>
+    static void appendLinearCombination(std::vector<char> &buffer, const LinearCombination &lc)
+    {
+        std::vector<std::pair<size_t, FieldT>> terms;
+        terms.reserve(lc.getTerms().size());
+        for (const auto &term : lc.getTerms())
+        {
+            terms.push_back(std::make_pair(size_t(term.index), term.getCoeff()));
+        }
+        typedef std::pair<size_t, FieldT> TermT;
+        std::sort(terms.begin(), terms.end(), [](const TermT &a, const TermT &b) { return a.first < b.first; });
+        size_t numTerms = 0;
+        for (size_t i = 0; i < terms.size(); i++)
+        {
+            if (numTerms > 0 && terms[numTerms - 1].first == terms[i].first)
+            {
+                terms[numTerms - 1].second += terms[i].second;
+            }
+            else
+            {
+                terms[numTerms++] = terms[i];
+            }
+        }
+        appendUint32(buffer, numTerms);
+        for (size_t i = 0; i < numTerms; i++)
+        {
+            appendUint32(buffer, terms[i].first);
+            appendField(buffer, terms[i].second);
+        }
+    }
+
+    // Serializes `count` items with `serialize(index, buffer)` in chunks of `chunkSize` items.
+    // As many chunks as there are threads are serialized in parallel before they are written,
+    // so the memory needed does not depend on the number of items. Returns the number of bytes written.
+    template <typename F> static uint64_t writeChunks(std::ofstream &file, size_t count, size_t chunkSize, F serialize)
+    {
+        const size_t numChunks = (count + chunkSize - 1) / chunkSize;
+#ifdef MULTICORE
+        const size_t numParallel = omp_get_max_threads();
+#else
+        const size_t numParallel = 1;
+#endif
+        std::vector<std::vector<char>> buffers(numParallel);
+        uint64_t size = 0;
+        for (size_t first = 0; first < numChunks; first += numParallel)
+        {
+            const size_t last = std::min(first + numParallel, numChunks);
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+            for (size_t c = first; c < last; c++)
+            {
+                std::vector<char> &buffer = buffers[c - first];
+                buffer.clear();
+                const size_t end = std::min((c + 1) * chunkSize, count);
+                for (size_t i = c * chunkSize; i < end; i++)
+                {
+                    serialize(i, buffer);
+                }
+            }
+            for (size_t c = first; c < last; c++)
+            {
+                file.write(buffers[c - first].data(), buffers[c - first].size());
+                size += buffers[c - first].size();
+            }
+        }
+        return size;
+    }
+
+    static bool readSections(
+      const std::string &filename,
+      uint32_t magic,
+      uint32_t version,
+      std::map<uint32_t, std::vector<char>> &sections)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        uint32_t header[3];
+        file.read((char *)header, sizeof(header));
+        if (!file.good() || header[0] != magic || header[1] != version)
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < header[2]; i++)
+        {
+            uint32_t type;
+            uint64_t size;
+            file.read((char *)&type, sizeof(type));
+            file.read((char *)&size, sizeof(size));
+            if (!file.good())
+            {
+                return false;
+            }
+            std::vector<char> &data = sections[type];
+            data.resize(size);
+            file.read(data.data(), size);
+            if (!file.good())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static uint32_t readUint32(const std::vector<char> &data, size_t &offset)
+    {
+        uint32_t value;
+        memcpy(&value, data.data() + offset, sizeof(value));
+        offset += sizeof(value);
+        return value;
+    }
+
+    static uint64_t readUint64(const std::vector<char> &data, size_t &offset)
+    {
+        uint64_t value;
+        memcpy(&value, data.data() + offset, sizeof(value));
+        offset += sizeof(value);
+        return value;
+    }
+
+    static FieldT toField(const char *data)
+    {
+        libff::bigint<FieldT::num_limbs> value;
+        memcpy(value.data, data, getFieldSize());
+        return FieldT(value);
+    }
+
+    // Checks that the field size and the prime match FieldT
+    static bool checkFieldHeader(const std::vector<char> &header, size_t &offset)
+    {
+        if (header.size() < 4 || readUint32(header, offset) != getFieldSize() ||
+            header.size() < offset + getFieldSize())
+        {
+            return false;
+        }
+        bool matches = memcmp(header.data() + offset, FieldT::mod.data, getFieldSize()) == 0;
+        offset += getFieldSize();
+        return matches;
+    }
+
+    static bool readLinearCombination(
+      const std::vector<char> &data,
+      size_t &offset,
+      uint32_t numWires,
+      LinearCombinationT &lc)
+    {
+        if (data.size() < offset + 4)
+        {
+            return false;
+        }
+        const uint32_t numTerms = readUint32(data, offset);
+        if (data.size() < offset + size_t(numTerms) * (4 + getFieldSize()))
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < numTerms; i++)
+        {
+            const uint32_t wire = readUint32(data, offset);
+            if (wire >= numWires)
+            {
+                return false;
+            }
+            lc.add_term(libsnark::variable<FieldT>(wire), toField(data.data() + offset));
+            offset += getFieldSize();
+        }
+        return true;
+    }
+};
+
+} // namespace Loopring
+
+#endif
@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _REQUESTBODY_H_
+#define _REQUESTBODY_H_
+
+#include "../ThirdParty/httplib.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+namespace Loopring
+{
+
+// Reads the body of a request into `body` (null when the body is empty).
+// Bodies larger than `maxLength` (the payload limit of the server) are rejected by the server,
+// the Content-Length sent by the client is only trusted up to that limit when reserving the buffer.
+// Returns false when the body could not be read, the response is already sent in that case.
+inline bool readRequestBody(
+  const httplib::Request &req,
+  const httplib::ContentReader &contentReader,
+  size_t maxLength,
+  std::shared_ptr<const std::string> &body)
+{
+    std::shared_ptr<std::string> data = std::make_shared<std::string>();
+    std::string contentLength = req.get_header_value("Content-Length");
+    if (contentLength.length() > 0)
+    {
+        data->reserve(std::min<unsigned long long>(strtoull(contentLength.c_str(), nullptr, 10), maxLength));
+    }
+    bool ok = contentReader([&data](const char *chunk, size_t length) {
+        data->append(chunk, length);
+        return true;
+    });
+    body = (ok && data->length() > 0) ? data : nullptr;
+    return ok;
+}
+
+} // namespace Loopring
+
+#endif
@@ -0,0 +1,433 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+#include <unistd.h>
+
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+namespace Loopring
+{
+
+// A pool of threads shared by all work in the process that is split in tasks (e.g. the witness
+// generation of the jobs of the prover server), so jobs that run at the same time share the same
+// threads instead of each starting threads of their own and oversubscribing the cores.
+//
+// Work is submitted as a `Job`, which has a thread budget (the maximum number of threads working on
+// the job at the same time, including the thread waiting on it) and optionally the CPUs the job runs on.
+// Tasks are added to a job with a `TaskGroup`. Tasks can add tasks of their own, waiting on a task group
+// runs the tasks of the group that weren't started yet on the waiting thread.
+//
+// This is a job-level runner pool, tasks are not stolen between threads: all tasks of a job are kept in
+// a single queue of the job, which is shared by the pool threads running the job (up to its budget) and
+// run newest first. Only these runners are queued per pool thread. Runners started from a pool thread go
+// to its own queue and are run newest first, idle threads steal the oldest runners of the other threads.
+class ThreadPool
+{
+  public:
+    class TaskGroup;
+
+    class Job
+    {
+      public:
+        // Uses the thread budget and the CPUs set for the calling thread
+        Job(ThreadPool &_pool) : Job(_pool, getThreadBudget(), getThreadCpus())
+        {
+        }
+
+        // `numThreads` of 0 uses all threads of the pool, no `cpus` runs the job on any CPU
+        Job(ThreadPool &_pool, unsigned int numThreads, const std::vector<unsigned int> &_cpus = {})
+            : pool(_pool), cpus(_cpus), numRunners(0)
+        {
+            numThreads = (numThreads == 0) ? pool.getNumThreads() + 1 : numThreads;
+            // The thread waiting on the job runs tasks as well
+            maxRunners = std::min(numThreads, pool.getNumThreads() + 1) - 1;
+        }
+
+        Job(const Job &) = delete;
+        Job &operator=(const Job &) = delete;
+
+        // All task groups of the job are done, waits until the pool threads have left the job
+        ~Job()
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            idle.wait(lock, [this]() { return numRunners == 0; });
+        }
+
+      private:
+        friend class TaskGroup;
+
+        struct Task
+        {
+            std::function<void()> run;
+            TaskGroup *group;
+        };
+
+        ThreadPool &pool;
+        const std::vector<unsigned int> cpus;
+        unsigned int maxRunners;
+        std::mutex mtx;
+        std::condition_variable idle;
+        // Newest tasks at the back
+        std::deque<Task> tasks;
+        // The number of pool threads working on the job
+        unsigned int numRunners;
+
+        void push(Task task)
+        {
+            bool startRunner = false;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                tasks.push_back(std::move(task));
+                if (numRunners < maxRunners)
+                {
+                    numRunners++;
+                    startRunner = true;
+                }
+            }
+            if (startRunner)
+            {
+                pool.post([this]() { runTasks(); });
+            }
+        }
+
+        // Takes the newest task of `group` that wasn't started yet
+        bool pop(TaskGroup *group, Task &task)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            for (auto it = tasks.rbegin(); it != tasks.rend(); ++it)
+            {
+                if (it->group == group)
+                {
+                    task = std::move(*it);
+                    tasks.erase(std::next(it).base());
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Run by a pool thread until all tasks of the job are started
+        void runTasks()
+        {
+            cpu_set_t previous;
+            bool pinned = cpus.size() > 0 && sched_getaffinity(0, sizeof(previous), &previous) == 0;
+            if (pinned)
+            {
+                setThreadAffinity(cpus);
+            }
+            while (true)
+            {
+                Task task;
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    if (tasks.empty())
+                    {
+                        if (pinned)
+                        {
+                            sched_setaffinity(0, sizeof(previous), &previous);
+                        }
+                        // The job can be destroyed as soon as the lock is released
+                        numRunners--;
+                        idle.notify_all();
+                        return;
+                    }
+                    task = std::move(tasks.back());
+                    tasks.pop_back();
+                }
+                run(task);
+            }
+        }
+
+        static void run(Task &task)
+        {
+            task.run();
+            task.group->finish();
+        }
+    };
+
+    // Tasks of a job that are waited on together.
+    // Needs to be waited on (or destroyed) before the data the tasks use goes away.
+    class TaskGroup
+    {
+      public:
+        TaskGroup(Job &_job) : job(_job), numPending(0)
+        {
+        }
+
+        TaskGroup(const TaskGroup &) = delete;
+        TaskGroup &operator=(const TaskGroup &) = delete;
+
+        ~TaskGroup()
+        {
+            wait();
+        }
+
+        void run(std::function<void()> task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                numPending++;
+            }
+            job.push(Job::Task{std::move(task), this});
+        }
+
+        // Runs the tasks of the group that weren't started yet, then waits for the others
+        void wait()
+        {
+            Job::Task task;
+            while (job.pop(this, task))
+            {
+                Job::run(task);
+            }
+            std::unique_lock<std::mutex> lock(mtx);
+            done.wait(lock, [this]() { return numPending == 0; });
+        }
+
+      private:
+        friend class Job;
+
+        Job &job;
+        std::mutex mtx;
+        std::condition_variable done;
+        unsigned int numPending;
+
+        void finish()
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (--numPending == 0)
+            {
+                done.notify_all();
+            }
+        }
+    };
+
+    // `numThreads` of 0 uses a thread for every CPU.
+    // With `cpus` the threads only run on those CPUs (the CPUs of a job are used instead while working on it).
+    ThreadPool(unsigned int numThreads = 0, const std::vector<unsigned int> &_cpus = {})
+        : cpus(_cpus), stopping(false), generation(0), nextWorker(0)
+    {
+        numThreads = (numThreads == 0) ? std::max(1u, std::thread::hardware_concurrency()) : numThreads;
+        for (unsigned int i = 0; i < numThreads; i++)
+        {
+            workers.emplace_back(new Worker());
+        }
+        for (unsigned int i = 0; i < numThreads; i++)
+        {
+            workers[i]->thread = std::thread([this, i]() { runWorker(i); });
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // All jobs need to be done
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+            workAvailable.notify_all();
+        }
+        for (const std::unique_ptr<Worker> &worker : workers)
+        {
+            worker->thread.join();
+        }
+    }
+
+    // The pool of the process, created with a thread for every CPU when first used.
+    // A forked process gets a new pool (the threads of the parent don't exist in the child).
+    static ThreadPool &get()
+    {
+        static std::mutex poolMutex;
+        static ThreadPool *pool = nullptr;
+        static pid_t owner = 0;
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (pool == nullptr || owner != getpid())
+        {
+            // The pool of the parent is never destroyed, its threads can't be joined
+            pool = new ThreadPool();
+            owner = getpid();
+        }
+        return *pool;
+    }
+
+    unsigned int getNumThreads() const
+    {
+        return workers.size();
+    }
+
+    // The thread budget and the CPUs of the jobs created by the calling thread (0 for all threads),
+    // like `omp_set_num_threads` only changes the number of threads used by the calling thread.
+    static void setThreadBudget(unsigned int numThreads, const std::vector<unsigned int> &cpus = {})
+    {
+        threadBudget() = numThreads;
+        threadCpus() = cpus;
+    }
+
+    static unsigned int getThreadBudget()
+    {
+        return threadBudget();
+    }
+
+    static std::vector<unsigned int> getThreadCpus()
+    {
+        return threadCpus();
+    }
+
+    // Restricts the calling thread to the CPUs
+    static bool setThreadAffinity(const std::vector<unsigned int> &cpus)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (unsigned int cpu : cpus)
+        {
+            CPU_SET(cpu, &set);
+        }
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+    }
+
+  private:
+    struct Worker
+    {
+        std::mutex mtx;
+        // Newest work at the back
+        std::deque<std::function<void()>> work;
+        std::thread thread;
+    };
+
+    const std::vector<unsigned int> cpus;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex mtx;
+    std::condition_variable workAvailable;
+    bool stopping;
+    // Incremented every time work is posted, so idle threads don't miss work posted while they look for work
+    uint64_t generation;
+    unsigned int nextWorker;
+
+    static unsigned int &threadBudget()
+    {
+        static thread_local unsigned int numThreads = 0;
+        return numThreads;
+    }
+
+    static std::vector<unsigned int> &threadCpus()
+    {
+        static thread_local std::vector<unsigned int> cpus;
+        return cpus;
+    }
+
+    // The index of the calling thread in its pool
+    static int &workerIndex()
+    {
+        static thread_local int index = -1;
+        return index;
+    }
+
+    static ThreadPool *&workerPool()
+    {
+        static thread_local ThreadPool *pool = nullptr;
+        return pool;
+    }
+
+    void post(std::function<void()> work)
+    {
+        unsigned int index;
+        if (workerPool() == this)
+        {
+            index = workerIndex();
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            index = nextWorker;
+            nextWorker = (nextWorker + 1) % workers.size();
+        }
+        {
+            std::lock_guard<std::mutex> lock(workers[index]->mtx);
+            workers[index]->work.push_back(std::move(work));
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        generation++;
+        workAvailable.notify_all();
+    }
+
+    bool take(unsigned int index, std::function<void()> &work)
+    {
+        // Own work, newest first
+        {
+            Worker &worker = *workers[index];
+            std::lock_guard<std::mutex> lock(worker.mtx);
+            if (!worker.work.empty())
+            {
+                work = std::move(worker.work.back());
+                worker.work.pop_back();
+                return true;
+            }
+        }
+        // Steal the oldest work of the other threads
+        for (unsigned int i = 1; i < workers.size(); i++)
+        {
+            Worker &worker = *workers[(index + i) % workers.size()];
+            std::lock_guard<std::mutex> lock(worker.mtx);
+            if (!worker.work.empty())
+            {
+                work = std::move(worker.work.front());
+                worker.work.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void runWorker(unsigned int index)
+    {
+        workerPool() = this;
+        workerIndex() = index;
+        if (cpus.size() > 0)
+        {
+            setThreadAffinity(cpus);
+        }
+#ifdef MULTICORE
+        // The pool threads are the parallelism, OpenMP regions inside tasks don't start threads of their own
+        omp_set_num_threads(1);
+#endif
+        while (true)
+        {
+            uint64_t seen;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (stopping)
+                {
+                    return;
+                }
+                seen = generation;
+            }
+            std::function<void()> work;
+            if (take(index, work))
+            {
+                work();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mtx);
+            workAvailable.wait(lock, [&]() { return stopping || generation != seen; });
+        }
+    }
+};
+
+} // namespace Loopring
+
+#endif
@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include "ethsnarks.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+namespace Loopring
+{
+
+// Records the duration of the stages of the prover in the Chrome trace event format
+// (viewable in chrome://tracing or Perfetto). Events are only recorded while a trace
+// session is active, otherwise tracing only costs an atomic load per scope.
+class Trace
+{
+  public:
+    static Trace &get()
+    {
+        static Trace trace;
+        return trace;
+    }
+
+    bool isEnabled() const
+    {
+        return numSessions > 0;
+    }
+
+    // Microseconds, uses the same clock as the libff profiling
+    static uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::high_resolution_clock::now().time_since_epoch())
+          .count();
+    }
+
+    // A small ID for the calling thread
+    static unsigned int threadID()
+    {
+        static std::atomic<unsigned int> nextID(0);
+        thread_local unsigned int id = nextID++;
+        return id;
+    }
+
+    // Starts recording, returns the start of the session
+    uint64_t begin()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        numSessions++;
+        return now();
+    }
+
+    // Stops recording for the session started at `start`.
+    // Returns the trace with all events recorded during the session (also those of other threads).
+    json end(uint64_t start)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        json trace;
+        trace["traceEvents"] = json::array();
+        for (const json &event : events)
+        {
+            if (event["ts"].get<uint64_t>() >= start)
+            {
+                trace["traceEvents"].push_back(event);
+            }
+        }
+        trace["displayTimeUnit"] = "ms";
+        if (--numSessions == 0)
+        {
+            events.clear();
+        }
+        return trace;
+    }
+
+    // Adds a complete event
+    void add(
+      const std::string &name,
+      const std::string &category,
+      uint64_t start,
+      uint64_t duration,
+      const json &args = json(),
+      unsigned int tid = threadID())
+    {
+        json event;
+        event["name"] = name;
+        event["cat"] = category;
+        event["ph"] = "X";
+        event["ts"] = start;
+        event["dur"] = duration;
+        event["pid"] = getpid();
+        event["tid"] = tid;
+        if (!args.is_null())
+        {
+            event["args"] = args;
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        if (numSessions > 0)
+        {
+            events.push_back(std::move(event));
+        }
+    }
+
+  private:
+    std::atomic<unsigned int> numSessions;
+    std::vector<json> events;
+    std::mutex mtx;
+
+    Trace() : numSessions(0)
+    {
+    }
+};
+
+// Records an event for the lifetime of the scope when tracing is enabled.
+// Arguments can be added to `args` when `isActive()`.
+class TraceScope
+{
+  public:
+    json args;
+
+    TraceScope(const char *_name, const char *_category)
+        : name(_name), category(_category), start(Trace::get().isEnabled() ? Trace::now() : 0)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (isActive())
+        {
+            Trace::get().add(name, category, start, Trace::now() - start, args);
+        }
+    }
+
+    bool isActive() const
+    {
+        return start != 0;
+    }
+
+  private:
+    const char *name;
+    const char *category;
+    uint64_t start;
+};
+
+} // namespace Loopring
+
+#endif
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _TUNER_H_
+#define _TUNER_H_
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Loopring
+{
+
+// A parameter with `numValues` possible values.
+// The parameter is tuned on the score of its `group` (e.g. only the duration of the FFT for FFT options).
+struct TunerParameter
+{
+    std::string name;
+    std::string group;
+    unsigned int numValues;
+};
+
+// The score (lower is better) of every group in a single measurement
+typedef std::map<std::string, double> TunerScores;
+
+// Statistics of repeated measurements of a single candidate
+struct TunerStats
+{
+    unsigned int numSamples;
+    double median;
+    // Median absolute deviation
+    double deviation;
+};
+
+// Searches the best combination of parameter values without measuring every combination.
+//
+// Coordinate descent: a single parameter is tuned at a time with all other parameters fixed
+// at the best values found so far. This is repeated until no parameter changes anymore.
+// The values of a parameter are compared with successive halving: every remaining value is measured,
+// the slower half is dropped and the remaining values are measured again with twice as many samples.
+// Values are compared on the median of their samples, which is robust against outliers.
+//
+// A candidate is the index of the value of every parameter.
+// All measurements are kept, so candidates measured before are not measured again.
+class Tuner
+{
+  public:
+    typedef std::vector<unsigned int> CandidateT;
+    typedef std::function<TunerScores(const CandidateT &)> MeasureT;
+
+    Tuner(const std::vector<TunerParameter> &_parameters, MeasureT _measure, unsigned int _maxSamples)
+        : parameters(_parameters), measure(_measure), maxSamples(std::max(_maxSamples, 1u)), numMeasurements(0)
+    {
+    }
+
+    // Returns the best candidate found starting from `start`, at most `maxPasses` passes over all parameters
+    CandidateT run(const CandidateT &start, unsigned int maxPasses = 3)
+    {
+        CandidateT best = start;
+        for (unsigned int pass = 0; pass < maxPasses; pass++)
+        {
+            bool changed = false;
+            for (unsigned int p = 0; p < parameters.size(); p++)
+            {
+                if (parameters[p].numValues < 2)
+                {
+                    continue;
+                }
+                std::vector<CandidateT> candidates;
+                for (unsigned int v = 0; v < parameters[p].numValues; v++)
+                {
+                    CandidateT candidate = best;
+                    candidate[p] = v;
+                    candidates.push_back(candidate);
+                }
+                CandidateT winner = successiveHalving(candidates, parameters[p].group);
+                if (winner != best)
+                {
+                    best = winner;
+                    changed = true;
+                }
+            }
+            if (!changed)
+            {
+                break;
+            }
+        }
+        return best;
+    }
+
+    // The statistics of the score of `group` of a candidate
+    TunerStats getStats(const CandidateT &candidate, const std::string &group) const
+    {
+        std::vector<double> values;
+        auto it = samples.find(candidate);
+        if (it != samples.end())
+        {
+            for (const TunerScores &scores : it->second)
+            {
+                values.push_back(getScore(scores, group));
+            }
+        }
+        TunerStats stats;
+        stats.numSamples = values.size();
+        stats.median = median(values);
+        for (double &value : values)
+        {
+            value = std::abs(value - stats.median);
+        }
+        stats.deviation = median(values);
+        return stats;
+    }
+
+    // The number of times `measure` was called
+    unsigned int getNumMeasurements() const
+    {
+        return numMeasurements;
+    }
+
+    static double median(std::vector<double> values)
+    {
+        if (values.size() == 0)
+        {
+            return 0.0;
+        }
+        std::sort(values.begin(), values.end());
+        size_t middle = values.size() / 2;
+        return (values.size() % 2 == 1) ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+    }
+
+  private:
+    std::vector<TunerParameter> parameters;
+    MeasureT measure;
+    unsigned int maxSamples;
+    unsigned int numMeasurements;
+    std::map<CandidateT, std::vector<TunerScores>> samples;
+
+    // Groups without a score of their own use the total
+    static double getScore(const TunerScores &scores, const std::string &group)
+    {
+        auto it = scores.find(group);
+        if (it == scores.end())
+        {
+            it = scores.find("total");
+        }
+        return (it != scores.end()) ? it->second : 0.0;
+    }
+
+    CandidateT successiveHalving(std::vector<CandidateT> candidates, const std::string &group)
+    {
+        unsigned int numSamples = 1;
+        while (true)
+        {
+            for (const CandidateT &candidate : candidates)
+            {
+                std::vector<TunerScores> &candidateSamples = samples[candidate];
+                while (candidateSamples.size() < numSamples)
+                {
+                    candidateSamples.push_back(measure(candidate));
+                    numMeasurements++;
+                }
+            }
+            std::stable_sort(candidates.begin(), candidates.end(), [&](const CandidateT &a, const CandidateT &b) {
+                return getStats(a, group).median < getStats(b, group).median;
+            });
+            if (candidates.size() == 1 || numSamples >= maxSamples)
+            {
+                return candidates[0];
+            }
+            candidates.resize((candidates.size() + 1) / 2);
+            numSamples = std::min(numSamples * 2, maxSamples);
+        }
+    }
+};
+
+} // namespace Loopring
+
+#endif
@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _WITNESSFILE_H_
+#define _WITNESSFILE_H_
+
+#include "ethsnarks.hpp"
+
+#include <fstream>
+#include <iostream>
+
+using namespace ethsnarks;
+
+namespace Loopring
+{
+
+// Witness file with all values of the protoboard stored in their in-memory representation,
+// so a witness generated by one process can be proven by another one.
+// The file can only be read by a prover built with the same field type.
+//
+// Layout:
+// - WitnessFileHeader
+// - numValues field elements (`pb.values`)
+struct WitnessFileHeader
+{
+    static const uint64_t MAGIC = 0x4e544957474e524cULL; // "LRNGWITN"
+    static const uint64_t VERSION = 1;
+
+    uint64_t magic;
+    uint64_t version;
+    uint64_t sizeField;
+    uint64_t blockType;
+    uint64_t blockSize;
+    // Fingerprint of the constraint system the witness was generated for
+    uint64_t fingerprint;
+    uint64_t numPrimaryInputs;
+    uint64_t numValues;
+};
+
+class WitnessFile
+{
+  public:
+    // Hash of the structure of the constraint system (the variables and coefficients used in every constraint).
+    // A witness can only be proven with a circuit with the same fingerprint.
+    static uint64_t getFingerprint(const ProtoboardT &pb)
+    {
+        const auto &cs = pb.constraint_system;
+        uint64_t hash = 14695981039346656037ULL;
+        add(hash, cs.primary_input_size);
+        add(hash, cs.auxiliary_input_size);
+        add(hash, cs.constraints.size());
+        for (const auto &constraint : cs.constraints)
+        {
+            addTerms(hash, constraint->getA());
+            addTerms(hash, constraint->getB());
+            addTerms(hash, constraint->getC());
+        }
+        return hash;
+    }
+
+    // Returns true if the file is a witness file
+    static bool isWitnessFile(const std::string &filename)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        return isWitnessFile(file);
+    }
+
+    // Returns true if the stream contains a witness file, the stream is left at its current position
+    static bool isWitnessFile(std::istream &stream)
+    {
+        std::streampos position = stream.tellg();
+        uint64_t magic = 0;
+        stream.read((char *)&magic, sizeof(magic));
+        bool isWitness = stream.good() && magic == WitnessFileHeader::MAGIC;
+        stream.clear();
+        stream.seekg(position);
+        return isWitness;
+    }
+
+    static bool write(
+      const ProtoboardT &pb,
+      unsigned int blockType,
+      unsigned int blockSize,
+      uint64_t fingerprint,
+      const std::string &filename)
+    {
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cerr << "Cannot create witness file: " << filename << std::endl;
+            return false;
+        }
+        WitnessFileHeader header;
+        header.magic = WitnessFileHeader::MAGIC;
+        header.version = WitnessFileHeader::VERSION;
+        header.sizeField = sizeof(FieldT);
+        header.blockType = blockType;
+        header.blockSize = blockSize;
+        header.fingerprint = fingerprint;
+        header.numPrimaryInputs = pb.constraint_system.primary_input_size;
+        header.numValues = pb.values.size();
+        file.write((const char *)&header, sizeof(header));
+        file.write((const char *)pb.values.data(), pb.values.size() * sizeof(FieldT));
+        file.close();
+        return !file.fail();
+    }
+
+    // Reads the header so the circuit the witness was generated for can be created
+    static bool readHeader(const std::string &filename, WitnessFileHeader &header)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Cannot open witness file: " << filename << std::endl;
+            return false;
+        }
+        return readHeader(file, header);
+    }
+
+    static bool readHeader(std::istream &stream, WitnessFileHeader &header)
+    {
+        stream.read((char *)&header, sizeof(header));
+        if (!stream.good() || header.magic != WitnessFileHeader::MAGIC ||
+            header.version != WitnessFileHeader::VERSION || header.sizeField != sizeof(FieldT))
+        {
+            std::cerr << "Invalid witness file" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Reads the witness directly into `pb.values`.
+    // Fails when the witness was generated for a circuit with a different fingerprint.
+    static bool load(const std::string &filename, uint64_t fingerprint, ProtoboardT &pb)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Cannot open witness file: " << filename << std::endl;
+            return false;
+        }
+        return load(file, fingerprint, pb);
+    }
+
+    static bool load(std::istream &stream, uint64_t fingerprint, ProtoboardT &pb)
+    {
+        WitnessFileHeader header;
+        if (!readHeader(stream, header))
+        {
+            return false;
+        }
+        if (header.fingerprint != fingerprint || header.numValues != pb.values.size() ||
+            header.numPrimaryInputs != pb.constraint_system.primary_input_size)
+        {
+            std::cerr << "Witness file was not generated for this circuit" << std::endl;
+            return false;
+        }
+        stream.read((char *)pb.values.data(), header.numValues * sizeof(FieldT));
+        if (!stream.good())
+        {
+            std::cerr << "Witness file is truncated" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+  private:
+    // FNV-1a
+    static void add(uint64_t &hash, uint64_t value)
+    {
+        hash ^= value;
+        hash *= 1099511628211ULL;
+    }
+
+    template <typename LinearCombinationT> static void addTerms(uint64_t &hash, const LinearCombinationT &lc)
+    {
+        add(hash, lc.getTerms().size());
+        for (const auto &term : lc.getTerms())
+        {
+            add(hash, term.index);
+            // The lowest limb of the coefficient
+            add(hash, term.getCoeff().as_bigint().as_ulong());
+        }
+    }
+};
+
+} // namespace Loopring
+
+#endif
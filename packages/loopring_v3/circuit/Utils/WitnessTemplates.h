@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _WITNESSTEMPLATES_H_
+#define _WITNESSTEMPLATES_H_
+
+#include "ethsnarks.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+using namespace ethsnarks;
+
+namespace Loopring
+{
+
+// The variables set by a part of the circuit and the variables it reads.
+// The part needs to allocate all its variables in the range (begin, end]
+// and the witness of these variables needs to only depend on the input variables.
+struct WitnessTemplateLayout
+{
+    size_t begin = 0;
+    size_t end = 0;
+    std::vector<size_t> inputs;
+    bool valid = false;
+
+    // Finds the inputs by looking at the variables used in the constraints [constraintsBegin, constraintsEnd).
+    // Only variables allocated before the part are allowed as inputs, otherwise the layout is invalid.
+    void build(
+      const ProtoboardT &pb,
+      size_t constraintsBegin,
+      size_t constraintsEnd,
+      const std::vector<VariableT> &extraInputs)
+    {
+        std::vector<bool> used(begin + 1, false);
+        valid = true;
+        inputs.clear();
+        auto addVariable = [&](size_t index) {
+            if (index > end)
+            {
+                valid = false;
+            }
+            else if (index > 0 && index <= begin && !used[index])
+            {
+                used[index] = true;
+                inputs.push_back(index);
+            }
+        };
+        for (size_t i = constraintsBegin; i < constraintsEnd && valid; i++)
+        {
+            const auto &constraint = pb.constraint_system.constraints[i];
+            for (const auto &term : constraint->getA().getTerms())
+            {
+                addVariable(term.index);
+            }
+            for (const auto &term : constraint->getB().getTerms())
+            {
+                addVariable(term.index);
+            }
+            for (const auto &term : constraint->getC().getTerms())
+            {
+                addVariable(term.index);
+            }
+        }
+        for (const VariableT &variable : extraInputs)
+        {
+            addVariable(variable.index);
+        }
+    }
+};
+
+// Caches the witness of parts of the circuit with the same layout by the values of their inputs.
+// The layouts of all parts using the same cache need to be the same up to an offset
+// (e.g. the same gadget in a different transaction slot).
+class WitnessTemplateCache
+{
+  public:
+    std::atomic<size_t> hits;
+    std::atomic<size_t> misses;
+
+    WitnessTemplateCache(size_t _maxEntries = 16) : hits(0), misses(0), maxEntries(_maxEntries), next(0)
+    {
+    }
+
+    // Sets the witness of the part when the values of its inputs are in the cache
+    bool apply(ProtoboardT &pb, const WitnessTemplateLayout &layout)
+    {
+        if (!layout.valid)
+        {
+            return false;
+        }
+        std::vector<FieldT> key = getKey(pb, layout);
+        uint64_t hash = getHash(key);
+        std::shared_ptr<const std::vector<FieldT>> values;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            for (const Entry &entry : entries)
+            {
+                if (entry.hash == hash && entry.key == key)
+                {
+                    values = entry.values;
+                    break;
+                }
+            }
+        }
+        if (!values)
+        {
+            misses++;
+            return false;
+        }
+        for (size_t i = 0; i < values->size(); i++)
+        {
+            pb.val(VariableT(layout.begin + 1 + i)) = (*values)[i];
+        }
+        hits++;
+        return true;
+    }
+
+    // Stores the witness of the part, needs to be called after its witness is generated
+    void store(const ProtoboardT &pb, const WitnessTemplateLayout &layout)
+    {
+        if (!layout.valid)
+        {
+            return;
+        }
+        Entry entry;
+        entry.key = getKey(pb, layout);
+        entry.hash = getHash(entry.key);
+        std::shared_ptr<std::vector<FieldT>> values(new std::vector<FieldT>());
+        values->reserve(layout.end - layout.begin);
+        for (size_t i = layout.begin + 1; i <= layout.end; i++)
+        {
+            values->push_back(pb.val(VariableT(i)));
+        }
+        entry.values = values;
+
+        std::lock_guard<std::mutex> lock(mtx);
+        for (const Entry &other : entries)
+        {
+            if (other.hash == entry.hash && other.key == entry.key)
+            {
+                return;
+            }
+        }
+        // Replace the oldest entry when full
+        if (entries.size() < maxEntries)
+        {
+            entries.push_back(std::move(entry));
+        }
+        else
+        {
+            entries[next] = std::move(entry);
+            next = (next + 1) % maxEntries;
+        }
+    }
+
+  private:
+    struct Entry
+    {
+        uint64_t hash;
+        std::vector<FieldT> key;
+        std::shared_ptr<const std::vector<FieldT>> values;
+    };
+
+    const size_t maxEntries;
+    size_t next;
+    std::vector<Entry> entries;
+    std::mutex mtx;
+
+    static std::vector<FieldT> getKey(const ProtoboardT &pb, const WitnessTemplateLayout &layout)
+    {
+        std::vector<FieldT> key;
+        key.reserve(layout.inputs.size());
+        for (size_t index : layout.inputs)
+        {
+            key.push_back(pb.val(VariableT(index)));
+        }
+        return key;
+    }
+
+    static uint64_t getHash(const std::vector<FieldT> &key)
+    {
+        // FNV-1a over the lowest limb of every value
+        uint64_t hash = 14695981039346656037ULL;
+        for (const FieldT &value : key)
+        {
+            hash ^= value.as_bigint().as_ulong();
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+};
+
+} // namespace Loopring
+
+#endif
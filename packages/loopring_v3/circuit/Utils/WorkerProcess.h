@@ -0,0 +1,260 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+#ifndef _WORKERPROCESS_H_
+#define _WORKERPROCESS_H_
+
+#include "ethsnarks.hpp"
+
+#include <functional>
+#include <iostream>
+#include <memory>
+
+#include <dirent.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+namespace Loopring
+{
+
+// A connection to another process exchanging JSON messages, one message per line
+class MessageChannel
+{
+  public:
+    MessageChannel(int _readFd, int _writeFd) : readFd(_readFd), writeFd(_writeFd)
+    {
+    }
+
+    ~MessageChannel()
+    {
+        close();
+    }
+
+    bool send(const json &message)
+    {
+        std::string data = message.dump() + "\n";
+        size_t written = 0;
+        while (written < data.size())
+        {
+            ssize_t n = ::write(writeFd, data.data() + written, data.size() - written);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return false;
+            }
+            written += n;
+        }
+        return true;
+    }
+
+    // Blocks until a message is received, returns false when the other side is gone
+    bool receive(json &message)
+    {
+        size_t pos;
+        while ((pos = buffer.find('\n')) == std::string::npos)
+        {
+            char data[4096];
+            ssize_t n = ::read(readFd, data, sizeof(data));
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return false;
+            }
+            buffer.append(data, n);
+        }
+        try
+        {
+            message = json::parse(buffer.substr(0, pos));
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Invalid message: " << e.what() << std::endl;
+            return false;
+        }
+        buffer.erase(0, pos + 1);
+        return true;
+    }
+
+    void close()
+    {
+        if (readFd >= 0)
+        {
+            ::close(readFd);
+            readFd = -1;
+        }
+        if (writeFd >= 0)
+        {
+            ::close(writeFd);
+            writeFd = -1;
+        }
+    }
+
+  private:
+    int readFd;
+    int writeFd;
+    std::string buffer;
+};
+
+// A forked child process running `run` with a message channel to the parent.
+// Everything in the memory of the parent at the time of the fork (e.g. the proving key and
+// the constraint system) is shared with the child copy-on-write, so data that is only read
+// by the child is never copied.
+// Processes need to be spawned before the parent starts any threads (including OpenMP threads):
+// only the forking thread exists in the child, locks held by the other threads are never released.
+class WorkerProcess
+{
+  public:
+    typedef std::function<int(MessageChannel &parent)> RunT;
+
+    pid_t pid;
+    MessageChannel channel;
+
+    // The child is pinned to `cpus` when not empty.
+    // The channels of the `siblings` are closed in the child, so each worker only
+    // keeps its own connection to the parent open.
+    static std::unique_ptr<WorkerProcess> spawn(
+      const RunT &run,
+      const std::vector<unsigned int> &cpus,
+      std::vector<std::unique_ptr<WorkerProcess>> &siblings)
+    {
+        if (getNumProcessThreads() > 1)
+        {
+            std::cerr << "Cannot fork a worker, the process already started threads" << std::endl;
+            return nullptr;
+        }
+
+        int toChild[2];
+        int toParent[2];
+        if (pipe(toChild) != 0)
+        {
+            return nullptr;
+        }
+        if (pipe(toParent) != 0)
+        {
+            ::close(toChild[0]);
+            ::close(toChild[1]);
+            return nullptr;
+        }
+
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            ::close(toChild[0]);
+            ::close(toChild[1]);
+            ::close(toParent[0]);
+            ::close(toParent[1]);
+            return nullptr;
+        }
+        if (pid == 0)
+        {
+            ::close(toChild[1]);
+            ::close(toParent[0]);
+            for (std::unique_ptr<WorkerProcess> &sibling : siblings)
+            {
+                sibling->channel.close();
+            }
+            if (cpus.size() > 0 && !setAffinity(cpus))
+            {
+                std::cerr << "Failed to set the CPU affinity of worker " << getpid() << std::endl;
+            }
+            MessageChannel parent(toChild[0], toParent[1]);
+            int result = run(parent);
+            parent.close();
+            // Don't run the destructors of the parent's objects
+            _exit(result);
+        }
+
+        ::close(toChild[0]);
+        ::close(toParent[1]);
+        return std::unique_ptr<WorkerProcess>(new WorkerProcess(pid, toParent[0], toChild[1]));
+    }
+
+    // Closes the channel, which stops a worker waiting for a message, and waits for the process to exit
+    int stop()
+    {
+        channel.close();
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        {
+        }
+        return status;
+    }
+
+    void kill()
+    {
+        ::kill(pid, SIGKILL);
+    }
+
+    // Parses a CPU list like "0-3,8,10-11"
+    static std::vector<unsigned int> parseCpuList(const std::string &list)
+    {
+        std::vector<unsigned int> cpus;
+        size_t begin = 0;
+        while (begin < list.size())
+        {
+            size_t end = list.find(',', begin);
+            end = (end == std::string::npos) ? list.size() : end;
+            std::string range = list.substr(begin, end - begin);
+            size_t dash = range.find('-');
+            unsigned int first = std::stoul(range.substr(0, dash));
+            unsigned int last = (dash == std::string::npos) ? first : std::stoul(range.substr(dash + 1));
+            for (unsigned int cpu = first; cpu <= last; cpu++)
+            {
+                cpus.push_back(cpu);
+            }
+            begin = end + 1;
+        }
+        return cpus;
+    }
+
+    // The number of threads of the calling process, 0 when unknown
+    static unsigned int getNumProcessThreads()
+    {
+        DIR *dir = opendir("/proc/self/task");
+        if (dir == nullptr)
+        {
+            return 0;
+        }
+        unsigned int numThreads = 0;
+        while (struct dirent *entry = readdir(dir))
+        {
+            if (entry->d_name[0] != '.')
+            {
+                numThreads++;
+            }
+        }
+        closedir(dir);
+        return numThreads;
+    }
+
+  private:
+    WorkerProcess(pid_t _pid, int readFd, int writeFd) : pid(_pid), channel(readFd, writeFd)
+    {
+    }
+
+    static bool setAffinity(const std::vector<unsigned int> &cpus)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (unsigned int cpu : cpus)
+        {
+            CPU_SET(cpu, &set);
+        }
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+    }
+};
+
+} // namespace Loopring
+
+#endif
@@ -0,0 +1,445 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2017 Loopring Technology Limited.
+
+// Measures the cost of single gadgets: the number of constraints and variables,
+// the time to construct them (including their constraints) and the time per witness call.
+//
+// Usage: dex_circuit_bench [-o <results.json>] [-b <baseline.json>] [-block <block.json>]
+// The results of a previous run can be passed with -b to show the differences.
+
+#include "../Circuits/UniversalCircuit.h"
+#include "../Gadgets/AccountGadgets.h"
+#include "../Gadgets/MatchingGadgets.h"
+#include "../Gadgets/MathGadgets.h"
+#include "../Gadgets/MerkleTree.h"
+#include "../Gadgets/SignatureGadgets.h"
+#include "../Utils/Data.h"
+
+#include "ethsnarks.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+
+using namespace ethsnarks;
+using namespace Loopring;
+
+// Witness calls are repeated until at least this much time is spent on a gadget
+static const double MIN_WITNESS_TIME_US = 200000.0;
+static const unsigned int MIN_WITNESS_ITERATIONS = 3;
+static const unsigned int MAX_WITNESS_ITERATIONS = 100000;
+
+static double elapsed_us(const std::chrono::high_resolution_clock::time_point &begin)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - begin).count();
+}
+
+// Everything a gadget is created with, lives as long as the gadget
+struct BenchContext
+{
+    ProtoboardT pb;
+    Constants constants;
+    jubjub::Params params;
+    // Gadgets keep references to their inputs, a deque keeps them at the same address
+    std::deque<VariableT> variables;
+    std::deque<VariableArrayT> arrays;
+
+    BenchContext() : constants(pb, "constants")
+    {
+    }
+
+    const VariableT &variable(const FieldT &value, const std::string &name)
+    {
+        variables.push_back(make_variable(pb, value, name));
+        return variables.back();
+    }
+
+    VariableArrayT &array(size_t size, const std::string &name)
+    {
+        arrays.push_back(make_var_array(pb, size, name));
+        return arrays.back();
+    }
+};
+
+// Creates the gadget and its constraints and returns the function generating its witness
+typedef std::function<std::function<void()>(BenchContext &context)> CreateGadgetT;
+
+// Measures a single gadget
+static json measure(const std::string &name, const CreateGadgetT &create)
+{
+    std::cout << "Measuring " << name << "..." << std::endl;
+    BenchContext context;
+    ProtoboardT &pb = context.pb;
+    size_t numConstraintsBefore = pb.num_constraints();
+    size_t numVariablesBefore = pb.num_variables();
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    std::function<void()> generateWitness = create(context);
+    double construct_us = elapsed_us(begin);
+
+    // The first call also allocates
+    generateWitness();
+
+    unsigned int numIterations = 0;
+    double total_us = 0;
+    double min_us = 0;
+    while (numIterations < MAX_WITNESS_ITERATIONS &&
+           (numIterations < MIN_WITNESS_ITERATIONS || total_us < MIN_WITNESS_TIME_US))
+    {
+        begin = std::chrono::high_resolution_clock::now();
+        generateWitness();
+        double duration_us = elapsed_us(begin);
+        min_us = (numIterations == 0) ? duration_us : std::min(min_us, duration_us);
+        total_us += duration_us;
+        numIterations++;
+    }
+
+    json result;
+    result["name"] = name;
+    result["constraints"] = pb.num_constraints() - numConstraintsBefore;
+    result["variables"] = pb.num_variables() - numVariablesBefore;
+    result["construct_ms"] = construct_us / 1000.0;
+    result["witness_us"] = total_us / numIterations;
+    result["witness_min_us"] = min_us;
+    result["witness_iterations"] = numIterations;
+    return result;
+}
+
+template <typename PoseidonT> static CreateGadgetT createPoseidon(unsigned int numInputs)
+{
+    return [numInputs](BenchContext &context) {
+        std::vector<VariableT> inputs;
+        for (unsigned int i = 0; i < numInputs; i++)
+        {
+            inputs.push_back(context.variable(FieldT(i + 1), ".input"));
+        }
+        auto hash = std::make_shared<PoseidonT>(context.pb, var_array(inputs), "hash");
+        hash->generate_r1cs_constraints();
+        return [hash]() { hash->generate_r1cs_witness(); };
+    };
+}
+
+static AccountState createAccountState(BenchContext &context, const AccountLeaf &leaf)
+{
+    AccountState state;
+    state.owner = context.variable(leaf.owner, ".owner");
+    state.publicKeyX = context.variable(leaf.publicKey.x, ".publicKeyX");
+    state.publicKeyY = context.variable(leaf.publicKey.y, ".publicKeyY");
+    state.nonce = context.variable(leaf.nonce, ".nonce");
+    state.feeBipsAMM = context.variable(leaf.feeBipsAMM, ".feeBipsAMM");
+    state.balancesRoot = context.variable(leaf.balancesRoot, ".balancesRoot");
+    return state;
+}
+
+static FieldT decodeFloat(const FieldT &f)
+{
+    return FieldT(fromFloat(f.as_bigint().as_ulong(), Float24Encoding).to_string().c_str());
+}
+
+static std::vector<json> runBenchmarks(const Block &block)
+{
+    // Use a spot trade for realistic values
+    const UniversalTransaction *spotTrade = nullptr;
+    for (const UniversalTransaction &tx : block.transactions)
+    {
+        if (tx.type == FieldT(int(TransactionType::SpotTrade)))
+        {
+            spotTrade = &tx;
+            break;
+        }
+    }
+    if (spotTrade == nullptr)
+    {
+        throw std::runtime_error("The block needs to contain a spot trade");
+    }
+    const Witness &witness = spotTrade->witness;
+
+    std::vector<json> results;
+    results.push_back(measure("Poseidon_2", createPoseidon<Poseidon_2>(2)));
+    results.push_back(measure("Poseidon_4", createPoseidon<Poseidon_4>(4)));
+    results.push_back(measure("Poseidon_5", createPoseidon<Poseidon_5>(5)));
+    results.push_back(measure("Poseidon_6", createPoseidon<Poseidon_6>(6)));
+
+    results.push_back(measure("merkle_path_authenticator_4", [&](BenchContext &context) {
+        const AccountUpdate &update = witness.accountUpdate_A;
+        VariableArrayT &address = context.array(NUM_BITS_ACCOUNT, ".address");
+        address.fill_with_bits_of_field_element(context.pb, update.accountID);
+        VariableArrayT &path = context.array(TREE_DEPTH_ACCOUNTS * 3, ".path");
+        path.fill_with_field_elements(context.pb, update.proof.data);
+        auto merklePath = std::make_shared<MerklePathCheckT>(
+          context.pb,
+          TREE_DEPTH_ACCOUNTS,
+          address,
+          context.variable(FieldT::one(), ".leaf"),
+          context.variable(update.rootBefore, ".root"),
+          path,
+          ".merklePath");
+        merklePath->generate_r1cs_constraints();
+        return [merklePath]() { merklePath->generate_r1cs_witness(); };
+    }));
+
+    results.push_back(measure("UpdateAccountGadget", [&](BenchContext &context) {
+        const AccountUpdate &update = witness.accountUpdate_A;
+        VariableArrayT &address = context.array(NUM_BITS_ACCOUNT, ".address");
+        address.fill_with_bits_of_field_element(context.pb, update.accountID);
+        auto updateAccount = std::make_shared<UpdateAccountGadget>(
+          context.pb,
+          context.variable(update.rootBefore, ".root"),
+          address,
+          createAccountState(context, update.before),
+          createAccountState(context, update.after),
+          ".updateAccount");
+        updateAccount->generate_r1cs_constraints();
+        return [updateAccount, update]() { updateAccount->generate_r1cs_witness(update); };
+    }));
+
+    results.push_back(measure("SignatureVerifier", [&](BenchContext &context) {
+        // The time does not depend on the signature being valid, so it is not required to be
+        auto publicKey = std::make_shared<jubjub::VariablePointT>(context.pb, ".publicKey");
+        context.pb.val(publicKey->x) = witness.accountUpdate_A.before.publicKey.x;
+        context.pb.val(publicKey->y) = witness.accountUpdate_A.before.publicKey.y;
+        auto verifier = std::make_shared<SignatureVerifier>(
+          context.pb,
+          context.params,
+          context.constants,
+          *publicKey,
+          context.variable(FieldT::one(), ".message"),
+          context.constants._0,
+          ".signatureVerifier");
+        verifier->generate_r1cs_constraints();
+        Signature signature = witness.signatureA;
+        return [verifier, publicKey, signature]() { verifier->generate_r1cs_witness(signature); };
+    }));
+
+    results.push_back(measure("FloatGadget", [&](BenchContext &context) {
+        auto floatGadget = std::make_shared<FloatGadget>(context.pb, context.constants, Float24Encoding, ".float");
+        floatGadget->generate_r1cs_constraints();
+        FieldT f = spotTrade->spotTrade.fillS_A;
+        return [floatGadget, f]() { floatGadget->generate_r1cs_witness(f); };
+    }));
+
+    results.push_back(measure("MulDivGadget", [&](BenchContext &context) {
+        const Order &order = spotTrade->spotTrade.orderA;
+        auto mulDiv = std::make_shared<MulDivGadget>(
+          context.pb,
+          context.constants,
+          context.variable(decodeFloat(spotTrade->spotTrade.fillS_A), ".value"),
+          context.variable(order.amountB, ".numerator"),
+          context.variable(order.amountS, ".denominator"),
+          NUM_BITS_AMOUNT,
+          NUM_BITS_AMOUNT,
+          NUM_BITS_AMOUNT,
+          ".mulDiv");
+        mulDiv->generate_r1cs_constraints();
+        return [mulDiv]() { mulDiv->generate_r1cs_witness(); };
+    }));
+
+    results.push_back(measure("OrderMatchingGadget", [&](BenchContext &context) {
+        const SpotTrade &trade = spotTrade->spotTrade;
+        const VariableT &exchange = context.variable(block.exchange, ".exchange");
+        auto orderA = std::make_shared<OrderGadget>(context.pb, context.constants, exchange, ".orderA");
+        auto orderB = std::make_shared<OrderGadget>(context.pb, context.constants, exchange, ".orderB");
+        orderA->generate_r1cs_constraints();
+        orderB->generate_r1cs_constraints();
+        orderA->generate_r1cs_witness(trade.orderA);
+        orderB->generate_r1cs_witness(trade.orderB);
+        auto orderMatching = std::make_shared<OrderMatchingGadget>(
+          context.pb,
+          context.constants,
+          context.variable(block.timestamp, ".timestamp"),
+          *orderA,
+          *orderB,
+          context.variable(witness.accountUpdate_A.before.owner, ".ownerA"),
+          context.variable(witness.accountUpdate_B.before.owner, ".ownerB"),
+          context.variable(witness.storageUpdate_A.before.data, ".filledA"),
+          context.variable(witness.storageUpdate_B.before.data, ".filledB"),
+          context.variable(decodeFloat(trade.fillS_A), ".fillS_A"),
+          context.variable(decodeFloat(trade.fillS_B), ".fillS_B"),
+          ".orderMatching");
+        orderMatching->generate_r1cs_constraints();
+        return [orderMatching, orderA, orderB]() { orderMatching->generate_r1cs_witness(); };
+    }));
+
+    results.push_back(measure("CalcOutGivenInAMMGadget", [&](BenchContext &context) {
+        auto calcOut = std::make_shared<CalcOutGivenInAMMGadget>(
+          context.pb,
+          context.constants,
+          context.variable(witness.balanceUpdateB_A.before.balance, ".balanceIn"),
+          context.variable(witness.balanceUpdateS_A.before.balance, ".balanceOut"),
+          context.variable(FieldT(20), ".feeBips"),
+          context.variable(decodeFloat(spotTrade->spotTrade.fillS_B), ".amountIn"),
+          ".calcOut");
+        calcOut->generate_r1cs_constraints();
+        return [calcOut]() { calcOut->generate_r1cs_witness(); };
+    }));
+
+    // The data of a single transaction
+    results.push_back(measure("PublicDataGadget", [&](BenchContext &context) {
+        VariableArrayT &bits = context.array(TX_DATA_AVAILABILITY_SIZE * 8, ".data");
+        bits.fill_with_bits_of_field_element(context.pb, spotTrade->spotTrade.orderA.amountS);
+        auto publicData = std::make_shared<PublicDataGadget>(context.pb, ".publicData");
+        publicData->add(bits);
+        publicData->generate_r1cs_constraints();
+        return [publicData]() { publicData->generate_r1cs_witness(); };
+    }));
+
+    // A complete transaction of every type, types missing in the block use the dummy transaction data
+    for (unsigned int t = 0; t < unsigned(TransactionType::COUNT); t++)
+    {
+        UniversalTransaction transaction = block.transactions[0];
+        transaction.type = FieldT(t);
+        for (const UniversalTransaction &tx : block.transactions)
+        {
+            if (tx.type == FieldT(t))
+            {
+                transaction = tx;
+                break;
+            }
+        }
+        std::string name = std::string("TransactionGadget.") + getTransactionTypeName(t);
+        results.push_back(measure(name, [&](BenchContext &context) {
+            VariableArrayT &operatorAccountID = context.array(NUM_BITS_ACCOUNT, ".operatorAccountID");
+            operatorAccountID.fill_with_bits_of_field_element(context.pb, block.operatorAccountID);
+            auto gadget = std::make_shared<TransactionGadget>(
+              context.pb,
+              context.params,
+              context.constants,
+              context.variable(block.exchange, ".exchange"),
+              context.variable(transaction.witness.accountUpdate_A.rootBefore, ".accountsRoot"),
+              context.variable(block.timestamp, ".timestamp"),
+              context.variable(block.protocolTakerFeeBips, ".protocolTakerFeeBips"),
+              context.variable(block.protocolMakerFeeBips, ".protocolMakerFeeBips"),
+              operatorAccountID,
+              context.variable(block.accountUpdate_P.before.balancesRoot, ".protocolBalancesRoot"),
+              context.constants._0,
+              ".tx");
+            gadget->generate_r1cs_constraints();
+            UniversalTransaction tx = transaction;
+            return [gadget, tx]() { gadget->generate_r1cs_witness(tx); };
+        }));
+    }
+    return results;
+}
+
+// Prints the results, with the differences to `baseline` (results of a previous run) when available
+static void printResults(const std::vector<json> &results, const json &baseline)
+{
+    std::map<std::string, json> baselineResults;
+    if (baseline.is_object() && baseline.count("gadgets"))
+    {
+        for (const json &result : baseline["gadgets"])
+        {
+            baselineResults[result["name"].get<std::string>()] = result;
+        }
+    }
+
+    std::cout << std::left << std::setw(40) << "gadget" << std::right << std::setw(12) << "constraints"
+              << std::setw(12) << "variables" << std::setw(14) << "construct ms" << std::setw(14) << "witness us"
+              << std::endl;
+    for (const json &result : results)
+    {
+        std::string name = result["name"].get<std::string>();
+        std::cout << std::left << std::setw(40) << name << std::right << std::setw(12)
+                  << result["constraints"].get<size_t>() << std::setw(12) << result["variables"].get<size_t>()
+                  << std::setw(14) << std::fixed << std::setprecision(2) << result["construct_ms"].get<double>()
+                  << std::setw(14) << result["witness_us"].get<double>();
+        auto it = baselineResults.find(name);
+        if (it != baselineResults.end())
+        {
+            const json &base = it->second;
+            long constraintsDelta =
+              long(result["constraints"].get<size_t>()) - long(base["constraints"].get<size_t>());
+            double witnessDelta =
+              (result["witness_us"].get<double>() / base["witness_us"].get<double>() - 1.0) * 100.0;
+            std::cout << "  (" << std::showpos << constraintsDelta << " constraints, " << std::setprecision(1)
+                      << witnessDelta << "% witness)" << std::noshowpos;
+        }
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ethsnarks::ppT::init_public_params();
+
+    std::string outputFilename;
+    std::string baselineFilename;
+    std::string blockFilename = "./circuit/test/data/block.json";
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-o") == 0)
+        {
+            outputFilename = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-b") == 0)
+        {
+            baselineFilename = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-block") == 0)
+        {
+            blockFilename = argv[i + 1];
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (argc % 2 == 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [-o <results.json>] [-b <baseline.json>] [-block <block.json>]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::ifstream blockFile(blockFilename);
+    if (!blockFile.is_open())
+    {
+        std::cerr << "Cannot open block file: " << blockFilename << std::endl;
+        return 1;
+    }
+    json input;
+    blockFile >> input;
+    Block block = input.get<Block>();
+
+    json baseline;
+    if (baselineFilename.length() > 0)
+    {
+        std::ifstream baselineFile(baselineFilename);
+        if (!baselineFile.is_open())
+        {
+            std::cerr << "Cannot open baseline file: " << baselineFilename << std::endl;
+            return 1;
+        }
+        baselineFile >> baseline;
+    }
+
+    std::vector<json> results = runBenchmarks(block);
+    printResults(results, baseline);
+
+    if (outputFilename.length() > 0)
+    {
+        json output;
+        output["gadgets"] = results;
+#ifdef MULTICORE
+        output["multicore"] = true;
+#else
+        output["multicore"] = false;
+#endif
+        std::ofstream file(outputFilename);
+        file << output.dump(4) << std::endl;
+        if (!file.good())
+        {
+            std::cerr << "Failed to write results to " << outputFilename << std::endl;
+            return 1;
+        }
+        std::cout << "Results written to " << outputFilename << std::endl;
+    }
+    return 0;
+}
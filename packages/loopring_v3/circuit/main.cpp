@@ -3,6 +3,24 @@
 
 #include "ThirdParty/BigInt.hpp"
 #include "Utils/Data.h"
+#include "Utils/BatchVerifier.h"
+#include "Utils/BlockGenerator.h"
+#include "Utils/BlockReader.h"
+#include "Utils/BoundedQueue.h"
+#include "Utils/ConstraintChecker.h"
+#include "Utils/JobQueue.h"
+#include "Utils/MappedProvingKey.h"
+#include "Utils/Memory.h"
+#include "Utils/MemoryStream.h"
+#include "Utils/Metrics.h"
+#include "Utils/Trace.h"
+#include "Utils/Tuner.h"
+#include "Utils/ProofCache.h"
+#include "Utils/R1CSFile.h"
+#include "Utils/RequestBody.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/WitnessFile.h"
+#include "Utils/WorkerProcess.h"
 #include "Circuits/UniversalCircuit.h"
 
 #include "ThirdParty/httplib.h"
@@ -10,9 +28,22 @@
 #include "ethsnarks.hpp"
 #include "import.hpp"
 #include "stubs.hpp"
+#include <libff/common/profiling.hpp>
 #include <fstream>
 #include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <set>
+#include <thread>
+
+#include <dirent.h>
+#include <sys/stat.h>
 
 #ifdef MULTICORE
 #include <omp.h>
@@ -97,7 +128,12 @@ enum class Mode
     ExportCircuit,
     ExportWitness,
     Server,
-    Benchmark
+    Supervisor,
+    Benchmark,
+    Tune,
+    Witness,
+    ProveWitness,
+    ProveBatch
 };
 
 namespace libsnark
@@ -141,8 +177,121 @@ static void from_json(const nlohmann::json &j, libsnark::Config &config)
         config.multi_exp_look_ahead = j.at("multi_exp_look_ahead").get<unsigned int>();
     }
 }
+
+static void to_json(nlohmann::json &j, const libsnark::Config &config)
+{
+    j["num_threads"] = config.num_threads;
+    j["smt"] = config.smt;
+    j["fft"] = config.fft;
+    j["radixes"] = config.radixes;
+    j["swapAB"] = config.swapAB;
+    j["multi_exp_c"] = config.multi_exp_c;
+    j["multi_exp_prefetch_locality"] = config.multi_exp_prefetch_locality;
+    j["prefetch_stride"] = config.prefetch_stride;
+    j["multi_exp_look_ahead"] = config.multi_exp_look_ahead;
+}
 } // namespace libsnark
 
+// Options of the prover that are not part of the libsnark config
+struct ProverOptions
+{
+    bool witness_templates = false;
+    // The maximum number of blocks waiting to be proven by the server
+    unsigned int max_queued_jobs = 64;
+    // Generate the witness of the next block while the current block is being proven by the server.
+    // Needs memory for a second copy of the witness.
+    bool double_buffering = true;
+    // The CPUs of the prover workers of the supervisor (e.g. ["0-15", "16-31"]), used round robin.
+    // The workers are not pinned when empty.
+    std::vector<std::string> worker_cpus;
+    // Other block sizes the server can prove besides the size of the block passed at startup
+    // (needs the proving key of every size). The circuits are created when first needed.
+    std::vector<unsigned int> block_sizes;
+    // The maximum number of circuits the server keeps loaded (0 for no limit, 1 only keeps the circuit
+    // of the block passed at startup), the least recently used circuit is unloaded first.
+    unsigned int max_loaded_circuits = 0;
+    // The directory of the persistent proof cache of the server (disabled when empty).
+    // Blocks that were already proven are returned from the cache without proving them again.
+    std::string proof_cache_dir;
+    // The maximum disk space used by the proof cache, the least recently used proofs are removed first
+    double proof_cache_max_gb = 1;
+    // The directory where the witness of a block is stored until the block is proven (disabled when empty).
+    // A prover that is restarted for the same block and circuit continues with the proof.
+    std::string checkpoint_dir;
+    // The path of a Unix domain socket the server listens on besides the TCP port (disabled when empty)
+    std::string unix_socket;
+    // The maximum size of a block uploaded to the server, larger requests are rejected
+    double max_upload_gb = 1;
+    // The thread budget of the witness generation of a block on the shared thread pool.
+    // With double buffering the witness is generated while the previous block is proven, 0 then uses
+    // the cores not used by the num_threads prover threads (or the witness_cpus), otherwise num_threads.
+    unsigned int witness_threads = 0;
+    // The CPUs the witness generation runs on (e.g. "0-7", not pinned when empty)
+    std::string witness_cpus;
+    // The CPUs the prover threads of the server and of -provebatch run on (e.g. "8-31", not pinned when empty)
+    std::string prover_cpus;
+};
+
+static void from_json(const nlohmann::json &j, ProverOptions &options)
+{
+    if (j.contains("witness_templates"))
+    {
+        options.witness_templates = j.at("witness_templates").get<bool>();
+    }
+    if (j.contains("max_queued_jobs"))
+    {
+        options.max_queued_jobs = j.at("max_queued_jobs").get<unsigned int>();
+    }
+    if (j.contains("double_buffering"))
+    {
+        options.double_buffering = j.at("double_buffering").get<bool>();
+    }
+    if (j.contains("worker_cpus"))
+    {
+        options.worker_cpus = j.at("worker_cpus").get<std::vector<std::string>>();
+    }
+    if (j.contains("block_sizes"))
+    {
+        options.block_sizes = j.at("block_sizes").get<std::vector<unsigned int>>();
+    }
+    if (j.contains("max_loaded_circuits"))
+    {
+        options.max_loaded_circuits = j.at("max_loaded_circuits").get<unsigned int>();
+    }
+    if (j.contains("proof_cache_dir"))
+    {
+        options.proof_cache_dir = j.at("proof_cache_dir").get<std::string>();
+    }
+    if (j.contains("proof_cache_max_gb"))
+    {
+        options.proof_cache_max_gb = j.at("proof_cache_max_gb").get<double>();
+    }
+    if (j.contains("checkpoint_dir"))
+    {
+        options.checkpoint_dir = j.at("checkpoint_dir").get<std::string>();
+    }
+    if (j.contains("unix_socket"))
+    {
+        options.unix_socket = j.at("unix_socket").get<std::string>();
+    }
+    if (j.contains("max_upload_gb"))
+    {
+        options.max_upload_gb = j.at("max_upload_gb").get<double>();
+    }
+    if (j.contains("witness_threads"))
+    {
+        options.witness_threads = j.at("witness_threads").get<unsigned int>();
+    }
+    if (j.contains("witness_cpus"))
+    {
+        options.witness_cpus = j.at("witness_cpus").get<std::string>();
+    }
+    if (j.contains("prover_cpus"))
+    {
+        options.prover_cpus = j.at("prover_cpus").get<std::string>();
+    }
+}
+
 struct BenchmarkConfig
 {
     unsigned int num_iterations;
@@ -189,6 +338,12 @@ template <typename T> void print_time(const T &t1, const char *str)
     printf("%s (%dms)\n", str, elapsed_time_ms(t1));
 }
 
+bool hasExtension(const std::string &fileName, const std::string &extension)
+{
+    return fileName.size() >= extension.size() &&
+           fileName.compare(fileName.size() - extension.size(), extension.size(), extension) == 0;
+}
+
 bool fileExists(const std::string &fileName)
 {
     std::ifstream infile(fileName.c_str());
@@ -250,10 +405,74 @@ libsnark::Config loadConfig(const std::string &filename)
     return loadJSON(filename).get<libsnark::Config>();
 }
 
+// Only loads the type and the size of the block, the rest of the block is not parsed
+json loadBlockHeader(const std::string &filename)
+{
+    std::ifstream file(filename.c_str());
+    if (!file.is_open())
+    {
+        std::cerr << "Cannot open json file: " << filename << std::endl;
+        return json();
+    }
+    return Loopring::BlockReader::readHeader(file, {"blockType", "blockSize"});
+}
+
+ProverOptions loadOptions(const std::string &filename)
+{
+    return loadJSON(filename).get<ProverOptions>();
+}
+
+// Sets the threads used by the calling thread: `numThreads` OpenMP threads to prove,
+// the witness is generated on the shared thread pool with the budget and the CPUs of the options
+// (by default the cores left by the prover threads when both run at the same time).
+void setNumThreads(unsigned int numThreads, const ProverOptions &options)
+{
+#ifdef MULTICORE
+    omp_set_num_threads(numThreads);
+#endif
+    std::vector<unsigned int> witnessCpus = Loopring::WorkerProcess::parseCpuList(options.witness_cpus);
+    unsigned int numWitnessThreads = numThreads;
+    if (options.witness_threads > 0)
+    {
+        numWitnessThreads = options.witness_threads;
+    }
+    else if (witnessCpus.size() > 0)
+    {
+        numWitnessThreads = witnessCpus.size();
+    }
+    else if (options.double_buffering)
+    {
+        // The witness is generated while the prover threads are busy, split the cores between them
+        unsigned int numCores = std::max(1u, std::thread::hardware_concurrency());
+        numWitnessThreads = (numCores > numThreads) ? numCores - numThreads : 1;
+    }
+    Loopring::ThreadPool::setThreadBudget(numWitnessThreads, witnessCpus);
+}
+
+// Pins the calling thread to the prover CPUs, the OpenMP threads it starts to prove inherit the CPUs.
+// Needs to be called before the thread proves for the first time.
+void pinProverThread(const ProverOptions &options)
+{
+    std::vector<unsigned int> cpus = Loopring::WorkerProcess::parseCpuList(options.prover_cpus);
+    if (cpus.size() > 0 && !Loopring::ThreadPool::setThreadAffinity(cpus))
+    {
+        std::cerr << "Failed to pin the prover thread to CPUs " << options.prover_cpus << std::endl;
+    }
+}
+
 void loadProvingKey(const std::string &pk_file, ethsnarks::ProvingKeyT &proving_key)
 {
     std::cout << "Loading proving key " << pk_file << "..." << std::endl;
     auto begin = now();
+    if (Loopring::MappedProvingKey::isMappedFile(pk_file))
+    {
+        if (!Loopring::MappedProvingKey::load(pk_file, proving_key))
+        {
+            throw std::runtime_error("Failed to load proving key");
+        }
+        print_time(begin, "Proving key loaded");
+        return;
+    }
     auto pk = ethsnarks::load_proving_key(pk_file.c_str());
     proving_key.alpha_g1 = std::move(pk.alpha_g1);
     proving_key.beta_g1 = std::move(pk.beta_g1);
@@ -273,11 +492,85 @@ VerificationKeyT loadVerificationKey(const std::string &vk_file)
     return vk_from_json(loadJSON(vk_file));
 }
 
-std::string proveCircuit(ProverContextT &context, Loopring::Circuit *circuit)
+// Verifies all proofs with batched pairing checks (see Utils/BatchVerifier.h)
+bool runVerifyBatch(const std::string &vkFilename, const std::vector<std::string> &proofFilenames)
+{
+    VerificationKeyT vk = loadVerificationKey(vkFilename);
+
+    std::cout << "Loading " << proofFilenames.size() << " proofs..." << std::endl;
+    auto begin = now();
+    std::vector<Loopring::ProofWithInputs> proofs;
+    for (const std::string &proofFilename : proofFilenames)
+    {
+        std::ifstream file(proofFilename);
+        if (!file.is_open())
+        {
+            std::cerr << "Cannot open proof file: " << proofFilename << std::endl;
+            return false;
+        }
+        proofs.push_back(proof_from_json(file));
+    }
+    print_time(begin, "Proofs loaded");
+
+    std::cout << "Verifying proofs..." << std::endl;
+    begin = now();
+    Loopring::BatchVerifier verifier(vk);
+    std::vector<size_t> invalid = verifier.verify(proofs);
+    print_time(begin, "Proofs verified");
+    for (size_t index : invalid)
+    {
+        std::cerr << "Invalid proof: " << proofFilenames[index] << std::endl;
+    }
+    std::cout << (proofs.size() - invalid.size()) << "/" << proofs.size() << " proofs are valid" << std::endl;
+    return invalid.size() == 0;
+}
+
+// The duration in seconds of every prover phase profiled by libff since `before` was taken
+json getProverProfile(const std::map<std::string, size_t> &before)
+{
+    json profile = json::object();
+    for (const auto &it : libff::invocation_counts)
+    {
+        auto previous = before.find(it.first);
+        if (previous == before.end() || previous->second != it.second)
+        {
+            profile[it.first] = libff::last_times[it.first] * 1e-9;
+        }
+    }
+    return profile;
+}
+
+// Adds the prover phases profiled by libff to the trace
+void traceProverProfile(const json &profile)
+{
+    Loopring::Trace &trace = Loopring::Trace::get();
+    if (!trace.isEnabled())
+    {
+        return;
+    }
+    for (auto it = profile.begin(); it != profile.end(); ++it)
+    {
+        // The libff times are in ns
+        trace.add(it.key(), "prover", libff::enter_times[it.key()] / 1000, libff::last_times[it.key()] / 1000);
+    }
+}
+
+// Proves the witness in `pb`, which needs to be the protoboard of the circuit
+// or a protoboard holding a witness of the circuit (see `WitnessBuffer`).
+// `profile` gets the duration of the prover phases (e.g. the FFTs and multiexps).
+std::string proveCircuit(
+  ProverContextT &context,
+  Loopring::Circuit *circuit,
+  ethsnarks::ProtoboardT &pb,
+  json &profile)
 {
     std::cout << "Generating proof..." << std::endl;
+    Loopring::TraceScope scope("prove", "stage");
     auto begin = now();
-    std::string jProof = ethsnarks::prove(context, circuit->getPb());
+    std::map<std::string, size_t> invocationCounts = libff::invocation_counts;
+    std::string jProof = ethsnarks::prove(context, pb);
+    profile = getProverProfile(invocationCounts);
+    traceProverProfile(profile);
     unsigned int elapsed_ms = elapsed_time_ms(begin);
     elapsed_ms = elapsed_ms == 0 ? 1 : elapsed_ms;
     std::cout << "Proof generated in " << float(elapsed_ms) / 1000.0f << " seconds ("
@@ -285,8 +578,20 @@ std::string proveCircuit(ProverContextT &context, Loopring::Circuit *circuit)
     return jProof;
 }
 
+std::string proveCircuit(ProverContextT &context, Loopring::Circuit *circuit, ethsnarks::ProtoboardT &pb)
+{
+    json profile;
+    return proveCircuit(context, circuit, pb, profile);
+}
+
+std::string proveCircuit(ProverContextT &context, Loopring::Circuit *circuit)
+{
+    return proveCircuit(context, circuit, circuit->getPb());
+}
+
 bool writeProof(const std::string &jProof, const std::string &proofFilename)
 {
+    Loopring::TraceScope scope("write", "stage");
     std::ofstream fproof(proofFilename);
     if (!fproof.is_open())
     {
@@ -317,6 +622,7 @@ Loopring::Circuit *createCircuit(unsigned int blockType, unsigned int blockSize,
 
 bool generateWitness(Loopring::Circuit *circuit, const json &input)
 {
+    Loopring::TraceScope scope("witness", "stage");
     std::cout << "Generating witness... " << std::endl;
     auto begin = now();
     if (!circuit->generateWitness(input))
@@ -328,14 +634,232 @@ bool generateWitness(Loopring::Circuit *circuit, const json &input)
     return true;
 }
 
-bool validateCircuit(Loopring::Circuit *circuit)
+// Generates the witness while the block is being read
+bool generateWitness(Loopring::Circuit *circuit, std::istream &stream)
+{
+    Loopring::TraceScope scope("witness", "stage");
+    std::cout << "Generating witness... " << std::endl;
+    auto begin = now();
+    if (!circuit->generateWitness(stream))
+    {
+        std::cerr << "Could not generate witness!" << std::endl;
+        return false;
+    }
+    print_time(begin, "Witness generated");
+    return true;
+}
+
+bool generateWitness(Loopring::Circuit *circuit, const std::string &blockFilename)
+{
+    std::ifstream file(blockFilename.c_str());
+    if (!file.is_open())
+    {
+        std::cerr << "Cannot open json file: " << blockFilename << std::endl;
+        return false;
+    }
+    return generateWitness(circuit, file);
+}
+
+// The fingerprints of the constraint systems of the circuits, only calculated once per circuit
+static std::mutex circuitFingerprintsMutex;
+static std::map<Loopring::Circuit *, uint64_t> circuitFingerprints;
+
+uint64_t getCircuitFingerprint(Loopring::Circuit *circuit)
+{
+    std::lock_guard<std::mutex> lock(circuitFingerprintsMutex);
+    auto it = circuitFingerprints.find(circuit);
+    if (it == circuitFingerprints.end())
+    {
+        it = circuitFingerprints.emplace(circuit, Loopring::WitnessFile::getFingerprint(circuit->getPb())).first;
+    }
+    return it->second;
+}
+
+// Needs to be called when a circuit is destroyed, a new circuit can get the same address
+void forgetCircuitFingerprint(Loopring::Circuit *circuit)
+{
+    std::lock_guard<std::mutex> lock(circuitFingerprintsMutex);
+    circuitFingerprints.erase(circuit);
+}
+
+bool writeWitness(Loopring::Circuit *circuit, const std::string &witnessFilename)
+{
+    Loopring::TraceScope scope("write", "stage");
+    auto begin = now();
+    if (!Loopring::WitnessFile::write(
+          circuit->getPb(),
+          circuit->getBlockType(),
+          circuit->getBlockSize(),
+          getCircuitFingerprint(circuit),
+          witnessFilename))
+    {
+        std::cerr << "Failed to write witness to " << witnessFilename << std::endl;
+        return false;
+    }
+    print_time(begin, "Witness written");
+    std::cout << "Witness written to: " << witnessFilename << std::endl;
+    return true;
+}
+
+// Loads a witness written with -witness instead of generating it
+bool loadWitness(Loopring::Circuit *circuit, std::istream &stream)
+{
+    Loopring::TraceScope scope("witness", "stage");
+    std::cout << "Loading witness... " << std::endl;
+    auto begin = now();
+    if (!Loopring::WitnessFile::load(stream, getCircuitFingerprint(circuit), circuit->getPb()))
+    {
+        std::cerr << "Could not load witness!" << std::endl;
+        return false;
+    }
+    print_time(begin, "Witness loaded");
+    return true;
+}
+
+bool loadWitness(Loopring::Circuit *circuit, const std::string &witnessFilename)
+{
+    std::ifstream file(witnessFilename, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Cannot open witness file: " << witnessFilename << std::endl;
+        return false;
+    }
+    return loadWitness(circuit, file);
+}
+
+// Opens the block of a job, the block uploaded with the request or the block file
+std::unique_ptr<std::istream> openJobBlock(const Loopring::ProverJob &job)
+{
+    if (job.blockData)
+    {
+        return std::unique_ptr<std::istream>(new Loopring::MemoryStream(job.blockData));
+    }
+    std::unique_ptr<std::istream> file(new std::ifstream(job.blockFilename, std::ios::binary));
+    if (!file->good())
+    {
+        std::cerr << "Cannot open block file: " << job.blockFilename << std::endl;
+    }
+    return file;
+}
+
+// Hash of the contents of the block file of a job (see ProofCache::hashFile).
+// Uploaded blocks are not hashed: the hash is not collision resistant, so an uploaded block could be made to
+// match the key of another block. Their proofs are only found in the cache with the public input.
+bool hashJobBlock(const Loopring::ProverJob &job, uint64_t &hash)
+{
+    if (job.blockData)
+    {
+        return false;
+    }
+    return Loopring::ProofCache::hashFile(job.blockFilename, hash);
+}
+
+// The witness checkpoint of the block of a job in `checkpointDir` (see the checkpoint_dir option),
+// empty when disabled or for uploaded blocks. The checkpoint is identified by the contents of the block
+// and the circuit, checkpoints of jobs that validate the block are only written once the block was validated.
+// Only the witness is checkpointed, the prover stages (FFTs and multiexps) run in a single call of the prover.
+std::string getWitnessCheckpointFilename(
+  const std::string &checkpointDir,
+  Loopring::Circuit *circuit,
+  const Loopring::ProverJob &job)
+{
+    uint64_t hash;
+    if (checkpointDir.length() == 0 || Loopring::WitnessFile::isWitnessFile(*openJobBlock(job)) ||
+        !hashJobBlock(job, hash))
+    {
+        return "";
+    }
+    return checkpointDir + "/" + Loopring::ProofCache::toHex(hash) + "_" +
+           Loopring::ProofCache::toHex(getCircuitFingerprint(circuit)) + (job.validate ? "_validated" : "") +
+           ".wit";
+}
+
+// Loads the witness from the checkpoint when there is one, an invalid checkpoint is removed
+bool loadWitnessCheckpoint(Loopring::Circuit *circuit, const std::string &checkpointFilename)
+{
+    if (checkpointFilename.length() == 0 || !fileExists(checkpointFilename))
+    {
+        return false;
+    }
+    std::cout << "Resuming from witness checkpoint " << checkpointFilename << std::endl;
+    if (!loadWitness(circuit, checkpointFilename))
+    {
+        std::remove(checkpointFilename.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Stores the witness of the circuit in the checkpoint.
+// The file is renamed when complete, so a checkpoint is never partially written.
+void writeWitnessCheckpoint(Loopring::Circuit *circuit, const std::string &checkpointFilename)
+{
+    if (checkpointFilename.length() == 0)
+    {
+        return;
+    }
+    std::string checkpointDir = checkpointFilename.substr(0, checkpointFilename.rfind('/'));
+    if (mkdir(checkpointDir.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        std::cerr << "Failed to create checkpoint directory " << checkpointDir << std::endl;
+        return;
+    }
+    // Processes checkpointing the same block (e.g. the workers of the supervisor) don't share the temporary file
+    std::string tempFilename = checkpointFilename + "." + std::to_string(getpid()) + ".tmp";
+    if (!writeWitness(circuit, tempFilename) || std::rename(tempFilename.c_str(), checkpointFilename.c_str()) != 0)
+    {
+        std::remove(tempFilename.c_str());
+    }
+}
+
+// Removes the checkpoint after the block is proven
+void removeWitnessCheckpoint(const std::string &checkpointFilename)
+{
+    if (checkpointFilename.length() > 0)
+    {
+        std::remove(checkpointFilename.c_str());
+    }
+}
+
+// The constraint with the transaction and the gadget it belongs to (when known)
+std::string describeConstraint(Loopring::Circuit *circuit, size_t index)
 {
+    std::string description = "constraint " + std::to_string(index);
+    std::string location = circuit->describeConstraint(index);
+    if (location.length() > 0)
+    {
+        description += " in " + location;
+    }
+    std::string annotation = Loopring::getConstraintAnnotation(circuit->getPb(), index);
+    if (annotation.length() > 0)
+    {
+        description += ": " + annotation;
+    }
+    return description;
+}
+
+// When the block is invalid `error` (if set) describes the first constraints that are not satisfied
+bool validateCircuit(Loopring::Circuit *circuit, std::string *error = nullptr)
+{
+    Loopring::TraceScope scope("validate", "stage");
     std::cout << "Validating block..." << std::endl;
     auto begin = now();
     // Check if the inputs are valid for the circuit
-    if (!circuit->getPb().is_satisfied())
+    std::vector<size_t> failures = Loopring::findUnsatisfiedConstraints(circuit->getPb(), 8);
+    if (failures.size() > 0)
     {
         std::cerr << "Block is not valid!" << std::endl;
+        std::string description = "Block is invalid";
+        for (unsigned int i = 0; i < failures.size(); i++)
+        {
+            std::string failure = describeConstraint(circuit, failures[i]);
+            std::cerr << "Unsatisfied " << failure << std::endl;
+            description += (i == 0 ? ": " : "; ") + failure;
+        }
+        if (error != nullptr)
+        {
+            *error = description;
+        }
         return false;
     }
     print_time(begin, "Block is valid");
@@ -351,167 +875,1493 @@ std::string getBaseName(unsigned int blockType)
     }
 }
 
+// Uses the mapped proving key when available (see -pk_raw2mapped)
 std::string getProvingKeyFilename(const std::string &baseFilename)
 {
+    std::string mappedFilename = baseFilename + "_pk.mapped";
+    if (fileExists(mappedFilename))
+    {
+        return mappedFilename;
+    }
     return baseFilename + "_pk.raw";
 }
 
-void runServer(
-  Loopring::Circuit *circuit,
-  const std::string &provingKeyFilename,
-  const libsnark::Config &config,
-  unsigned int port)
+bool pk_raw2mapped(const std::string &pk_file, const std::string &mapped_file)
 {
-    using namespace httplib;
-
-    struct ProverStatus
-    {
-        bool proving = false;
-        std::string blockFilename;
-        std::string proofFilename;
-    };
+    ethsnarks::ProvingKeyT provingKey;
+    loadProvingKey(pk_file, provingKey);
+    return Loopring::MappedProvingKey::write(provingKey, mapped_file);
+}
 
-    struct ProverStatusRAII
+// Generates the witness of a block for the prover server in the protoboard of the circuit.
+// Returns false with `error` set on failure.
+// `enterPhase` is called at the start of every phase and returns false when the job is cancelled.
+// The witness is loaded from `checkpointFilename` when available and stored there otherwise
+// (see getWitnessCheckpointFilename, no checkpoint when empty).
+bool generateBlockWitness(
+  Loopring::Circuit *circuit,
+  const Loopring::ProverJob &job,
+  const std::function<bool(const std::string &)> &enterPhase,
+  std::string &error,
+  const std::string &checkpointFilename = "")
+{
+    if (fileExists(checkpointFilename))
     {
-        ProverStatus &proverStatus;
-        ProverStatusRAII(
-          ProverStatus &_proverStatus,
-          const std::string &blockFilename,
-          const std::string &proofFilename)
-            : proverStatus(_proverStatus)
+        if (!enterPhase("witness"))
         {
-            proverStatus.proving = true;
-            proverStatus.blockFilename = blockFilename;
-            proverStatus.proofFilename = proofFilename;
+            error = "Cancelled";
+            return false;
         }
-
-        ~ProverStatusRAII()
+        if (loadWitnessCheckpoint(circuit, checkpointFilename))
         {
-            proverStatus.proving = false;
+            return true;
         }
-    };
-
-    // Setup the context a single time
-    ProverContextT context;
-    loadProvingKey(provingKeyFilename, context.provingKey);
-    context.constraint_system = &(circuit->getPb().constraint_system);
-    context.config = config;
-    context.domain = get_domain(circuit->getPb(), context.provingKey, config);
-    initProverContextBuffers(context);
-
-    // Prover status info
-    ProverStatus proverStatus;
-    // Lock for the prover
-    std::mutex mtx;
-    // Setup the server
-    Server svr;
-    // Called to prove blocks
-    svr.Get("/prove", [&](const Request &req, Response &res) {
-        const std::lock_guard<std::mutex> lock(mtx);
-
-        // Parse the parameters
-        std::string blockFilename = req.get_param_value("block_filename");
-        std::string proofFilename = req.get_param_value("proof_filename");
-        std::string strValidate = req.get_param_value("validate");
-        bool validate = (strValidate.compare("true") == 0) ? true : false;
-        if (blockFilename.length() == 0)
+    }
+    std::unique_ptr<std::istream> block = openJobBlock(job);
+    if (!block->good())
+    {
+        error = "Failed to load block";
+        return false;
+    }
+    if (Loopring::WitnessFile::isWitnessFile(*block))
+    {
+        // The witness was already generated (see -witness)
+        if (!enterPhase("witness"))
         {
-            res.set_content("Error: block_filename missing!\n", "text/plain");
-            return;
+            error = "Cancelled";
+            return false;
         }
-
-        // Set the prover status for this session
-        ProverStatusRAII statusRAII(proverStatus, blockFilename, proofFilename);
-
-        // Prove the block
-        json input = loadJSON(blockFilename);
-        if (input == json())
+        if (!loadWitness(circuit, *block))
         {
-            res.set_content("Error: Failed to load block!\n", "text/plain");
-            return;
+            error = "Witness file is invalid or was generated for a different circuit";
+            return false;
         }
-
-        // Some checks to see if this block is compatible with the loaded circuit
-        int iBlockType = input["blockType"].get<int>();
-        unsigned int blockSize = input["blockSize"].get<int>();
-        if (/*iBlockType & circuit->getBlockType() != 1 || */ blockSize != circuit->getBlockSize())
+    }
+    else
+    {
+        // Stream the block, the block size is checked while reading
+        if (!enterPhase("witness"))
+        {
+            error = "Cancelled";
+            return false;
+        }
+        if (!generateWitness(circuit, *block))
+        {
+            error = "Failed to generate witness for block";
+            return false;
+        }
+    }
+    if (job.validate)
+    {
+        if (!enterPhase("validate"))
+        {
+            error = "Cancelled";
+            return false;
+        }
+        if (!validateCircuit(circuit, &error))
+        {
+            return false;
+        }
+    }
+    writeWitnessCheckpoint(circuit, checkpointFilename);
+    return true;
+}
+
+// Proves the witness of a block in `pb` for the prover server.
+// Returns the proof, or an empty string with `error` set.
+// `profile` gets the duration of the prover phases.
+std::string proveBlockWitness(
+  ProverContextT &context,
+  Loopring::Circuit *circuit,
+  ethsnarks::ProtoboardT &pb,
+  const Loopring::ProverJob &job,
+  const std::function<bool(const std::string &)> &enterPhase,
+  std::string &error,
+  json &profile)
+{
+    if (!enterPhase("prove"))
+    {
+        error = "Cancelled";
+        return "";
+    }
+    std::string jProof = proveCircuit(context, circuit, pb, profile);
+    if (jProof.length() == 0)
+    {
+        error = "Failed to prove block";
+        return "";
+    }
+    if (job.proofFilename.length() != 0)
+    {
+        enterPhase("write");
+        if (!writeProof(jProof, job.proofFilename))
+        {
+            error = "Failed to write proof";
+            return "";
+        }
+    }
+    return jProof;
+}
+
+// A second witness buffer over the constraint system of the circuit.
+// The witness of the next block can be generated in the protoboard of the circuit
+// while the witness in this buffer is being proven.
+struct WitnessBuffer
+{
+    ethsnarks::ProtoboardT pb;
+
+    WitnessBuffer(Loopring::Circuit *circuit)
+    {
+        ethsnarks::ProtoboardT &circuitPb = circuit->getPb();
+        // Only the input sizes are used by the prover, the constraints are in the prover context
+        pb.constraint_system.primary_input_size = circuitPb.constraint_system.primary_input_size;
+        pb.constraint_system.auxiliary_input_size = circuitPb.constraint_system.auxiliary_input_size;
+        // Start from the same values so values only set when the circuit was created are in both buffers
+        pb.values = circuitPb.values;
+    }
+
+    // Takes the witness of the circuit, the circuit gets the previous witness in this buffer
+    void swap(Loopring::Circuit *circuit)
+    {
+        pb.values.swap(circuit->getPb().values);
+    }
+};
+
+// Registers the metrics of the prover server
+// The reason a job failed for the failure metrics, one of a fixed set so the number of series is bounded
+// (the error of a job can contain details like the failing constraint).
+// The reason is the phase the job failed in.
+const char *getFailureReason(const Loopring::ProverJob &job)
+{
+    const std::string phase = job.phaseTimes.empty() ? "" : job.phaseTimes.back().first;
+    if (phase == "load" || phase == "cache" || phase == "")
+    {
+        return "load";
+    }
+    if (phase == "validate")
+    {
+        return "validate";
+    }
+    if (phase == "witness" || phase == "wait")
+    {
+        return "witness";
+    }
+    if (phase == "prove")
+    {
+        return "prove";
+    }
+    if (phase == "write")
+    {
+        return "write";
+    }
+    return "other";
+}
+
+void initMetrics(Loopring::Circuit *circuit, Loopring::JobQueue &jobs)
+{
+    using Loopring::MetricType;
+    Loopring::Metrics &metrics = Loopring::Metrics::get();
+    metrics.add("prover_job_duration_seconds", MetricType::Histogram, "Time from submitting a job until it is done");
+    metrics.add("prover_job_queued_seconds", MetricType::Histogram, "Time a job waited in the queue");
+    metrics.add("prover_phase_seconds", MetricType::Histogram, "Duration of the phases of a job");
+    metrics.add("prover_subphase_seconds", MetricType::Histogram, "Duration of the phases of the prover");
+    metrics.add("prover_proofs_total", MetricType::Counter, "Number of proofs generated");
+    metrics.add("prover_failures_total", MetricType::Counter, "Number of failed jobs by reason");
+    metrics.add("prover_cancelled_total", MetricType::Counter, "Number of cancelled jobs");
+    metrics.add("prover_queue_depth", MetricType::Gauge, "Number of jobs waiting to be proven");
+    metrics.add("prover_proof_cache_hits_total", MetricType::Counter, "Number of proofs returned from the proof cache");
+    metrics.add("prover_resident_memory_bytes", MetricType::Gauge, "Resident memory of the prover");
+    metrics.add("prover_peak_resident_memory_bytes", MetricType::Gauge, "Peak resident memory of the prover");
+    metrics.add("prover_circuit_constraints", MetricType::Gauge, "Number of constraints of the circuit");
+    metrics.add("prover_circuit_variables", MetricType::Gauge, "Number of variables of the circuit");
+    metrics.add("prover_circuit_block_size", MetricType::Gauge, "Number of transactions in a block");
+    metrics.set("prover_circuit_constraints", circuit->getPb().num_constraints());
+    metrics.set("prover_circuit_variables", circuit->getPb().num_variables());
+    metrics.set("prover_circuit_block_size", circuit->getBlockSize());
+
+    jobs.setFinishedCallback([](const Loopring::ProverJob &job) {
+        Loopring::Metrics &metrics = Loopring::Metrics::get();
+        auto seconds = [](Loopring::ProverJob::Clock::time_point begin, Loopring::ProverJob::Clock::time_point end) {
+            return std::chrono::duration<double>(end - begin).count();
+        };
+        if (job.started != Loopring::ProverJob::Clock::time_point())
+        {
+            metrics.observe("prover_job_queued_seconds", seconds(job.submitted, job.started));
+        }
+        for (const auto &phaseTime : job.phaseTimes)
+        {
+            metrics.observe(
+              "prover_phase_seconds", phaseTime.second * 1e-3, Loopring::Metrics::labels({{"phase", phaseTime.first}}));
+        }
+        if (job.state == Loopring::JobState::Done)
+        {
+            metrics.observe("prover_job_duration_seconds", seconds(job.submitted, job.finished));
+            metrics.increment("prover_proofs_total");
+        }
+        else if (job.state == Loopring::JobState::Cancelled)
+        {
+            metrics.increment("prover_cancelled_total");
+        }
+        else
+        {
+            metrics.increment("prover_failures_total", Loopring::Metrics::labels({{"reason", getFailureReason(job)}}));
+        }
+    });
+}
+
+void recordProverProfile(const json &profile)
+{
+    for (auto it = profile.begin(); it != profile.end(); ++it)
+    {
+        Loopring::Metrics::get().observe(
+          "prover_subphase_seconds", it.value().get<double>(), Loopring::Metrics::labels({{"phase", it.key()}}));
+    }
+}
+
+// Finishes a job, `traceStart` is the start of the trace session of the job (0 when not traced)
+void finishJob(
+  Loopring::JobQueue &jobs,
+  const std::shared_ptr<Loopring::ProverJob> &job,
+  const std::string &jProof,
+  const std::string &error,
+  uint64_t traceStart)
+{
+    if (traceStart != 0)
+    {
+        jobs.setTrace(job, Loopring::Trace::get().end(traceStart).dump());
+    }
+    jobs.finish(job, jProof, error);
+}
+
+// Removes the Unix domain socket at `path` left behind by a previous server.
+// Returns false when `path` exists but is not a socket, it is not removed then.
+bool removeUnixSocket(const std::string &path)
+{
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0)
+    {
+        return true;
+    }
+    if (!S_ISSOCK(st.st_mode))
+    {
+        std::cerr << "Not a Unix socket, refusing to remove: " << path << std::endl;
+        return false;
+    }
+    return unlink(path.c_str()) == 0;
+}
+
+// Serves the prover HTTP API for the jobs in `jobs`, returns when the server is stopped or `jobs` is closed.
+// The queue is closed when the server is stopped.
+// `blockSizes` are the sizes of the blocks of `circuit`'s type that can be proven.
+// The API is also served on `unixSocket` when not empty.
+// Blocks can only be uploaded in the request body when `allowUploads` is true, up to `maxUploadSize` bytes.
+void serveJobs(
+  Loopring::Circuit *circuit,
+  const std::vector<unsigned int> &blockSizes,
+  Loopring::JobQueue &jobs,
+  unsigned int port,
+  const std::string &unixSocket,
+  bool allowUploads,
+  size_t maxUploadSize)
+{
+    using namespace httplib;
+
+    initMetrics(circuit, jobs);
+
+
+    // Queues a job for the block in the request parameters, or for `blockData` when the block was uploaded
+    auto submitJob = [&](const Request &req, Response &res, const std::shared_ptr<const std::string> &blockData)
+      -> std::shared_ptr<Loopring::ProverJob> {
+        // Parse the parameters
+        std::string blockFilename = req.get_param_value("block_filename");
+        std::string proofFilename = req.get_param_value("proof_filename");
+        std::string strValidate = req.get_param_value("validate");
+        std::string strPriority = req.get_param_value("priority");
+        std::string strTrace = req.get_param_value("trace");
+        bool validate = (strValidate.compare("true") == 0) ? true : false;
+        bool trace = (strTrace.compare("true") == 0) ? true : false;
+        if (blockData)
+        {
+            if (!allowUploads)
+            {
+                res.status = 400;
+                res.set_content("Error: Uploaded blocks are not supported, use block_filename!\n", "text/plain");
+                return nullptr;
+            }
+            blockFilename = "(uploaded)";
+        }
+        if (blockFilename.length() == 0)
+        {
+            res.status = 400;
+            res.set_content("Error: block_filename missing!\n", "text/plain");
+            return nullptr;
+        }
+        int priority = 0;
+        if (strPriority.length() != 0)
+        {
+            try
+            {
+                priority = std::stoi(strPriority);
+            }
+            catch (const std::exception &e)
+            {
+                res.status = 400;
+                res.set_content("Error: Invalid priority!\n", "text/plain");
+                return nullptr;
+            }
+        }
+        std::shared_ptr<Loopring::ProverJob> job =
+          jobs.submit(blockFilename, proofFilename, validate, priority, trace, blockData);
+        if (!job)
+        {
+            res.status = 503;
+            res.set_content(
+              jobs.isClosed() ? "Error: Prover stopped!\n" : "Error: Prover queue is full!\n", "text/plain");
+        }
+        return job;
+    };
+
+    // Proves the block in the request, waits until the proof is generated
+    auto proveBlock = [&](const Request &req, Response &res, const std::shared_ptr<const std::string> &blockData) {
+        std::shared_ptr<Loopring::ProverJob> job = submitJob(req, res, blockData);
+        if (!job)
+        {
+            return;
+        }
+        res.set_header("X-Job-ID", std::to_string(job->id).c_str());
+        // The job may already be removed from the queue, only the job itself is used
+        Loopring::ProverJob result = jobs.wait(job);
+        if (result.state != Loopring::JobState::Done)
+        {
+            res.set_content("Error: " + result.error + "!\n", "text/plain");
+            return;
+        }
+        // Return the proof
+        res.set_content(result.proof + "\n", "text/plain");
+    };
+
+    // Parses the job ID in the path, sets the error response when the ID is invalid
+    auto parseJobId = [](const Request &req, Response &res, unsigned int &id) -> bool {
+        try
+        {
+            unsigned long value = std::stoul(req.matches[1]);
+            if (value <= std::numeric_limits<unsigned int>::max())
+            {
+                id = value;
+                return true;
+            }
+        }
+        catch (const std::exception &e)
+        {
+        }
+        res.status = 400;
+        res.set_content("Error: Invalid job ID!\n", "text/plain");
+        return false;
+    };
+
+    // The same API is served on the TCP port and on the Unix domain socket
+    Server server;
+    Server unixServer;
+    auto addRoutes = [&](Server &svr) {
+        // Larger request bodies are rejected with 413 before they are read
+        svr.set_payload_max_length(maxUploadSize);
+        // Called to prove blocks, waits until the proof is generated
+        svr.Get("/prove", [&](const Request &req, Response &res) { proveBlock(req, res, nullptr); });
+        // Same, but with the block (JSON or witness file) in the request body,
+        // the block is received directly into the buffer the witness is generated from
+        svr.Post("/prove", [&](const Request &req, Response &res, const ContentReader &contentReader) {
+            std::shared_ptr<const std::string> blockData;
+            if (!Loopring::readRequestBody(req, contentReader, maxUploadSize, blockData))
+            {
+                return;
+            }
+            proveBlock(req, res, blockData);
+        });
+        // Queues a block to be proven (optionally uploaded in the request body), returns the job ID
+        svr.Post("/jobs", [&](const Request &req, Response &res, const ContentReader &contentReader) {
+            std::shared_ptr<const std::string> blockData;
+            if (!Loopring::readRequestBody(req, contentReader, maxUploadSize, blockData))
+            {
+                return;
+            }
+            std::shared_ptr<Loopring::ProverJob> job = submitJob(req, res, blockData);
+            if (!job)
+            {
+                return;
+            }
+            json result;
+            result["id"] = job->id;
+            res.status = 202;
+            res.set_content(result.dump() + "\n", "application/json");
+        });
+        // Status of all known jobs
+        svr.Get("/jobs", [&](const Request &req, Response &res) {
+            res.set_content(jobs.getStatus().dump() + "\n", "application/json");
+        });
+        // Status of a job
+        svr.Get(R"(/jobs/(\d+))", [&](const Request &req, Response &res) {
+            unsigned int id;
+            if (!parseJobId(req, res, id))
+            {
+                return;
+            }
+            json status = jobs.getStatus(id);
+            if (status == json())
+            {
+                res.status = 404;
+                res.set_content("Error: Unknown job!\n", "text/plain");
+                return;
+            }
+            res.set_content(status.dump() + "\n", "application/json");
+        });
+        // Proof of a finished job
+        svr.Get(R"(/jobs/(\d+)/proof)", [&](const Request &req, Response &res) {
+            unsigned int id;
+            if (!parseJobId(req, res, id))
+            {
+                return;
+            }
+            std::shared_ptr<Loopring::ProverJob> job = jobs.get(id);
+            if (!job)
+            {
+                res.status = 404;
+                res.set_content("Error: Unknown job!\n", "text/plain");
+                return;
+            }
+            if (job->state != Loopring::JobState::Done)
+            {
+                res.status = 409;
+                std::string error = (job->error.length() > 0) ? (": " + job->error) : "";
+                res.set_content(
+                  std::string("Error: Job is ") + Loopring::jobStateName(job->state) + error + "!\n", "text/plain");
+                return;
+            }
+            res.set_content(job->proof + "\n", "text/plain");
+        });
+        // Trace of a finished job that was submitted with trace=true
+        svr.Get(R"(/jobs/(\d+)/trace)", [&](const Request &req, Response &res) {
+            unsigned int id;
+            if (!parseJobId(req, res, id))
+            {
+                return;
+            }
+            std::shared_ptr<Loopring::ProverJob> job = jobs.get(id);
+            if (!job || job->traceData.length() == 0)
+            {
+                res.status = 404;
+                res.set_content("Error: No trace for this job!\n", "text/plain");
+                return;
+            }
+            res.set_content(job->traceData + "\n", "application/json");
+        });
+        // Cancels a job
+        svr.Delete(R"(/jobs/(\d+))", [&](const Request &req, Response &res) {
+            unsigned int id;
+            if (!parseJobId(req, res, id))
+            {
+                return;
+            }
+            if (!jobs.cancel(id))
+            {
+                res.status = 404;
+                res.set_content("Error: Unknown or finished job!\n", "text/plain");
+                return;
+            }
+            res.set_content("Cancelled\n", "text/plain");
+        });
+        // Retuns the status of the server
+        svr.Get("/status", [&](const Request &req, Response &res) {
+            std::shared_ptr<Loopring::ProverJob> job = jobs.getRunning();
+            std::string queued = std::to_string(jobs.numQueued()) + " queued";
+            if (job)
+            {
+                std::string status =
+                  std::string("Proving ") + job->blockFilename + " (" + job->phase + "; " + queued + ")";
+                res.set_content(status + "\n", "text/plain");
+            }
+            else
+            {
+                res.set_content("Idle (" + queued + ")\n", "text/plain");
+            }
+        });
+        // Metrics in the Prometheus text format
+        svr.Get("/metrics", [&](const Request &req, Response &res) {
+            Loopring::Metrics &metrics = Loopring::Metrics::get();
+            metrics.set("prover_queue_depth", jobs.numQueued());
+            metrics.set("prover_resident_memory_bytes", Loopring::getResidentMemory());
+            metrics.set("prover_peak_resident_memory_bytes", Loopring::getPeakResidentMemory());
+            res.set_content(metrics.serialize(), "text/plain; version=0.0.4");
+        });
+        // Info of this prover server
+        svr.Get("/info", [&](const Request &req, Response &res) {
+            // A line for every circuit
+            std::string info;
+            for (unsigned int blockSize : blockSizes)
+            {
+                info += std::string("BlockType: ") + std::to_string(int(circuit->getBlockType())) +
+                        std::string("; BlockSize: ") + std::to_string(blockSize) + "\n";
+            }
+            res.set_content(info, "text/plain");
+        });
+        // Stops the prover server
+        svr.Get("/stop", [&](const Request &req, Response &res) {
+            // The Unix socket server is stopped when the server is stopped
+            jobs.close();
+            server.stop();
+        });
+        // Default page contains help
+        svr.Get("/", [&](const Request &req, Response &res) {
+            std::string content;
+            content += "Prover server:\n";
+            content += "- Prove a block: "
+                       "/prove?block_filename=<block.json>&proof_filename=<proof.json>&"
+                       "validate=true (proof_filename and validate are optional)\n";
+            content += "- Prove an uploaded block: POST /prove?proof_filename=<proof.json>&validate=true with the "
+                       "block JSON or a witness file (see -witness) as the request body (returns the proof)\n";
+            content += "- Queue a block: POST "
+                       "/jobs?block_filename=<block.json>&proof_filename=<proof.json>&"
+                       "validate=true&priority=<n>&trace=true (returns the job id, higher priorities are proven "
+                       "first, the block can also be uploaded in the request body)\n";
+            content += "- Status of the jobs: /jobs or /jobs/<id> (state, phase and timings)\n";
+            content += "- Proof of a job: /jobs/<id>/proof\n";
+            content += "- Chrome trace of a job submitted with trace=true: /jobs/<id>/trace\n";
+            content += "- Cancel a job: DELETE /jobs/<id>\n";
+            content += "- Status of the server: /status (busy proving a block or not)\n";
+            content += "- Info of the server: /info (which blocks can be proven)\n";
+            content += "- Metrics of the server: /metrics (Prometheus text format)\n";
+            content += "- Shut down the server: /stop (cancels the queued jobs, will first finish generating "
+                       "the proof if busy)\n";
+            res.set_content(content, "text/plain");
+        });
+    };
+    addRoutes(server);
+
+    // Co-located operators can use the Unix domain socket instead of the TCP port
+    std::atomic<bool> unixServerDone(true);
+    std::thread unixListener;
+    if (unixSocket.length() > 0 && removeUnixSocket(unixSocket))
+    {
+        addRoutes(unixServer);
+        unixServer.set_address_family(AF_UNIX);
+        unixServerDone = false;
+        unixListener = std::thread([&]() {
+            std::cout << "Running server on Unix socket " << unixSocket << std::endl;
+            // Only the owner and the group of the server can connect
+            if (!unixServer.bind_to_port(unixSocket.c_str(), 0) || chmod(unixSocket.c_str(), 0660) != 0 ||
+                !unixServer.listen_after_bind())
+            {
+                std::cerr << "Failed to listen on Unix socket " << unixSocket << std::endl;
+            }
+            unixServerDone = true;
+        });
+    }
+
+    // The server stops when the queue is closed (e.g. when all prover workers of the supervisor stopped)
+    std::atomic<bool> serverDone(false);
+    std::thread closeWatcher([&]() {
+        jobs.waitClosed();
+        // The server can still be starting up
+        while (!serverDone)
+        {
+            if (server.is_running())
+            {
+                server.stop();
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+
+    std::cout << "Running server on 'localhost' on port " << port << std::endl;
+    server.listen("127.0.0.1", port);
+    serverDone = true;
+    jobs.close();
+    closeWatcher.join();
+
+    if (unixListener.joinable())
+    {
+        // Stop the Unix socket server as well (it can still be starting up)
+        bool unixServerStopped = false;
+        while (!unixServerDone)
+        {
+            if (!unixServerStopped && unixServer.is_running())
+            {
+                unixServer.stop();
+                unixServerStopped = true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        unixListener.join();
+        removeUnixSocket(unixSocket);
+    }
+}
+
+// A circuit of the prover server with its own prover context and witness buffer
+struct ServerCircuit
+{
+    // Only set for the circuits created by the server
+    std::unique_ptr<ethsnarks::ProtoboardT> pb;
+    std::unique_ptr<Loopring::Circuit> ownedCircuit;
+
+    Loopring::Circuit *circuit = nullptr;
+    ProverContextT context;
+    // The second witness buffer when double buffering
+    std::unique_ptr<WitnessBuffer> witnessBuffer;
+    // Identifies the circuit and its keys in the proof cache (empty when its proofs are not cached)
+    std::string cacheKey;
+    // Checks the proofs before they are cached
+    std::unique_ptr<Loopring::BatchVerifier> verifier;
+
+    ~ServerCircuit()
+    {
+        if (ownedCircuit)
+        {
+            forgetCircuitFingerprint(circuit);
+        }
+    }
+};
+
+// The circuits of the prover server, one for every block size that can be proven.
+// The circuit of the block passed at startup is always loaded. The circuits of the other sizes in
+// `block_sizes` are created (and their proving key is loaded) when the first block of their size
+// is proven. At most `max_loaded_circuits` circuits are kept, the least recently used one is unloaded
+// first. A circuit that is unloaded while a block is still being proven is freed when the proof is done.
+class ServerCircuits
+{
+  public:
+    ServerCircuits(
+      Loopring::Circuit *circuit,
+      const std::string &provingKeyFilename,
+      const libsnark::Config &_config,
+      const ProverOptions &_options)
+        : config(_config), options(_options), blockType(circuit->getBlockType())
+    {
+        defaultCircuit = std::make_shared<ServerCircuit>();
+        defaultCircuit->circuit = circuit;
+        setup(*defaultCircuit, provingKeyFilename);
+
+        blockSizes.push_back(circuit->getBlockSize());
+        for (unsigned int blockSize : options.block_sizes)
+        {
+            if (std::find(blockSizes.begin(), blockSizes.end(), blockSize) != blockSizes.end())
+            {
+                continue;
+            }
+            if (options.max_loaded_circuits == 1)
+            {
+                std::cerr << "Only the circuit for block size " << circuit->getBlockSize()
+                          << " is loaded (max_loaded_circuits), blocks of size " << blockSize << " can't be proven"
+                          << std::endl;
+                continue;
+            }
+            if (!fileExists(getProvingKeyFilename(getBaseFilename(blockSize))))
+            {
+                std::cerr << "Failed to find pk for block size " << blockSize << ", these blocks can't be proven"
+                          << std::endl;
+                continue;
+            }
+            blockSizes.push_back(blockSize);
+        }
+    }
+
+    // The sizes of the blocks that can be proven, starting with the size of the default circuit
+    const std::vector<unsigned int> &getBlockSizes() const
+    {
+        return blockSizes;
+    }
+
+    Loopring::Circuit *getDefaultCircuit() const
+    {
+        return defaultCircuit->circuit;
+    }
+
+    bool isLoaded(unsigned int blockSize)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return blockSize == defaultCircuit->circuit->getBlockSize() || find(blockSize) != loaded.end();
+    }
+
+    // Returns the circuit for blocks of `blockSize`, or null with `error` set when these blocks can't be proven
+    std::shared_ptr<ServerCircuit> get(unsigned int blockSize, std::string &error)
+    {
+        if (blockSize == defaultCircuit->circuit->getBlockSize())
+        {
+            return defaultCircuit;
+        }
+        if (std::find(blockSizes.begin(), blockSizes.end(), blockSize) == blockSizes.end())
+        {
+            error = "Incompatible block requested! Use /info to check which blocks can be proven";
+            return nullptr;
+        }
+
+        std::unique_lock<std::mutex> lock(mtx);
+        // Wait when another thread is already loading the circuit
+        circuitLoaded.wait(lock, [&]() { return loading.count(blockSize) == 0; });
+        auto it = find(blockSize);
+        if (it != loaded.end())
+        {
+            // Most recently used circuits are at the back
+            std::shared_ptr<ServerCircuit> serverCircuit = *it;
+            loaded.erase(it);
+            loaded.push_back(serverCircuit);
+            return serverCircuit;
+        }
+
+        // Make room for the new circuit (the default circuit and the circuits being loaded count as well)
+        loading.insert(blockSize);
+        while (options.max_loaded_circuits > 0 && loaded.size() > 0 &&
+               loaded.size() + loading.size() + 1 > options.max_loaded_circuits)
+        {
+            std::cout << "Unloading circuit for block size " << loaded.front()->circuit->getBlockSize() << std::endl;
+            loaded.pop_front();
+        }
+
+        // The circuit and its proving key are loaded without holding the lock
+        lock.unlock();
+        std::shared_ptr<ServerCircuit> serverCircuit;
+        try
+        {
+            serverCircuit = std::make_shared<ServerCircuit>();
+            serverCircuit->pb.reset(new ethsnarks::ProtoboardT());
+            serverCircuit->ownedCircuit.reset(createCircuit(blockType, blockSize, *serverCircuit->pb));
+            serverCircuit->circuit = serverCircuit->ownedCircuit.get();
+            if (options.witness_templates)
+            {
+                serverCircuit->circuit->enableWitnessTemplates();
+            }
+            setup(*serverCircuit, getProvingKeyFilename(getBaseFilename(blockSize)));
+        }
+        catch (...)
+        {
+            lock.lock();
+            loading.erase(blockSize);
+            circuitLoaded.notify_all();
+            throw;
+        }
+        lock.lock();
+        loading.erase(blockSize);
+        loaded.push_back(serverCircuit);
+        circuitLoaded.notify_all();
+        return serverCircuit;
+    }
+
+  private:
+    const libsnark::Config config;
+    const ProverOptions options;
+    const unsigned int blockType;
+    std::vector<unsigned int> blockSizes;
+
+    std::shared_ptr<ServerCircuit> defaultCircuit;
+    std::mutex mtx;
+    std::condition_variable circuitLoaded;
+    // The other loaded circuits, least recently used first
+    std::deque<std::shared_ptr<ServerCircuit>> loaded;
+    // The block sizes of the circuits that are being loaded
+    std::set<unsigned int> loading;
+
+    std::string getBaseFilename(unsigned int blockSize) const
+    {
+        return "keys/" + getBaseName(blockType) + "_" + std::to_string(blockSize);
+    }
+
+    std::deque<std::shared_ptr<ServerCircuit>>::iterator find(unsigned int blockSize)
+    {
+        return std::find_if(
+          loaded.begin(), loaded.end(), [blockSize](const std::shared_ptr<ServerCircuit> &serverCircuit) {
+              return serverCircuit->circuit->getBlockSize() == blockSize;
+          });
+    }
+
+    // Setup the context a single time
+    void setup(ServerCircuit &serverCircuit, const std::string &provingKeyFilename)
+    {
+        ethsnarks::ProtoboardT &pb = serverCircuit.circuit->getPb();
+        loadProvingKey(provingKeyFilename, serverCircuit.context.provingKey);
+        serverCircuit.context.constraint_system = &(pb.constraint_system);
+        serverCircuit.context.config = config;
+        serverCircuit.context.domain = get_domain(pb, serverCircuit.context.provingKey, config);
+        initProverContextBuffers(serverCircuit.context);
+        if (options.double_buffering)
+        {
+            serverCircuit.witnessBuffer.reset(new WitnessBuffer(serverCircuit.circuit));
+        }
+        if (options.proof_cache_dir.length() > 0)
+        {
+            std::string vkFilename = getBaseFilename(serverCircuit.circuit->getBlockSize()) + "_vk.json";
+            uint64_t vkHash;
+            if (!Loopring::ProofCache::hashFile(vkFilename, vkHash))
+            {
+                std::cerr << "Failed to read " << vkFilename << ", these proofs are not cached" << std::endl;
+                return;
+            }
+            serverCircuit.verifier.reset(new Loopring::BatchVerifier(loadVerificationKey(vkFilename)));
+            serverCircuit.cacheKey = Loopring::ProofCache::toHex(getCircuitFingerprint(serverCircuit.circuit)) +
+                                     Loopring::ProofCache::toHex(vkHash);
+        }
+    }
+};
+
+// The proof cache of the prover server (see the proof_cache_dir option).
+// Proofs are stored by the public input of their block together with the circuit and verification key,
+// so a block that was already proven is returned right after its witness is generated.
+// Retried jobs for the same block file are found before the witness is generated with the hash of the file
+// (not for jobs that validate the block, the block needs to be checked first, nor for uploaded blocks).
+// Only proofs that verify are stored.
+class ServerProofCache
+{
+  public:
+    ServerProofCache(const ProverOptions &options)
+        : cache(options.proof_cache_dir, uint64_t(options.proof_cache_max_gb * Loopring::GB))
+    {
+    }
+
+    // Returns the cached proof of the block file of the job (empty when not cached), `blockKey` is set to the
+    // key of the block file
+    std::string getByBlock(const ServerCircuit &serverCircuit, const Loopring::ProverJob &job, std::string &blockKey)
+    {
+        uint64_t hash;
+        if (serverCircuit.cacheKey.length() == 0 || job.validate || !hashJobBlock(job, hash))
+        {
+            return "";
+        }
+        blockKey = "block_" + serverCircuit.cacheKey + "_" + Loopring::ProofCache::toHex(hash);
+        std::string proofKey;
+        if (!cache.get(blockKey, proofKey))
+        {
+            return "";
+        }
+        return getProof(proofKey, job, "block");
+    }
+
+    // Returns the cached proof of the witness in `pb` (empty when not cached), `proofKey` is set to the key of
+    // the proof
+    std::string getByWitness(
+      const ServerCircuit &serverCircuit,
+      const ethsnarks::ProtoboardT &pb,
+      const Loopring::ProverJob &job,
+      const std::string &blockKey,
+      std::string &proofKey)
+    {
+        if (serverCircuit.cacheKey.length() == 0)
+        {
+            return "";
+        }
+        proofKey = "proof_" + serverCircuit.cacheKey + "_" + Loopring::ProofCache::primaryInputToHex(pb);
+        std::string jProof = getProof(proofKey, job, "witness");
+        if (jProof.length() > 0 && blockKey.length() > 0)
+        {
+            cache.put(blockKey, proofKey);
+        }
+        return jProof;
+    }
+
+    // Stores the proof when it verifies
+    void put(
+      ServerCircuit &serverCircuit,
+      const std::string &blockKey,
+      const std::string &proofKey,
+      const std::string &jProof)
+    {
+        if (proofKey.length() == 0 || jProof.length() == 0)
+        {
+            return;
+        }
+        std::istringstream stream(jProof);
+        if (serverCircuit.verifier->verify({proof_from_json(stream)}).size() != 0)
+        {
+            std::cerr << "Proof does not verify, the proof is not cached" << std::endl;
+            return;
+        }
+        cache.put(proofKey, jProof);
+        if (blockKey.length() > 0)
+        {
+            cache.put(blockKey, proofKey);
+        }
+    }
+
+  private:
+    Loopring::ProofCache cache;
+
+    std::string getProof(const std::string &proofKey, const Loopring::ProverJob &job, const std::string &lookup)
+    {
+        std::string jProof;
+        if (!cache.get(proofKey, jProof))
+        {
+            return "";
+        }
+        if (job.proofFilename.length() != 0 && !writeProof(jProof, job.proofFilename))
+        {
+            // Let the prover report the error
+            return "";
+        }
+        std::cout << "Proof found in the proof cache" << std::endl;
+        Loopring::Metrics::get().increment(
+          "prover_proof_cache_hits_total", Loopring::Metrics::labels({{"lookup", lookup}}));
+        return jProof;
+    }
+};
+
+// Reads the size of the block (or witness file) of a job
+bool getJobBlockSize(const Loopring::ProverJob &job, unsigned int &blockSize)
+{
+    std::unique_ptr<std::istream> block = openJobBlock(job);
+    if (!block->good())
+    {
+        return false;
+    }
+    Loopring::WitnessFileHeader header;
+    if (Loopring::WitnessFile::isWitnessFile(*block))
+    {
+        if (!Loopring::WitnessFile::readHeader(*block, header))
         {
-            res.set_content(
-              "Error: Incompatible block requested! Use /info to check "
-              "which blocks can be proven.\n",
-              "text/plain");
-            return;
+            return false;
         }
+        blockSize = header.blockSize;
+        return true;
+    }
+    json blockHeader = Loopring::BlockReader::readHeader(*block, {"blockSize"});
+    if (blockHeader == json() || !blockHeader.contains("blockSize"))
+    {
+        return false;
+    }
+    blockSize = blockHeader["blockSize"].get<unsigned int>();
+    return true;
+}
 
-        if (!generateWitness(circuit, input))
+// The circuit that proves the block of the job, or null with `error` set
+std::shared_ptr<ServerCircuit> getJobCircuit(
+  ServerCircuits &circuits,
+  const Loopring::ProverJob &job,
+  const std::function<bool(const std::string &)> &enterPhase,
+  std::string &error)
+{
+    // No need to read the block when there's only a single circuit, the block size is checked while reading
+    unsigned int blockSize = circuits.getDefaultCircuit()->getBlockSize();
+    if (circuits.getBlockSizes().size() > 1 && !getJobBlockSize(job, blockSize))
+    {
+        error = "Failed to load block";
+        return nullptr;
+    }
+    if (!circuits.isLoaded(blockSize) && !enterPhase("load"))
+    {
+        error = "Cancelled";
+        return nullptr;
+    }
+    return circuits.get(blockSize, error);
+}
+
+void runServer(
+  Loopring::Circuit *circuit,
+  const std::string &provingKeyFilename,
+  const libsnark::Config &config,
+  const ProverOptions &options,
+  unsigned int port)
+{
+    ServerCircuits circuits(circuit, provingKeyFilename, config, options);
+    std::unique_ptr<ServerProofCache> proofCache;
+    if (options.proof_cache_dir.length() > 0)
+    {
+        proofCache.reset(new ServerProofCache(options));
+    }
+
+    // The witnesses are generated one after the other by a single worker.
+    // With double buffering the witnesses are proven by a second worker,
+    // so the witness of the next block is generated while the current block is proven.
+    // Only a single witness buffer is in use at any time.
+    Loopring::JobQueue jobs(options.max_queued_jobs);
+    struct WitnessJob
+    {
+        std::shared_ptr<Loopring::ProverJob> job;
+        std::shared_ptr<ServerCircuit> serverCircuit;
+        // The start of the trace of the job
+        uint64_t traceStart;
+        // The keys of the proof in the proof cache
+        std::string blockKey;
+        std::string proofKey;
+        // Removed when the block is proven
+        std::string checkpointFilename;
+    };
+    // Jobs with a witness in the witness buffer of their circuit
+    Loopring::BoundedQueue<WitnessJob> witnessJobs(1);
+    // Holds a token while the witness buffers can be overwritten
+    Loopring::BoundedQueue<bool> witnessBufferFree(1);
+    witnessBufferFree.push(true);
+
+    std::thread worker([&]() {
+        setNumThreads(config.num_threads, options);
+        if (!options.double_buffering)
         {
-            res.set_content("Error: Failed to generate witness for block!\n", "text/plain");
-            return;
+            pinProverThread(options);
         }
-        if (validate)
+        while (std::shared_ptr<Loopring::ProverJob> job = jobs.next())
         {
-            if (!validateCircuit(circuit))
+            std::cout << "Proving job " << job->id << ": " << job->blockFilename << std::endl;
+            uint64_t traceStart = job->trace ? Loopring::Trace::get().begin() : 0;
+            auto enterPhase = [&](const std::string &phase) { return jobs.enterPhase(job, phase); };
+            std::string error;
+            std::shared_ptr<ServerCircuit> serverCircuit = getJobCircuit(circuits, *job, enterPhase, error);
+            if (!serverCircuit)
             {
-                res.set_content("Error: Block is invalid!\n", "text/plain");
-                return;
+                finishJob(jobs, job, "", error, traceStart);
+                continue;
+            }
+            std::string blockKey;
+            if (proofCache)
+            {
+                enterPhase("cache");
+                std::string jProof = proofCache->getByBlock(*serverCircuit, *job, blockKey);
+                if (jProof.length() > 0)
+                {
+                    finishJob(jobs, job, jProof, "", traceStart);
+                    continue;
+                }
+            }
+            Loopring::Circuit *jobCircuit = serverCircuit->circuit;
+            std::string checkpointFilename = getWitnessCheckpointFilename(options.checkpoint_dir, jobCircuit, *job);
+            if (!generateBlockWitness(jobCircuit, *job, enterPhase, error, checkpointFilename))
+            {
+                finishJob(jobs, job, "", error, traceStart);
+                continue;
+            }
+            std::string proofKey;
+            if (proofCache)
+            {
+                enterPhase("cache");
+                std::string jProof =
+                  proofCache->getByWitness(*serverCircuit, jobCircuit->getPb(), *job, blockKey, proofKey);
+                if (jProof.length() > 0)
+                {
+                    removeWitnessCheckpoint(checkpointFilename);
+                    finishJob(jobs, job, jProof, "", traceStart);
+                    continue;
+                }
+            }
+            if (serverCircuit->witnessBuffer)
+            {
+                // Wait until the previous witness is proven
+                enterPhase("wait");
+                bool token;
+                witnessBufferFree.pop(token);
+                serverCircuit->witnessBuffer->swap(jobCircuit);
+                witnessJobs.push(WitnessJob{job, serverCircuit, traceStart, blockKey, proofKey, checkpointFilename});
+                continue;
             }
+            json profile;
+            std::string jProof = proveBlockWitness(
+              serverCircuit->context, jobCircuit, jobCircuit->getPb(), *job, enterPhase, error, profile);
+            recordProverProfile(profile);
+            if (proofCache)
+            {
+                proofCache->put(*serverCircuit, blockKey, proofKey, jProof);
+            }
+            if (jProof.length() > 0)
+            {
+                removeWitnessCheckpoint(checkpointFilename);
+            }
+            finishJob(jobs, job, jProof, error, traceStart);
         }
-        std::string jProof = proveCircuit(context, circuit);
-        if (jProof.length() == 0)
+    });
+
+    std::thread prover([&]() {
+        setNumThreads(config.num_threads, options);
+        pinProverThread(options);
+        WitnessJob witnessJob;
+        while (witnessJobs.pop(witnessJob))
         {
-            res.set_content("Error: Failed to prove block!\n", "text/plain");
-            return;
+            std::shared_ptr<Loopring::ProverJob> job = witnessJob.job;
+            ServerCircuit &serverCircuit = *witnessJob.serverCircuit;
+            auto enterPhase = [&](const std::string &phase) { return jobs.enterPhase(job, phase); };
+            std::string error;
+            json profile;
+            std::string jProof = proveBlockWitness(
+              serverCircuit.context, serverCircuit.circuit, serverCircuit.witnessBuffer->pb, *job, enterPhase, error,
+              profile);
+            witnessBufferFree.push(true);
+            recordProverProfile(profile);
+            if (proofCache)
+            {
+                proofCache->put(serverCircuit, witnessJob.blockKey, witnessJob.proofKey, jProof);
+            }
+            if (jProof.length() > 0)
+            {
+                removeWitnessCheckpoint(witnessJob.checkpointFilename);
+            }
+            finishJob(jobs, job, jProof, error, witnessJob.traceStart);
+            // Frees the circuit if it was unloaded in the meantime
+            witnessJob = WitnessJob();
+        }
+    });
+
+    serveJobs(
+      circuit,
+      circuits.getBlockSizes(),
+      jobs,
+      port,
+      options.unix_socket,
+      true,
+      size_t(options.max_upload_gb * Loopring::GB));
+
+    // Finish the proofs that are being generated
+    jobs.close();
+    worker.join();
+    witnessJobs.close();
+    prover.join();
+}
+
+// Proves the jobs sent by the supervisor in a forked worker process
+int runProverWorker(
+  Loopring::MessageChannel &supervisor,
+  Loopring::Circuit *circuit,
+  ProverContextT &context,
+  unsigned int numThreads,
+  const std::string &checkpointDir)
+{
+#ifdef MULTICORE
+    omp_set_num_threads(numThreads);
+#endif
+    // The worker process is already pinned, the witness is generated with the threads of the worker
+    Loopring::ThreadPool::setThreadBudget(numThreads);
+    // The proving key is shared with the supervisor, only the buffers are owned by the worker
+    initProverContextBuffers(context);
+
+    json request;
+    while (supervisor.receive(request))
+    {
+        Loopring::ProverJob job;
+        job.id = request["id"].get<unsigned int>();
+        job.blockFilename = request["block_filename"].get<std::string>();
+        job.proofFilename = request["proof_filename"].get<std::string>();
+        job.validate = request["validate"].get<bool>();
+        job.trace = request["trace"].get<bool>();
+        std::cout << "Proving job " << job.id << ": " << job.blockFilename << std::endl;
+        uint64_t traceStart = job.trace ? Loopring::Trace::get().begin() : 0;
+
+        // Every phase needs to be acknowledged by the supervisor, which can cancel the job
+        auto enterPhase = [&supervisor](const std::string &phase) -> bool {
+            json message;
+            message["phase"] = phase;
+            json reply;
+            return supervisor.send(message) && supervisor.receive(reply) && reply["continue"].get<bool>();
+        };
+        std::string error;
+        std::string jProof;
+        json profile = json::object();
+        std::string checkpointFilename = getWitnessCheckpointFilename(checkpointDir, circuit, job);
+        if (generateBlockWitness(circuit, job, enterPhase, error, checkpointFilename))
+        {
+            jProof = proveBlockWitness(context, circuit, circuit->getPb(), job, enterPhase, error, profile);
+        }
+        if (jProof.length() > 0)
+        {
+            removeWitnessCheckpoint(checkpointFilename);
+        }
+
+        json result;
+        result["proof"] = jProof;
+        result["error"] = error;
+        result["profile"] = profile;
+        if (traceStart != 0)
+        {
+            result["trace"] = Loopring::Trace::get().end(traceStart);
+        }
+        if (!supervisor.send(result))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Runs the prover server with multiple prover processes.
+// The proving key is loaded a single time, all workers are forked afterwards
+// so they all share the same copy of the proving key and the constraint system.
+// The supervisor can't have started any threads (including OpenMP threads) before.
+void runSupervisor(
+  Loopring::Circuit *circuit,
+  const std::string &provingKeyFilename,
+  const libsnark::Config &config,
+  const ProverOptions &options,
+  unsigned int port,
+  unsigned int numWorkers)
+{
+    // Writing to a stopped worker should not stop the supervisor
+    signal(SIGPIPE, SIG_IGN);
+
+    // Setup the context a single time, the buffers are allocated by the workers
+    ProverContextT context;
+    loadProvingKey(provingKeyFilename, context.provingKey);
+    context.constraint_system = &(circuit->getPb().constraint_system);
+    context.config = config;
+    context.domain = get_domain(circuit->getPb(), context.provingKey, config);
+    // Shared with the workers so they can check witness files without hashing the constraints again
+    getCircuitFingerprint(circuit);
+
+    std::vector<std::unique_ptr<Loopring::WorkerProcess>> workers;
+    for (unsigned int i = 0; i < numWorkers; i++)
+    {
+        std::vector<unsigned int> cpus;
+        if (options.worker_cpus.size() > 0)
+        {
+            cpus = Loopring::WorkerProcess::parseCpuList(options.worker_cpus[i % options.worker_cpus.size()]);
         }
-        if (proofFilename.length() != 0)
+        unsigned int numThreads = (cpus.size() > 0) ? cpus.size() : config.num_threads;
+        std::unique_ptr<Loopring::WorkerProcess> worker = Loopring::WorkerProcess::spawn(
+          [&](Loopring::MessageChannel &supervisor) {
+              return runProverWorker(supervisor, circuit, context, numThreads, options.checkpoint_dir);
+          },
+          cpus,
+          workers);
+        if (!worker)
         {
-            if (!writeProof(jProof, proofFilename))
+            std::cerr << "Failed to start prover worker " << i << std::endl;
+            break;
+        }
+        std::cout << "Started prover worker " << i << " (pid " << worker->pid << ", " << numThreads << " threads)"
+                  << std::endl;
+        workers.push_back(std::move(worker));
+    }
+    if (workers.size() == 0)
+    {
+        return;
+    }
+
+    // Every worker gets the next job when it is done with the previous one
+    Loopring::JobQueue jobs(options.max_queued_jobs);
+    std::atomic<unsigned int> numRunningWorkers(workers.size());
+    std::vector<std::thread> dispatchers;
+    for (const std::unique_ptr<Loopring::WorkerProcess> &worker : workers)
+    {
+        Loopring::WorkerProcess *process = worker.get();
+        dispatchers.emplace_back([&jobs, &numRunningWorkers, process]() {
+            while (std::shared_ptr<Loopring::ProverJob> job = jobs.next())
             {
-                res.set_content("Error: Failed to write proof!\n", "text/plain");
-                return;
+                json request;
+                request["id"] = job->id;
+                request["block_filename"] = job->blockFilename;
+                request["proof_filename"] = job->proofFilename;
+                request["validate"] = job->validate;
+                request["trace"] = job->trace;
+                bool alive = process->channel.send(request);
+
+                // Phase updates until the result is received
+                json message;
+                while (alive && (alive = process->channel.receive(message)) && message.contains("phase"))
+                {
+                    json reply;
+                    reply["continue"] = jobs.enterPhase(job, message["phase"].get<std::string>());
+                    alive = process->channel.send(reply);
+                }
+                if (!alive)
+                {
+                    std::cerr << "Prover worker " << process->pid << " stopped" << std::endl;
+                    jobs.finish(job, "", "Prover worker stopped");
+                    // Workers can't be forked again once the supervisor runs threads,
+                    // the supervisor stops (and fails the queued jobs) when no workers are left
+                    if (--numRunningWorkers == 0)
+                    {
+                        std::cerr << "All prover workers stopped, stopping the supervisor" << std::endl;
+                        jobs.close();
+                    }
+                    return;
+                }
+                recordProverProfile(message["profile"]);
+                if (message.contains("trace"))
+                {
+                    jobs.setTrace(job, message["trace"].dump());
+                }
+                jobs.finish(job, message["proof"].get<std::string>(), message["error"].get<std::string>());
             }
+        });
+    }
+
+    // The workers only get the filename of the block
+    serveJobs(
+      circuit,
+      {circuit->getBlockSize()},
+      jobs,
+      port,
+      options.unix_socket,
+      false,
+      size_t(options.max_upload_gb * Loopring::GB));
+
+    // Finish the proofs that are being generated
+    jobs.close();
+    for (std::thread &dispatcher : dispatchers)
+    {
+        dispatcher.join();
+    }
+    for (const std::unique_ptr<Loopring::WorkerProcess> &worker : workers)
+    {
+        worker->stop();
+    }
+}
+
+// The blocks in a directory (all .json files) or in a list file (one block per line)
+std::vector<std::string> listBlockFiles(const std::string &path)
+{
+    std::vector<std::string> blockFilenames;
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        DIR *dir = opendir(path.c_str());
+        if (dir == nullptr)
+        {
+            std::cerr << "Cannot open directory: " << path << std::endl;
+            return blockFilenames;
         }
-        // Return the proof
-        res.set_content(jProof + "\n", "text/plain");
-    });
-    // Retuns the status of the server
-    svr.Get("/status", [&](const Request &req, Response &res) {
-        if (proverStatus.proving)
+        while (struct dirent *entry = readdir(dir))
         {
-            std::string status = std::string("Proving ") + proverStatus.blockFilename;
-            res.set_content(status + "\n", "text/plain");
+            if (hasExtension(entry->d_name, ".json"))
+            {
+                blockFilenames.push_back(path + "/" + entry->d_name);
+            }
         }
-        else
+        closedir(dir);
+        std::sort(blockFilenames.begin(), blockFilenames.end());
+    }
+    else
+    {
+        std::ifstream file(path);
+        if (!file.is_open())
         {
-            res.set_content("Idle\n", "text/plain");
+            std::cerr << "Cannot open block list: " << path << std::endl;
+            return blockFilenames;
+        }
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.length() > 0)
+            {
+                blockFilenames.push_back(line);
+            }
+        }
+    }
+    return blockFilenames;
+}
+
+// The proof file of a block in `outDir`: <outDir>/<block name>_proof.json
+std::string getBatchProofFilename(const std::string &blockFilename, const std::string &outDir)
+{
+    std::string name = blockFilename.substr(blockFilename.find_last_of('/') + 1);
+    if (hasExtension(name, ".json"))
+    {
+        name = name.substr(0, name.length() - 5);
+    }
+    return outDir + "/" + name + "_proof.json";
+}
+
+// Proves all blocks with the circuit, the proving key and the prover buffers set up a single time.
+// With double buffering the witness of the next block is generated while the current block is proven.
+// Blocks that can't be proven are skipped. Returns false if a block could not be proven.
+bool runProveBatch(
+  Loopring::Circuit *circuit,
+  const std::string &provingKeyFilename,
+  const libsnark::Config &config,
+  const ProverOptions &options,
+  const std::vector<std::string> &blockFilenames,
+  const std::string &outDir)
+{
+    if (mkdir(outDir.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        std::cerr << "Cannot create output directory: " << outDir << std::endl;
+        return false;
+    }
+
+    ProverContextT context;
+    loadProvingKey(provingKeyFilename, context.provingKey);
+    context.constraint_system = &(circuit->getPb().constraint_system);
+    context.config = config;
+    context.domain = get_domain(circuit->getPb(), context.provingKey, config);
+    initProverContextBuffers(context);
+
+    struct BlockResult
+    {
+        std::string error;
+        unsigned int witness_ms = 0;
+        unsigned int prove_ms = 0;
+    };
+    std::vector<BlockResult> results(blockFilenames.size());
+    auto batchBegin = now();
+    auto proveBlock = [&](size_t i, ethsnarks::ProtoboardT &pb) {
+        auto begin = now();
+        std::string jProof = proveCircuit(context, circuit, pb);
+        results[i].prove_ms = elapsed_time_ms(begin);
+        if (jProof.length() == 0)
+        {
+            results[i].error = "Failed to prove block";
+        }
+        else if (!writeProof(jProof, getBatchProofFilename(blockFilenames[i], outDir)))
+        {
+            results[i].error = "Failed to write proof";
+        }
+    };
+
+    std::unique_ptr<WitnessBuffer> witnessBuffer;
+    if (options.double_buffering)
+    {
+        witnessBuffer.reset(new WitnessBuffer(circuit));
+    }
+    // The blocks with a witness in the witness buffer
+    Loopring::BoundedQueue<size_t> witnessBlocks(1);
+    // Holds a token while the witness buffer can be overwritten
+    Loopring::BoundedQueue<bool> witnessBufferFree(1);
+    witnessBufferFree.push(true);
+
+    std::thread prover([&]() {
+        setNumThreads(config.num_threads, options);
+        pinProverThread(options);
+        size_t i;
+        while (witnessBlocks.pop(i))
+        {
+            proveBlock(i, witnessBuffer->pb);
+            witnessBufferFree.push(true);
         }
-    });
-    // Info of this prover server
-    svr.Get("/info", [&](const Request &req, Response &res) {
-        std::string info = std::string("BlockType: ") + std::to_string(int(circuit->getBlockType())) +
-                           std::string("; BlockSize: ") + std::to_string(circuit->getBlockSize()) + "\n";
-        res.set_content(info, "text/plain");
-    });
-    // Stops the prover server
-    svr.Get("/stop", [&](const Request &req, Response &res) {
-        const std::lock_guard<std::mutex> lock(mtx);
-        svr.stop();
-    });
-    // Default page contains help
-    svr.Get("/", [&](const Request &req, Response &res) {
-        std::string content;
-        content += "Prover server:\n";
-        content += "- Prove a block: "
-                   "/prove?block_filename=<block.json>&proof_filename=<proof.json>&"
-                   "validate=true (proof_filename and validate are optional)\n";
-        content += "- Status of the server: /status (busy proving a block or not)\n";
-        content += "- Info of the server: /info (which blocks can be proven)\n";
-        content += "- Shut down the server: /stop (will first finish generating "
-                   "the proof if busy)\n";
-        res.set_content(content, "text/plain");
     });
 
-    std::cout << "Running server on 'localhost' on port " << port << std::endl;
-    svr.listen("127.0.0.1", port);
+    for (size_t i = 0; i < blockFilenames.size(); i++)
+    {
+        std::cout << "Block " << (i + 1) << "/" << blockFilenames.size() << ": " << blockFilenames[i] << std::endl;
+        auto begin = now();
+        bool valid = generateWitness(circuit, blockFilenames[i]) && validateCircuit(circuit, &results[i].error);
+        results[i].witness_ms = elapsed_time_ms(begin);
+        if (!valid)
+        {
+            if (results[i].error.length() == 0)
+            {
+                results[i].error = "Failed to generate witness for block";
+            }
+            continue;
+        }
+        if (witnessBuffer)
+        {
+            // Wait until the previous witness is proven
+            bool token;
+            witnessBufferFree.pop(token);
+            witnessBuffer->swap(circuit);
+            witnessBlocks.push(i);
+            continue;
+        }
+        proveBlock(i, circuit->getPb());
+    }
+    witnessBlocks.close();
+    prover.join();
+
+    // Summary
+    unsigned int numProven = 0;
+    unsigned int totalWitness_ms = 0;
+    unsigned int totalProve_ms = 0;
+    std::cout << "Block\tWitness (s)\tProve (s)\tResult" << std::endl;
+    for (size_t i = 0; i < blockFilenames.size(); i++)
+    {
+        const BlockResult &result = results[i];
+        std::cout << blockFilenames[i] << "\t" << result.witness_ms / 1000.0 << "\t" << result.prove_ms / 1000.0 << "\t"
+                  << (result.error.length() == 0 ? "OK" : result.error) << std::endl;
+        numProven += (result.error.length() == 0) ? 1 : 0;
+        totalWitness_ms += result.witness_ms;
+        totalProve_ms += result.prove_ms;
+    }
+    std::cout << numProven << "/" << blockFilenames.size() << " blocks proven (witness: " << totalWitness_ms / 1000.0
+              << "s, prove: " << totalProve_ms / 1000.0 << "s, total: " << elapsed_time_ms(batchBegin) / 1000.0 << "s)"
+              << std::endl;
+    return numProven == blockFilenames.size();
 }
 
 bool runBenchmark(Loopring::Circuit *circuit, const std::string &provingKeyFilename)
@@ -522,7 +2372,7 @@ bool runBenchmark(Loopring::Circuit *circuit, const std::string &provingKeyFilen
     context.constraint_system = &(circuit->getPb().constraint_system);
 
     VerificationKeyT vk =
-      loadVerificationKey(provingKeyFilename.substr(0, provingKeyFilename.length() - 6) + "vk.json");
+      loadVerificationKey(provingKeyFilename.substr(0, provingKeyFilename.rfind("pk.")) + "vk.json");
 
     if (!validateCircuit(circuit))
     {
@@ -592,50 +2442,257 @@ bool runBenchmark(Loopring::Circuit *circuit, const std::string &provingKeyFilen
         std::cout << "Config: " << config << std::endl;
         std::cout << "*****************************" << std::endl;
 #ifdef MULTICORE
-        omp_set_num_threads(config.num_threads);
+        omp_set_num_threads(config.num_threads);
+#endif
+
+        context.config = config;
+        context.domain = get_domain(circuit->getPb(), context.provingKey, config);
+        initProverContextBuffers(context);
+
+        unsigned int totalTime = 0;
+        for (unsigned int l = 0; l < num_iterations; l++)
+        {
+            auto begin = now();
+            std::string jProof = proveCircuit(context, circuit);
+            totalTime += elapsed_time_ms(begin);
+            if (jProof.length() == 0)
+            {
+                return false;
+            }
+
+            std::stringstream proof_stream;
+            proof_stream << jProof;
+            auto proof_pair = proof_from_json(proof_stream);
+
+            if (!libsnark::r1cs_gg_ppzksnark_zok_verifier_strong_IC<ppT>(vk, proof_pair.first, proof_pair.second))
+            {
+                std::cerr << "Invalid proof!" << std::endl;
+                return false;
+            }
+        }
+
+        Result result;
+        result.config = config;
+        result.duration_ms = totalTime / num_iterations;
+        results.push_back(result);
+    }
+
+    std::sort(results.begin(), results.end(), Result::compareResult);
+
+    std::cout << "Benchmark results:" << std::endl;
+    for (unsigned int i = 0; i < results.size(); i++)
+    {
+        const libsnark::Config &config = results[i].config;
+        std::cout << i << ". " << config << " (" << results[i].duration_ms << "ms)" << std::endl;
+    }
+
+    return true;
+}
+
+// The libff profiling phases of the prover that only depend on the FFT or on the multiexp options
+static const std::vector<std::pair<std::string, std::string>> TUNE_PHASES = {
+  {"fft", "polynomial H"},
+  {"multiexp", "evaluation to"}};
+
+// Tunes the prover options in benchmark.json without trying every combination (see `Loopring::Tuner`).
+// The FFT and multiexp options are tuned on the duration of their own phases, all other options
+// on the duration of the complete proof. The best config is written to `configFilename`.
+bool runTune(Loopring::Circuit *circuit, const std::string &provingKeyFilename, const std::string &configFilename)
+{
+    ProverContextT context;
+    loadProvingKey(provingKeyFilename, context.provingKey);
+    context.constraint_system = &(circuit->getPb().constraint_system);
+
+    VerificationKeyT vk =
+      loadVerificationKey(provingKeyFilename.substr(0, provingKeyFilename.rfind("pk.")) + "vk.json");
+
+    if (!validateCircuit(circuit))
+    {
+        return false;
+    }
+
+    BenchmarkConfig benchmarkConfig = loadJSON("benchmark.json").get<BenchmarkConfig>();
+    std::vector<Loopring::TunerParameter> parameters = {
+      {"num_threads", "total", (unsigned int)benchmarkConfig.num_threads.size()},
+      {"smt", "total", (unsigned int)benchmarkConfig.smt.size()},
+      {"swapAB", "total", (unsigned int)benchmarkConfig.swapAB.size()},
+      {"prefetch_stride", "total", (unsigned int)benchmarkConfig.prefetch_stride.size()},
+      {"fft", "fft", (unsigned int)benchmarkConfig.fft.size()},
+      {"radixes", "fft", (unsigned int)benchmarkConfig.radixes.size()},
+      {"multi_exp_c", "multiexp", (unsigned int)benchmarkConfig.multi_exp_c.size()},
+      {"multi_exp_prefetch_locality", "multiexp", (unsigned int)benchmarkConfig.multi_exp_prefetch_locality.size()},
+      {"multi_exp_look_ahead", "multiexp", (unsigned int)benchmarkConfig.multi_exp_look_ahead.size()}};
+    size_t numConfigs = 1;
+    for (const Loopring::TunerParameter &parameter : parameters)
+    {
+        if (parameter.numValues == 0)
+        {
+            std::cerr << "No values to tune for " << parameter.name << " in benchmark.json" << std::endl;
+            return false;
+        }
+        numConfigs *= parameter.numValues;
+    }
+
+    auto getConfig = [&](const Loopring::Tuner::CandidateT &candidate) {
+        libsnark::Config config;
+        config.num_threads = benchmarkConfig.num_threads[candidate[0]];
+        config.smt = benchmarkConfig.smt[candidate[1]];
+        config.swapAB = benchmarkConfig.swapAB[candidate[2]];
+        config.prefetch_stride = benchmarkConfig.prefetch_stride[candidate[3]];
+        config.fft = benchmarkConfig.fft[candidate[4]];
+        config.radixes = benchmarkConfig.radixes[candidate[5]];
+        config.multi_exp_c = benchmarkConfig.multi_exp_c[candidate[6]];
+        config.multi_exp_prefetch_locality = benchmarkConfig.multi_exp_prefetch_locality[candidate[7]];
+        config.multi_exp_look_ahead = benchmarkConfig.multi_exp_look_ahead[candidate[8]];
+        return config;
+    };
+
+    // Proves the block a single time and returns the duration of the proof and of the tuned phases
+    Loopring::Tuner::CandidateT current;
+    auto measure = [&](const Loopring::Tuner::CandidateT &candidate) {
+        libsnark::Config config = getConfig(candidate);
+        if (candidate != current)
+        {
+            std::cout << "Config: " << config << std::endl;
+#ifdef MULTICORE
+            omp_set_num_threads(config.num_threads);
 #endif
+            context.config = config;
+            context.domain = get_domain(circuit->getPb(), context.provingKey, config);
+            initProverContextBuffers(context);
+            current = candidate;
+        }
 
-        context.config = config;
-        context.domain = get_domain(circuit->getPb(), context.provingKey, config);
-        initProverContextBuffers(context);
+        json profile;
+        auto begin = now();
+        std::string jProof = proveCircuit(context, circuit, circuit->getPb(), profile);
+        unsigned int duration_ms = elapsed_time_ms(begin);
+        if (jProof.length() == 0)
+        {
+            throw std::runtime_error("Failed to prove the block");
+        }
+        std::stringstream proof_stream;
+        proof_stream << jProof;
+        auto proof_pair = proof_from_json(proof_stream);
+        if (!libsnark::r1cs_gg_ppzksnark_zok_verifier_strong_IC<ppT>(vk, proof_pair.first, proof_pair.second))
+        {
+            throw std::runtime_error("Invalid proof");
+        }
 
-        unsigned int totalTime = 0;
-        for (unsigned int l = 0; l < num_iterations; l++)
+        Loopring::TunerScores scores;
+        scores["total"] = duration_ms * 1e-3;
+        for (const auto &phase : TUNE_PHASES)
         {
-            auto begin = now();
-            std::string jProof = proveCircuit(context, circuit);
-            totalTime += elapsed_time_ms(begin);
-            if (jProof.length() == 0)
+            for (auto it = profile.begin(); it != profile.end(); ++it)
             {
-                return false;
+                if (it.key().find(phase.second) != std::string::npos)
+                {
+                    scores[phase.first] += it.value().get<double>();
+                }
             }
+        }
+        return scores;
+    };
 
-            std::stringstream proof_stream;
-            proof_stream << jProof;
-            auto proof_pair = proof_from_json(proof_stream);
+    std::cout << "Tuning " << numConfigs << " configs..." << std::endl;
+    Loopring::Tuner tuner(parameters, measure, benchmarkConfig.num_iterations);
+    Loopring::Tuner::CandidateT best;
+    try
+    {
+        best = tuner.run(Loopring::Tuner::CandidateT(parameters.size(), 0));
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Tuning failed: " << e.what() << std::endl;
+        return false;
+    }
 
-            if (!libsnark::r1cs_gg_ppzksnark_zok_verifier_strong_IC<ppT>(vk, proof_pair.first, proof_pair.second))
-            {
-                std::cerr << "Invalid proof!" << std::endl;
-                return false;
-            }
-        }
+    libsnark::Config config = getConfig(best);
+    Loopring::TunerStats stats = tuner.getStats(best, "total");
+    std::cout << "Best config: " << config << " (" << stats.median * 1e3 << "ms +/- " << stats.deviation * 1e3
+              << "ms over " << stats.numSamples << " proofs)" << std::endl;
+    std::cout << "Proofs generated: " << tuner.getNumMeasurements() << " (full grid: " << numConfigs << " configs x "
+              << benchmarkConfig.num_iterations << " iterations)" << std::endl;
 
-        Result result;
-        result.config = config;
-        result.duration_ms = totalTime / num_iterations;
-        results.push_back(result);
+    // Keep all other options in the config file
+    json jConfig = fileExists(configFilename) ? loadJSON(configFilename) : json::object();
+    for (auto it : json(config).items())
+    {
+        jConfig[it.key()] = it.value();
+    }
+    std::ofstream file(configFilename);
+    file << jConfig.dump(4) << std::endl;
+    if (!file.good())
+    {
+        std::cerr << "Failed to write config to " << configFilename << std::endl;
+        return false;
     }
+    std::cout << "Config written to " << configFilename << std::endl;
+    return true;
+}
 
-    std::sort(results.begin(), results.end(), Result::compareResult);
+// Parses a block size argument, returns false when it isn't a positive number
+bool parseBlockSize(const char *text, unsigned int &blockSize)
+{
+    char *end = nullptr;
+    errno = 0;
+    const unsigned long long value = strtoull(text, &end, 10);
+    if (text[0] < '0' || text[0] > '9' || *end != '\0' || errno != 0 || value == 0 ||
+        value > std::numeric_limits<unsigned int>::max())
+    {
+        return false;
+    }
+    blockSize = value;
+    return true;
+}
 
-    std::cout << "Benchmark results:" << std::endl;
-    for (unsigned int i = 0; i < results.size(); i++)
+// Generates a block with valid transactions in the mix of `mixFilename` (see BlockGenerator.h).
+// The witness is generated twice: first to get the messages that need to be signed,
+// then to validate the signed block.
+bool runGenBlock(unsigned int blockSize, const std::string &mixFilename, const std::string &blockFilename)
+{
+    json mix = loadJSON(mixFilename);
+    if (mix == json())
     {
-        const libsnark::Config &config = results[i].config;
-        std::cout << i << ". " << config << " (" << results[i].duration_ms << "ms)" << std::endl;
+        return false;
+    }
+
+    std::cout << "Generating block... " << std::endl;
+    auto begin = now();
+    Loopring::BlockGenerator generator(mix);
+    json block;
+    if (!generator.generate(blockSize, block))
+    {
+        return false;
+    }
+    print_time(begin, "Block generated");
+
+    ethsnarks::ProtoboardT pb;
+    std::unique_ptr<Loopring::Circuit> circuit(createCircuit(0, blockSize, pb));
+    if (!generateWitness(circuit.get(), block))
+    {
+        return false;
+    }
+    begin = now();
+    if (!generator.sign(block, circuit->getSignatureRequests()))
+    {
+        return false;
+    }
+    print_time(begin, "Block signed");
+
+    if (!generateWitness(circuit.get(), block) || !validateCircuit(circuit.get()))
+    {
+        return false;
     }
 
+    std::ofstream file(blockFilename);
+    file << block.dump(4) << std::endl;
+    if (!file.good())
+    {
+        std::cerr << "Cannot write block file: " << blockFilename << std::endl;
+        return false;
+    }
+    std::cout << "Block written to " << blockFilename << std::endl;
     return true;
 }
 
@@ -646,27 +2703,55 @@ int main(int argc, char **argv)
     // Load in the config
     libsnark::Config config = loadConfig("config.json");
     std::cout << "Config: " << config << std::endl;
+    ProverOptions options = loadOptions("config.json");
 
 #ifdef MULTICORE
-    // omp_set_nested is needed for gcc for some reason
-    omp_set_nested(1);
-    omp_set_max_active_levels(5);
+    // The witness is generated on the shared thread pool, OpenMP is not nested anymore
     std::cout << "Num threads available: " << omp_get_max_threads() << std::endl;
     std::cout << "Num processors available: " << omp_get_num_procs() << std::endl;
 #endif
 
+    // Options that can be used with every mode
+    std::string traceFilename;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            traceFilename = argv[i + 1];
+            for (int j = i; j + 2 <= argc; j++)
+            {
+                argv[j] = argv[j + 2];
+            }
+            argc -= 2;
+            break;
+        }
+    }
+
     if (argc < 3)
     {
-        std::cerr << "Usage: " << argv[0] << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [--trace <trace.json>]" << std::endl;
         std::cerr << "-validate <block.json>: Validates a block" << std::endl;
         std::cerr << "-prove <block.json> <out_proof.json>: Proves a block" << std::endl;
+        std::cerr << "-witness <block.json> <out_witness.wit>: Generates the witness of a "
+                     "block and writes it to a binary witness file"
+                  << std::endl;
+        std::cerr << "-provewitness <witness.wit> <out_proof.json>: Proves a witness file "
+                     "created with -witness (the server also accepts witness files as blocks)"
+                  << std::endl;
+        std::cerr << "-provebatch <blocks.txt|dir> <out_dir>: Proves all blocks in a list file "
+                     "(one block per line) or a directory with the circuit and the proving key loaded a "
+                     "single time, the proofs are written to <out_dir>/<block>_proof.json"
+                  << std::endl;
         std::cerr << "-createkeys <protoBlock.json>: Creates prover/verifier keys" << std::endl;
         std::cerr << "-verify <vk.json> <proof.json>: Verify a proof" << std::endl;
-        std::cerr << "-exportcircuit <block.json> <circuit.json>: Exports the rc1s "
-                     "circuit to json (circom - not all fields)"
+        std::cerr << "-verifybatch <vk.json> <proof.json>...: Verifies many proofs at once "
+                     "with a single pairing check (the invalid proofs are listed)"
+                  << std::endl;
+        std::cerr << "-exportcircuit <block.json> <circuit.json|circuit.r1cs>: Exports the rc1s "
+                     "circuit to json (circom - not all fields) or to the binary .r1cs format (circom/snarkjs)"
                   << std::endl;
-        std::cerr << "-exportwitness <block.json> <witness.json>: Exports the "
-                     "witness to json (circom)"
+        std::cerr << "-exportwitness <block.json> <witness.json|witness.wtns>: Exports the "
+                     "witness to json (circom) or to the binary .wtns format (snarkjs)"
                   << std::endl;
         std::cerr << "-createpk <pk.json> <pk.raw>: Creates the "
                      "proving key using a bellman pk"
@@ -677,16 +2762,35 @@ int main(int argc, char **argv)
         std::cerr << "-pk_mcl2nozk <pk_mlc.raw> <pk_nozk.raw>: Converts the "
                      "proving key from the mcl format to the nozk format"
                   << std::endl;
+        std::cerr << "-pk_raw2mapped <pk.raw> <pk.mapped>: Converts the proving "
+                     "key to a format that can be mapped directly into memory (used "
+                     "instead of <base>_pk.raw when <base>_pk.mapped exists)"
+                  << std::endl;
         std::cerr << "-server <block.json> <port>: Keeps the program running as an "
-                     "HTTP server to prove blocks on demand"
+                     "HTTP server to prove blocks on demand (also of the sizes in the block_sizes option)"
+                  << std::endl;
+        std::cerr << "-supervisor <block.json> <port> <num_workers>: Same as -server, "
+                     "but proves blocks with multiple worker processes sharing a single proving key"
                   << std::endl;
         std::cerr << "-benchmark <block.json>: Try out multiple prover options to "
                      "find the fastest configuration on the system"
                   << std::endl;
+        std::cerr << "-tune <block.json> [<config.json>]: Searches the options in "
+                     "benchmark.json for the fastest configuration and writes it to "
+                     "<config.json> (config.json by default)"
+                  << std::endl;
+        std::cerr << "-genblock <block_size> <mix.json> <out_block.json>: Generates a block "
+                     "with valid transactions in the mix of <mix.json> (see Utils/BlockGenerator.h)"
+                  << std::endl;
+        std::cerr << "--trace <trace.json>: Writes a Chrome trace of the stages of "
+                     "-validate/-prove/-witness/-provewitness (open in chrome://tracing or Perfetto)"
+                  << std::endl;
         return 1;
     }
 
     const char *proofFilename = NULL;
+    // The blocks of -provebatch, the circuit is created for the first block
+    std::vector<std::string> blockFilenames;
     Mode mode = Mode::Validate;
     std::string baseFilename = "keys/";
     if (strcmp(argv[1], "-validate") == 0)
@@ -705,6 +2809,43 @@ int main(int argc, char **argv)
         proofFilename = argv[3];
         std::cout << "Proving " << argv[2] << "..." << std::endl;
     }
+    else if (strcmp(argv[1], "-witness") == 0)
+    {
+        if (argc != 4)
+        {
+            std::cout << "Invalid number of arguments!" << std::endl;
+            return 1;
+        }
+        mode = Mode::Witness;
+        std::cout << "Generating witness for " << argv[2] << "..." << std::endl;
+    }
+    else if (strcmp(argv[1], "-provewitness") == 0)
+    {
+        if (argc != 4)
+        {
+            std::cout << "Invalid number of arguments!" << std::endl;
+            return 1;
+        }
+        mode = Mode::ProveWitness;
+        proofFilename = argv[3];
+        std::cout << "Proving witness " << argv[2] << "..." << std::endl;
+    }
+    else if (strcmp(argv[1], "-provebatch") == 0)
+    {
+        if (argc != 4)
+        {
+            std::cout << "Invalid number of arguments!" << std::endl;
+            return 1;
+        }
+        mode = Mode::ProveBatch;
+        blockFilenames = listBlockFiles(argv[2]);
+        if (blockFilenames.size() == 0)
+        {
+            std::cerr << "No blocks to prove in " << argv[2] << std::endl;
+            return 1;
+        }
+        std::cout << "Proving " << blockFilenames.size() << " blocks in " << argv[2] << "..." << std::endl;
+    }
     else if (strcmp(argv[1], "-createkeys") == 0)
     {
         if (argc != 3)
@@ -730,6 +2871,20 @@ int main(int argc, char **argv)
         std::cout << "Proof is valid" << std::endl;
         return 0;
     }
+    else if (strcmp(argv[1], "-verifybatch") == 0)
+    {
+        if (argc < 4)
+        {
+            std::cout << "Invalid number of arguments!" << std::endl;
+            return 1;
+        }
+        std::vector<std::string> proofFilenames(argv + 3, argv + argc);
+        if (!runVerifyBatch(argv[2], proofFilenames))
+        {
+            return 1;
+        }
+        return 0;
+    }
     else if (strcmp(argv[1], "-exportcircuit") == 0)
     {
         if (argc != 4)
@@ -797,6 +2952,22 @@ int main(int argc, char **argv)
         std::cout << "Successfully created pk " << argv[3] << "." << std::endl;
         return 0;
     }
+    else if (strcmp(argv[1], "-pk_raw2mapped") == 0)
+    {
+        if (argc != 4)
+        {
+            std::cout << "Invalid number of arguments!" << std::endl;
+            return 1;
+        }
+        std::cout << "Converting pk from " << argv[2] << " to " << argv[3] << " ..." << std::endl;
+        if (!pk_raw2mapped(argv[2], argv[3]))
+        {
+            std::cout << "Failed to convert!" << std::endl;
+            return 1;
+        }
+        std::cout << "Successfully created pk " << argv[3] << "." << std::endl;
+        return 0;
+    }
     else if (strcmp(argv[1], "-server") == 0)
     {
         if (argc != 4)
@@ -807,6 +2978,17 @@ int main(int argc, char **argv)
         mode = Mode::Server;
         std::cout << "Starting proving server for " << argv[2] << " on port " << argv[3] << "..." << std::endl;
     }
+    else if (strcmp(argv[1], "-supervisor") == 0)
+    {
+        if (argc != 5)
+        {
+            std::cout << "Invalid number of arguments!" << std::endl;
+            return 1;
+        }
+        mode = Mode::Supervisor;
+        std::cout << "Starting proving supervisor for " << argv[2] << " on port " << argv[3] << " with "
+                  << argv[4] << " workers..." << std::endl;
+    }
     else if (strcmp(argv[1], "-benchmark") == 0)
     {
         if (argc != 3)
@@ -817,34 +2999,107 @@ int main(int argc, char **argv)
         mode = Mode::Benchmark;
         std::cout << "Benchmarking " << argv[2] << "..." << std::endl;
     }
+    else if (strcmp(argv[1], "-tune") == 0)
+    {
+        if (argc != 3 && argc != 4)
+        {
+            std::cout << "Invalid number of arguments!" << std::endl;
+            return 1;
+        }
+        mode = Mode::Tune;
+        std::cout << "Tuning " << argv[2] << "..." << std::endl;
+    }
+    else if (strcmp(argv[1], "-genblock") == 0)
+    {
+        if (argc != 5)
+        {
+            std::cout << "Invalid number of arguments!" << std::endl;
+            return 1;
+        }
+        unsigned int blockSize;
+        if (!parseBlockSize(argv[2], blockSize))
+        {
+            std::cerr << "Invalid block size: " << argv[2] << std::endl;
+            std::cerr << "-genblock <block_size> <mix.json> <out_block.json>: <block_size> needs to be a "
+                         "positive number"
+                      << std::endl;
+            return 1;
+        }
+        std::cout << "Generating block of size " << blockSize << " with " << argv[3] << "..." << std::endl;
+        if (!runGenBlock(blockSize, argv[3], argv[4]))
+        {
+            return 1;
+        }
+        return 0;
+    }
     else
     {
         std::cerr << "Unknown option: " << argv[1] << std::endl;
         return 1;
     }
 
-    // Read the block file
-    json input = loadJSON(argv[2]);
-    if (input == json())
+#ifdef MULTICORE
+    if (mode == Mode::Supervisor)
     {
-        return 1;
+        // The workers are forked after the circuit is created and the proving key is loaded,
+        // OpenMP can't start any threads in the supervisor before (the threads don't exist in the workers)
+        omp_set_num_threads(1);
     }
+#endif
 
-    // Read meta data
-    int iBlockType = input["blockType"].get<int>();
-    unsigned int blockSize = input["blockSize"].get<int>();
-    std::string postFix = "_" + std::to_string(blockSize);
+    uint64_t traceStart = 0;
+    // Modes that handle a single block
+    bool singleBlock =
+      (mode == Mode::Validate || mode == Mode::Prove || mode == Mode::Witness || mode == Mode::ProveWitness);
+    if (traceFilename.length() > 0 && singleBlock)
+    {
+        traceStart = Loopring::Trace::get().begin();
+    }
 
-    /*if (iBlockType >= int(Loopring::BlockType::COUNT))
+    json input;
+    unsigned int blockType;
+    unsigned int blockSize;
+    if (mode == Mode::ProveWitness)
     {
-        std::cerr << "Invalid block type: " << iBlockType << std::endl;
-        return 1;
-    }*/
-    unsigned int blockType = iBlockType;
+        // The circuit the witness was generated for is stored in the witness file
+        Loopring::WitnessFileHeader header;
+        if (!Loopring::WitnessFile::readHeader(argv[2], header))
+        {
+            return 1;
+        }
+        blockType = header.blockType;
+        blockSize = header.blockSize;
+    }
+    else
+    {
+        // Read the block file
+        // When proving, only the block type and size are read here, the rest
+        // of the block is read while the witness is generated.
+        bool streamed = (mode == Mode::Prove || mode == Mode::Witness || mode == Mode::ProveBatch);
+        std::string blockFilename = (mode == Mode::ProveBatch) ? blockFilenames[0] : argv[2];
+        input = streamed ? loadBlockHeader(blockFilename) : loadJSON(blockFilename);
+        if (input == json())
+        {
+            return 1;
+        }
+
+        // Read meta data
+        int iBlockType = input["blockType"].get<int>();
+        blockSize = input["blockSize"].get<int>();
+
+        /*if (iBlockType >= int(Loopring::BlockType::COUNT))
+        {
+            std::cerr << "Invalid block type: " << iBlockType << std::endl;
+            return 1;
+        }*/
+        blockType = iBlockType;
+    }
+    std::string postFix = "_" + std::to_string(blockSize);
     baseFilename += getBaseName(blockType) + postFix;
     std::string provingKeyFilename = getProvingKeyFilename(baseFilename);
 
-    if (mode == Mode::Prove || mode == Mode::Server)
+    if (mode == Mode::Prove || mode == Mode::ProveWitness || mode == Mode::ProveBatch || mode == Mode::Server ||
+        mode == Mode::Supervisor)
     {
         if (!fileExists(provingKeyFilename))
         {
@@ -855,6 +3110,11 @@ int main(int argc, char **argv)
 
     ethsnarks::ProtoboardT pb;
     Loopring::Circuit *circuit = createCircuit(blockType, blockSize, pb);
+    // No witness is generated for a witness file
+    if (options.witness_templates && mode != Mode::ProveWitness)
+    {
+        circuit->enableWitnessTemplates();
+    }
     if (config.swapAB)
     {
         // pb.constraint_system.swap_AB_if_beneficial();
@@ -886,17 +3146,45 @@ int main(int argc, char **argv)
         runBenchmark(circuit, provingKeyFilename);
     }
 
+    if (mode == Mode::Tune)
+    {
+        if (!generateWitness(circuit, input))
+        {
+            return 1;
+        }
+        return runTune(circuit, provingKeyFilename, (argc == 4) ? argv[3] : "config.json") ? 0 : 1;
+    }
+
+    // Only the server and -provebatch generate the witness of a block while proving another block
+    if (mode != Mode::Server && mode != Mode::ProveBatch)
+    {
+        options.double_buffering = false;
+    }
+    // The workers of the supervisor set their own threads
+    if (mode != Mode::Supervisor)
+    {
+        setNumThreads(config.num_threads, options);
+    }
 #ifdef MULTICORE
-    omp_set_num_threads(config.num_threads);
     std::cout << "Num threads used: " << omp_get_max_threads() << std::endl;
 #endif
 
     if (mode == Mode::Server)
     {
-        runServer(circuit, provingKeyFilename, config, std::stoi(argv[3]));
+        runServer(circuit, provingKeyFilename, config, options, std::stoi(argv[3]));
+    }
+
+    if (mode == Mode::ProveBatch)
+    {
+        return runProveBatch(circuit, provingKeyFilename, config, options, blockFilenames, argv[3]) ? 0 : 1;
     }
 
-    if (mode == Mode::Validate || mode == Mode::Prove)
+    if (mode == Mode::Supervisor)
+    {
+        runSupervisor(circuit, provingKeyFilename, config, options, std::stoi(argv[3]), std::stoi(argv[4]));
+    }
+
+    if (mode == Mode::Validate)
     {
         if (!generateWitness(circuit, input))
         {
@@ -904,7 +3192,37 @@ int main(int argc, char **argv)
         }
     }
 
-    if (mode == Mode::Validate || mode == Mode::Prove)
+    std::string checkpointFilename;
+    if (mode == Mode::Prove)
+    {
+        Loopring::ProverJob job;
+        job.blockFilename = argv[2];
+        job.validate = false;
+        checkpointFilename = getWitnessCheckpointFilename(options.checkpoint_dir, circuit, job);
+        // A witness from a checkpoint is still validated below
+        if (!loadWitnessCheckpoint(circuit, checkpointFilename) && !generateWitness(circuit, std::string(argv[2])))
+        {
+            return 1;
+        }
+    }
+
+    if (mode == Mode::Witness)
+    {
+        if (!generateWitness(circuit, std::string(argv[2])))
+        {
+            return 1;
+        }
+    }
+
+    if (mode == Mode::ProveWitness)
+    {
+        if (!loadWitness(circuit, argv[2]))
+        {
+            return 1;
+        }
+    }
+
+    if (singleBlock)
     {
         if (!validateCircuit(circuit))
         {
@@ -912,6 +3230,19 @@ int main(int argc, char **argv)
         }
     }
 
+    if (mode == Mode::Prove && !fileExists(checkpointFilename))
+    {
+        writeWitnessCheckpoint(circuit, checkpointFilename);
+    }
+
+    if (mode == Mode::Witness)
+    {
+        if (!writeWitness(circuit, argv[3]))
+        {
+            return 1;
+        }
+    }
+
     if (mode == Mode::CreateKeys)
     {
         if (!generateKeyPair(pb, baseFilename))
@@ -921,7 +3252,7 @@ int main(int argc, char **argv)
         }
     }
 
-    if (mode == Mode::Prove)
+    if (mode == Mode::Prove || mode == Mode::ProveWitness)
     {
 #ifdef GPU_PROVE
         std::cout << "GPU Prove: Generate inputsFile." << std::endl;
@@ -946,12 +3277,17 @@ int main(int argc, char **argv)
         {
             return 1;
         }
+        removeWitnessCheckpoint(checkpointFilename);
 #endif
     }
 
     if (mode == Mode::ExportCircuit)
     {
-        if (!r1cs2json(pb, argv[3]))
+        auto begin = now();
+        bool exported = hasExtension(argv[3], ".r1cs") ? Loopring::R1CSFile::writeConstraints(pb, argv[3])
+                                                       : r1cs2json(pb, argv[3]);
+        print_time(begin, "Circuit exported");
+        if (!exported)
         {
             std::cerr << "Failed to export circuit!" << std::endl;
             return 1;
@@ -960,12 +3296,28 @@ int main(int argc, char **argv)
 
     if (mode == Mode::ExportWitness)
     {
-        if (!witness2json(pb, argv[3]))
+        auto begin = now();
+        bool exported =
+          hasExtension(argv[3], ".wtns") ? Loopring::R1CSFile::writeWitness(pb, argv[3]) : witness2json(pb, argv[3]);
+        print_time(begin, "Witness exported");
+        if (!exported)
         {
             std::cerr << "Failed to export witness!" << std::endl;
             return 1;
         }
     }
 
+    if (traceStart != 0)
+    {
+        std::ofstream file(traceFilename);
+        file << Loopring::Trace::get().end(traceStart).dump() << std::endl;
+        if (!file.good())
+        {
+            std::cerr << "Failed to write trace to " << traceFilename << std::endl;
+            return 1;
+        }
+        std::cout << "Trace written to " << traceFilename << std::endl;
+    }
+
     return 0;
 }
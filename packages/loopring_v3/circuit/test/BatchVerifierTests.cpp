@@ -0,0 +1,92 @@
+#include "../ThirdParty/catch.hpp"
+#include "TestUtils.h"
+
+#include "../Utils/BatchVerifier.h"
+
+typedef libff::G1<ppT> G1T;
+typedef libff::G2<ppT> G2T;
+
+// A verification key with known trapdoors, so valid proofs can be created without a prover
+struct TestKey
+{
+    FieldT alpha = FieldT::random_element();
+    FieldT beta = FieldT::random_element();
+    FieldT gamma = FieldT::random_element();
+    FieldT delta = FieldT::random_element();
+    std::vector<FieldT> IC;
+    VerificationKeyT vk;
+
+    TestKey(unsigned int numInputs)
+    {
+        for (unsigned int i = 0; i < numInputs + 1; i++)
+        {
+            IC.push_back(FieldT::random_element());
+        }
+        vk.alpha_g1 = alpha * G1T::one();
+        vk.beta_g2 = beta * G2T::one();
+        vk.gamma_g2 = gamma * G2T::one();
+        vk.delta_g2 = delta * G2T::one();
+        std::vector<G1T> rest;
+        for (unsigned int i = 1; i < IC.size(); i++)
+        {
+            rest.push_back(IC[i] * G1T::one());
+        }
+        vk.gamma_ABC_g1 = libsnark::accumulation_vector<G1T>(IC[0] * G1T::one(), std::move(rest));
+    }
+
+    // A*B == alpha*beta + gamma*IC(x) + delta*C
+    ProofWithInputs prove(const PrimaryInputT &inputs) const
+    {
+        FieldT a = FieldT::random_element();
+        FieldT b = FieldT::random_element();
+        FieldT ic = IC[0];
+        for (unsigned int i = 0; i < inputs.size(); i++)
+        {
+            ic += inputs[i] * IC[i + 1];
+        }
+        FieldT c = (a * b - alpha * beta - gamma * ic) * delta.inverse();
+        return ProofWithInputs(inputs, ProofT(a * G1T::one(), b * G2T::one(), c * G1T::one()));
+    }
+};
+
+TEST_CASE("BatchVerifier", "[BatchVerifier]")
+{
+    const unsigned int numInputs = 2;
+    const unsigned int numProofs = 9;
+    TestKey key(numInputs);
+    std::vector<ProofWithInputs> proofs;
+    for (unsigned int i = 0; i < numProofs; i++)
+    {
+        proofs.push_back(key.prove({FieldT(i), FieldT(i * i + 1)}));
+    }
+    BatchVerifier verifier(key.vk);
+
+    SECTION("Valid proofs")
+    {
+        REQUIRE(verifier.verify(proofs).size() == 0);
+        REQUIRE(verifier.verifyBatch(proofs, 0, numProofs));
+        REQUIRE(verifier.verifyBatch(proofs, 3, 4));
+    }
+
+    SECTION("Invalid proofs")
+    {
+        proofs[3].second.g_C = proofs[3].second.g_C + G1T::one();
+        proofs[7].first[1] += FieldT::one();
+        REQUIRE(!verifier.verifyBatch(proofs, 0, numProofs));
+        REQUIRE(verifier.verifyBatch(proofs, 4, 7));
+        REQUIRE(verifier.verify(proofs) == std::vector<size_t>({3, 7}));
+    }
+
+    SECTION("Swapped proofs")
+    {
+        // Every proof is only valid for its own inputs
+        std::swap(proofs[0].second, proofs[1].second);
+        REQUIRE(verifier.verify(proofs) == std::vector<size_t>({0, 1}));
+    }
+
+    SECTION("Wrong number of inputs")
+    {
+        proofs[5].first.push_back(FieldT::zero());
+        REQUIRE(verifier.verify(proofs) == std::vector<size_t>({5}));
+    }
+}
@@ -0,0 +1,128 @@
+#include "../ThirdParty/catch.hpp"
+#include "TestUtils.h"
+
+#include "../Circuits/UniversalCircuit.h"
+#include "../Gadgets/SignatureGadgets.h"
+#include "../Utils/BlockGenerator.h"
+#include "../Utils/EdDSA.h"
+
+TEST_CASE("fieldToString", "[BlockGenerator]")
+{
+    for (const char *value :
+         {"0",
+          "1",
+          "10000000000000000000",
+          "9999999999999999999",
+          "21888242871839275222246405745257275088548364400416034343698204186575808495616"})
+    {
+        REQUIRE(fieldToString(FieldT(value)) == value);
+    }
+}
+
+TEST_CASE("NativeEdDSA", "[BlockGenerator]")
+{
+    NativeEdDSA eddsa;
+
+    const jubjub::EdwardsPoint publicKey(
+      FieldT("21607074953141243618425427250695537464636088817373528162920186615872448542319"),
+      FieldT("3328786100751313619819855397819808730287075038642729822829479432223775713775"));
+    const FieldT message("18996832849579325290301086811580112302791300834635590497072390271656077158490");
+    const Loopring::Signature signature(
+      jubjub::EdwardsPoint(
+        FieldT("20401810397006237293387786382094924349489854205086853036638326738826249727385"),
+        FieldT("3339178343289311394427480868578479091766919601142009911922211138735585687725")),
+      FieldT("219593190015660463654216479865253652653333952251250676996482368461290160677"));
+
+    SECTION("Verify")
+    {
+        REQUIRE(eddsa.verify(publicKey, message, signature));
+        REQUIRE(!eddsa.verify(publicKey, message + FieldT::one(), signature));
+    }
+
+    SECTION("Sign")
+    {
+        std::mt19937_64 rng(1);
+        const Loopring::KeyPair keyPair = eddsa.createKeyPair(NativeEdDSA::randomScalar(rng));
+        const Loopring::Signature newSignature = eddsa.sign(keyPair, message, NativeEdDSA::randomScalar(rng));
+        REQUIRE(eddsa.verify(keyPair.publicKey, message, newSignature));
+        REQUIRE(!eddsa.verify(publicKey, message, newSignature));
+
+        // The signature also needs to be valid in the circuit
+        protoboard<FieldT> pb;
+        Constants constants(pb, "constants");
+        jubjub::VariablePointT A(pb, "publicKey");
+        pb.val(A.x) = keyPair.publicKey.x;
+        pb.val(A.y) = keyPair.publicKey.y;
+        pb_variable<FieldT> M = make_variable(pb, message, "message");
+        pb_variable<FieldT> required = make_variable(pb, FieldT::one(), "required");
+        SignatureVerifier signatureVerifier(pb, eddsa.params, constants, A, M, required, "signatureVerifier");
+        signatureVerifier.generate_r1cs_constraints();
+        signatureVerifier.generate_r1cs_witness(newSignature);
+        REQUIRE(pb.is_satisfied());
+    }
+}
+
+TEST_CASE("BlockGenerator", "[BlockGenerator]")
+{
+    json mix = R"({
+        "seed": 1,
+        "numAccounts": 4,
+        "numTokens": 2,
+        "timestamp": 1600000000,
+        "transactions": {
+            "noop": 1,
+            "deposit": 1,
+            "transfer": 2,
+            "withdraw": 1,
+            "accountUpdate": 1,
+            "spotTrade": 2,
+            "ammSwap": 1,
+            "nftMint": 1
+        }
+    })"_json;
+    const unsigned int blockSize = 10;
+
+    SECTION("Valid block")
+    {
+        BlockGenerator generator(mix);
+        json block;
+        REQUIRE(generator.generate(blockSize, block));
+        REQUIRE(block["transactions"].size() == blockSize);
+        unsigned int numAmmSwaps = 0;
+        unsigned int numNftMints = 0;
+        for (const json &transaction : block["transactions"])
+        {
+            numAmmSwaps += transaction.contains("spotTrade") && transaction["spotTrade"]["orderB"]["amm"].get<bool>();
+            numNftMints += transaction.contains("nftMint");
+        }
+        REQUIRE(numAmmSwaps == 1);
+        REQUIRE(numNftMints == 1);
+        REQUIRE(verifyMerkleProofs(block.get<Block>()).size() == 0);
+
+        protoboard<FieldT> pb;
+        UniversalCircuit circuit(pb, "circuit");
+        circuit.generateConstraints(blockSize);
+
+        // Not signed yet
+        REQUIRE(circuit.generateWitness(block));
+        REQUIRE(!pb.is_satisfied());
+
+        REQUIRE(generator.sign(block, circuit.getSignatureRequests()));
+        REQUIRE(circuit.generateWitness(block));
+        REQUIRE(pb.is_satisfied());
+
+        // The state is kept for the next block
+        json nextBlock;
+        REQUIRE(generator.generate(blockSize, nextBlock));
+        REQUIRE(nextBlock["merkleRootBefore"] == block["merkleRootAfter"]);
+        REQUIRE(verifyMerkleProofs(nextBlock.get<Block>()).size() == 0);
+    }
+
+    SECTION("Unsupported transaction type")
+    {
+        mix["transactions"]["ammUpdate"] = 1;
+        BlockGenerator generator(mix);
+        json block;
+        REQUIRE(!generator.generate(blockSize, block));
+    }
+}
@@ -0,0 +1,55 @@
+#include "../ThirdParty/catch.hpp"
+
+#include "../Utils/BlockReader.h"
+
+#include <sstream>
+
+using namespace Loopring;
+
+TEST_CASE("BlockReader", "[BlockReader]")
+{
+    SECTION("Header before the transactions")
+    {
+        // Reading stops once the fields are known, the invalid data after them is never read
+        std::stringstream stream(R"({"blockType": 0, "blockSize": 4, "transactions": [{"a": )");
+        json header = BlockReader::readHeader(stream, {"blockType", "blockSize"});
+        REQUIRE(header["blockType"].get<unsigned int>() == 0);
+        REQUIRE(header["blockSize"].get<unsigned int>() == 4);
+    }
+
+    SECTION("Header after the transactions")
+    {
+        std::stringstream stream(
+          R"({"transactions": [{"a": "]}\"", "b": [1, {"c": null}]}, {}], "exchange": "0x12",)"
+          R"( "accountUpdate_P": {"before": [1, 2]}, "blockSize": 4})");
+        json header = BlockReader::readHeader(stream, {"blockSize", "accountUpdate_P"});
+        REQUIRE(header["blockSize"].get<unsigned int>() == 4);
+        REQUIRE(header["accountUpdate_P"] == json::parse(R"({"before": [1, 2]})"));
+        REQUIRE(!header.contains("exchange"));
+        REQUIRE(!header.contains("transactions"));
+    }
+
+    SECTION("All block data")
+    {
+        std::stringstream stream(R"({"blockSize": 4, "transactions": [{}], "signature": {"s": "1"}, "valid": true})");
+        json header = BlockReader::readHeader(stream);
+        REQUIRE(header == json::parse(R"({"blockSize": 4, "signature": {"s": "1"}, "valid": true})"));
+    }
+
+    SECTION("Missing field")
+    {
+        std::stringstream stream(R"({"blockType": 0, "transactions": []})");
+        json header = BlockReader::readHeader(stream, {"blockType", "blockSize"});
+        REQUIRE(header != json());
+        REQUIRE(!header.contains("blockSize"));
+    }
+
+    SECTION("Invalid block")
+    {
+        for (const char *data : {"", "[]", R"({"blockSize": )", R"({"transactions": [}, "blockSize": 4})"})
+        {
+            std::stringstream stream(data);
+            REQUIRE(BlockReader::readHeader(stream, {"blockSize"}) == json());
+        }
+    }
+}
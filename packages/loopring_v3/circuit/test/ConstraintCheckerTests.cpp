@@ -0,0 +1,27 @@
+#include "../ThirdParty/catch.hpp"
+#include "TestUtils.h"
+
+#include "../Utils/ConstraintChecker.h"
+
+TEST_CASE("ConstraintChecker", "[ConstraintChecker]")
+{
+    protoboard<FieldT> pb;
+    const std::vector<VariableT> y = addSquaresCircuit(pb, 100).y;
+
+    for (size_t chunkSize : {1, 7, 4096})
+    {
+        REQUIRE(findUnsatisfiedConstraints(pb, 1, chunkSize).size() == 0);
+
+        pb.val(y[3]) += FieldT::one();
+        pb.val(y[42]) += FieldT::one();
+        pb.val(y[99]) += FieldT::one();
+        REQUIRE(findUnsatisfiedConstraints(pb, 1, chunkSize) == std::vector<size_t>({3}));
+        REQUIRE(findUnsatisfiedConstraints(pb, 2, chunkSize) == std::vector<size_t>({3, 42}));
+        REQUIRE(findUnsatisfiedConstraints(pb, 8, chunkSize) == std::vector<size_t>({3, 42, 99}));
+        REQUIRE(!pb.is_satisfied());
+
+        pb.val(y[3]) -= FieldT::one();
+        pb.val(y[42]) -= FieldT::one();
+        pb.val(y[99]) -= FieldT::one();
+    }
+}
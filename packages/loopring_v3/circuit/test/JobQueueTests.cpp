@@ -0,0 +1,127 @@
+#include "../ThirdParty/catch.hpp"
+
+#include "../Utils/JobQueue.h"
+
+#include <thread>
+
+using namespace Loopring;
+
+TEST_CASE("JobQueue", "[JobQueue]")
+{
+    JobQueue jobs(3, 2);
+
+    SECTION("Priority order")
+    {
+        unsigned int idA = jobs.submit("a.json", "", false, 0)->id;
+        unsigned int idB = jobs.submit("b.json", "", false, 1)->id;
+        unsigned int idC = jobs.submit("c.json", "", false, 0)->id;
+        REQUIRE(jobs.numQueued() == 3);
+
+        // Highest priority first, then in submission order
+        REQUIRE(jobs.next()->id == idB);
+        REQUIRE(jobs.next()->id == idA);
+        REQUIRE(jobs.next()->id == idC);
+        REQUIRE(jobs.numQueued() == 0);
+    }
+
+    SECTION("Bounded")
+    {
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            REQUIRE(jobs.submit("block.json", "", false, 0));
+        }
+        REQUIRE(!jobs.submit("block.json", "", false, 0));
+        jobs.next();
+        REQUIRE(jobs.submit("block.json", "", false, 0));
+    }
+
+    SECTION("Phases")
+    {
+        unsigned int id = jobs.submit("block.json", "", false, 0)->id;
+        REQUIRE(jobs.getStatus(id)["state"] == "queued");
+        std::shared_ptr<ProverJob> job = jobs.next();
+        REQUIRE(jobs.enterPhase(job, "witness"));
+        REQUIRE(jobs.getStatus(id)["state"] == "running");
+        REQUIRE(jobs.getStatus(id)["phase"] == "witness");
+        REQUIRE(jobs.getRunning()->id == id);
+        REQUIRE(jobs.enterPhase(job, "prove"));
+        jobs.finish(job, "proof", "");
+
+        json status = jobs.getStatus(id);
+        REQUIRE(status["state"] == "done");
+        REQUIRE(status["timing"]["phases"].contains("witness"));
+        REQUIRE(status["timing"]["phases"].contains("prove"));
+        REQUIRE(jobs.get(id)->proof == "proof");
+        REQUIRE(!jobs.getRunning());
+    }
+
+    SECTION("Uploaded block")
+    {
+        std::shared_ptr<const std::string> block = std::make_shared<const std::string>("{}");
+        unsigned int id = jobs.submit("", "", false, 0, false, block)->id;
+        std::shared_ptr<ProverJob> job = jobs.next();
+        REQUIRE(job->blockData == block);
+        jobs.finish(job, "proof", "");
+        // The block is only kept until the job is finished
+        REQUIRE(!jobs.get(id)->blockData);
+        REQUIRE(block.use_count() == 1);
+    }
+
+    SECTION("Cancel queued job")
+    {
+        unsigned int idA = jobs.submit("a.json", "", false, 0)->id;
+        unsigned int idB = jobs.submit("b.json", "", false, 0)->id;
+        REQUIRE(jobs.cancel(idA));
+        REQUIRE(!jobs.cancel(idA));
+        REQUIRE(jobs.getStatus(idA)["state"] == "cancelled");
+        REQUIRE(jobs.next()->id == idB);
+    }
+
+    SECTION("Cancel running job")
+    {
+        unsigned int id = jobs.submit("block.json", "", false, 0)->id;
+        std::shared_ptr<ProverJob> job = jobs.next();
+        REQUIRE(jobs.enterPhase(job, "witness"));
+        REQUIRE(jobs.cancel(id));
+        REQUIRE(!jobs.enterPhase(job, "prove"));
+        jobs.finish(job, "", "Cancelled");
+        REQUIRE(jobs.getStatus(id)["state"] == "cancelled");
+        jobs.wait(job);
+    }
+
+    SECTION("Finished jobs are forgotten")
+    {
+        std::vector<unsigned int> ids;
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            ids.push_back(jobs.submit("block.json", "", false, 0)->id);
+            jobs.finish(jobs.next(), "", "Failed");
+        }
+        REQUIRE(!jobs.get(ids[0]));
+        REQUIRE(jobs.get(ids[1])->state == JobState::Failed);
+        REQUIRE(jobs.get(ids[2])->state == JobState::Failed);
+    }
+
+    SECTION("Close")
+    {
+        std::shared_ptr<const std::string> block = std::make_shared<const std::string>("{}");
+        unsigned int id = jobs.submit("", "", false, 0, false, block)->id;
+        jobs.close();
+        REQUIRE(!jobs.next());
+        REQUIRE(!jobs.submit("block.json", "", false, 0));
+        REQUIRE(jobs.getStatus(id)["state"] == "cancelled");
+        REQUIRE(jobs.isClosed());
+        // Cancelled jobs are finished jobs
+        REQUIRE(!jobs.get(id)->blockData);
+        REQUIRE(block.use_count() == 1);
+        REQUIRE(jobs.wait(jobs.get(id)).state == JobState::Cancelled);
+    }
+
+    SECTION("Wait until closed")
+    {
+        std::thread closer([&]() { jobs.close(); });
+        jobs.waitClosed();
+        REQUIRE(jobs.isClosed());
+        closer.join();
+    }
+}
@@ -0,0 +1,54 @@
+#include "../ThirdParty/catch.hpp"
+
+#include "../Utils/Metrics.h"
+
+using namespace Loopring;
+
+static bool containsLine(const std::string &text, const std::string &line)
+{
+    return text.find(line + "\n") != std::string::npos;
+}
+
+TEST_CASE("Metrics", "[Metrics]")
+{
+    Metrics metrics;
+
+    SECTION("Counter")
+    {
+        metrics.add("proofs_total", MetricType::Counter, "Number of proofs");
+        metrics.increment("proofs_total");
+        metrics.increment("proofs_total");
+        metrics.increment("failures_total", Metrics::labels({{"reason", "Block \"1\" is invalid"}}));
+
+        std::string text = metrics.serialize();
+        REQUIRE(containsLine(text, "# HELP proofs_total Number of proofs"));
+        REQUIRE(containsLine(text, "# TYPE proofs_total counter"));
+        REQUIRE(containsLine(text, "proofs_total 2"));
+        REQUIRE(containsLine(text, "failures_total{reason=\"Block \\\"1\\\" is invalid\"} 1"));
+    }
+
+    SECTION("Gauge")
+    {
+        metrics.add("queue_depth", MetricType::Gauge, "Queued jobs");
+        metrics.set("queue_depth", 3);
+        metrics.set("queue_depth", 1);
+        REQUIRE(containsLine(metrics.serialize(), "queue_depth 1"));
+    }
+
+    SECTION("Histogram")
+    {
+        metrics.add("phase_seconds", MetricType::Histogram, "Phase duration", {1, 10});
+        std::string labels = Metrics::labels({{"phase", "prove"}});
+        metrics.observe("phase_seconds", 0.5, labels);
+        metrics.observe("phase_seconds", 5, labels);
+        metrics.observe("phase_seconds", 50, labels);
+
+        std::string text = metrics.serialize();
+        REQUIRE(containsLine(text, "# TYPE phase_seconds histogram"));
+        REQUIRE(containsLine(text, "phase_seconds_bucket{phase=\"prove\",le=\"1\"} 1"));
+        REQUIRE(containsLine(text, "phase_seconds_bucket{phase=\"prove\",le=\"10\"} 2"));
+        REQUIRE(containsLine(text, "phase_seconds_bucket{phase=\"prove\",le=\"+Inf\"} 3"));
+        REQUIRE(containsLine(text, "phase_seconds_sum{phase=\"prove\"} 55.5"));
+        REQUIRE(containsLine(text, "phase_seconds_count{phase=\"prove\"} 3"));
+    }
+}
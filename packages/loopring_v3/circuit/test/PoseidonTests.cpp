@@ -0,0 +1,160 @@
+#include "../ThirdParty/catch.hpp"
+#include "TestUtils.h"
+
+#include "../Gadgets/MathGadgets.h"
+#include "../Utils/Poseidon.h"
+
+#include <chrono>
+
+template <typename GadgetT, typename NativeT> void checkPoseidon(unsigned int numInputs)
+{
+    unsigned int numIterations = 8;
+    for (unsigned int i = 0; i < numIterations; i++)
+    {
+        protoboard<FieldT> pb;
+        std::vector<FieldT> values;
+        std::vector<VariableT> inputs;
+        for (unsigned int j = 0; j < numInputs; j++)
+        {
+            values.push_back(getRandomFieldElement());
+            inputs.push_back(make_variable(pb, values.back(), ".input"));
+        }
+
+        GadgetT hash(pb, var_array(inputs), "hash");
+        hash.generate_r1cs_constraints();
+        hash.generate_r1cs_witness();
+        REQUIRE(pb.is_satisfied());
+
+        REQUIRE(NativeT::hash(values) == pb.val(hash.result()));
+    }
+}
+
+TEST_CASE("Poseidon", "[PoseidonPermutation]")
+{
+    SECTION("Single")
+    {
+        checkPoseidon<Poseidon_2, PoseidonNative_2>(2);
+        checkPoseidon<Poseidon_3, PoseidonNative_3>(3);
+        checkPoseidon<Poseidon_4, PoseidonNative_4>(4);
+        checkPoseidon<Poseidon_4_<3>, PoseidonNative_4>(3);
+        checkPoseidon<Poseidon_4_<2>, PoseidonNative_4>(2);
+        checkPoseidon<Poseidon_5, PoseidonNative_5>(5);
+        checkPoseidon<Poseidon_6, PoseidonNative_6>(6);
+        checkPoseidon<Poseidon_8, PoseidonNative_8>(8);
+        checkPoseidon<Poseidon_9, PoseidonNative_9>(9);
+        checkPoseidon<Poseidon_10, PoseidonNative_10>(10);
+        checkPoseidon<Poseidon_11, PoseidonNative_11>(11);
+        checkPoseidon<Poseidon_12, PoseidonNative_12>(12);
+    }
+
+    SECTION("Batch")
+    {
+        // Use a batch size that is not a multiple of the number of lanes
+        unsigned int batchSize = PoseidonNative_12::NUM_LANES * 3 + 5;
+        std::vector<std::vector<FieldT>> inputs;
+        for (unsigned int i = 0; i < batchSize; i++)
+        {
+            std::vector<FieldT> values;
+            for (unsigned int j = 0; j < 12; j++)
+            {
+                values.push_back(getRandomFieldElement());
+            }
+            inputs.push_back(values);
+        }
+
+        std::vector<FieldT> outputs = PoseidonNative_12::hash(inputs);
+        REQUIRE(outputs.size() == batchSize);
+        for (unsigned int i = 0; i < batchSize; i++)
+        {
+            REQUIRE(outputs[i] == PoseidonNative_12::hash(inputs[i]));
+        }
+    }
+}
+
+TEST_CASE("Merkle proofs", "[verifyMerkleProofs]")
+{
+    Block block = getBlock();
+
+    SECTION("Everything correct")
+    {
+        REQUIRE(verifyMerkleProofs(block).size() == 0);
+    }
+
+    SECTION("Incorrect proof")
+    {
+        block.transactions[1].witness.balanceUpdateS_B.proof.data[4] += 1;
+        std::vector<MerkleProofError> errors = verifyMerkleProofs(block);
+        REQUIRE(errors.size() == 2);
+        REQUIRE(errors[0].txIdx == 1);
+        REQUIRE(errors[0].update == "balanceUpdateS_B.rootBefore");
+        REQUIRE(errors[1].update == "balanceUpdateS_B.rootAfter");
+    }
+
+    SECTION("Incorrect leaf after")
+    {
+        block.transactions[2].witness.accountUpdate_A.after.nonce += 1;
+        std::vector<MerkleProofError> errors = verifyMerkleProofs(block);
+        REQUIRE(errors.size() == 1);
+        REQUIRE(errors[0].txIdx == 2);
+        REQUIRE(errors[0].update == "accountUpdate_A.rootAfter");
+    }
+}
+
+// Not run by default, use `dex_circuit_tests [benchmark]` to compare the gadget with the native implementation
+TEST_CASE("Poseidon benchmark", "[.][benchmark]")
+{
+    unsigned int numHashes = 4096;
+    std::vector<std::vector<FieldT>> inputs;
+    for (unsigned int i = 0; i < numHashes; i++)
+    {
+        inputs.push_back(
+          {getRandomFieldElement(), getRandomFieldElement(), getRandomFieldElement(), getRandomFieldElement()});
+    }
+
+    protoboard<FieldT> pb;
+    std::vector<Poseidon_4> gadgets;
+    gadgets.reserve(numHashes);
+    for (unsigned int i = 0; i < numHashes; i++)
+    {
+        std::vector<VariableT> variables;
+        for (const FieldT &value : inputs[i])
+        {
+            variables.push_back(make_variable(pb, value, ".input"));
+        }
+        gadgets.emplace_back(pb, var_array(variables), "hash");
+    }
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (auto &gadget : gadgets)
+    {
+        gadget.generate_r1cs_witness();
+    }
+    auto gadgetTime = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::high_resolution_clock::now() - begin)
+                        .count();
+
+    begin = std::chrono::high_resolution_clock::now();
+    std::vector<FieldT> singleOutputs;
+    for (const auto &input : inputs)
+    {
+        singleOutputs.push_back(PoseidonNative_4::hash(input));
+    }
+    auto singleTime = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::high_resolution_clock::now() - begin)
+                        .count();
+
+    begin = std::chrono::high_resolution_clock::now();
+    std::vector<FieldT> batchOutputs = PoseidonNative_4::hash(inputs);
+    auto batchTime = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::high_resolution_clock::now() - begin)
+                       .count();
+
+    for (unsigned int i = 0; i < numHashes; i++)
+    {
+        REQUIRE(batchOutputs[i] == pb.val(gadgets[i].result()));
+        REQUIRE(singleOutputs[i] == batchOutputs[i]);
+    }
+
+    std::cout << "Poseidon_4 x " << numHashes << ": gadget witness " << gadgetTime << "us, native " << singleTime
+              << "us, native batch " << batchTime << "us" << std::endl;
+}
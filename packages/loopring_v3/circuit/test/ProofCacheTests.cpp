@@ -0,0 +1,108 @@
+#include "../ThirdParty/catch.hpp"
+#include "TestUtils.h"
+
+#include "../Utils/ProofCache.h"
+
+#include <cstdio>
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/stat.h>
+
+// Sets the modification time of an entry, the least recently used entries have the oldest times
+static void setModified(const std::string &filename, time_t seconds)
+{
+    struct timespec times[2];
+    times[0].tv_sec = seconds;
+    times[0].tv_nsec = 0;
+    times[1] = times[0];
+    REQUIRE(utimensat(AT_FDCWD, filename.c_str(), times, 0) == 0);
+}
+
+static void removeDirectory(const std::string &directory)
+{
+    nftw(
+      directory.c_str(),
+      [](const char *path, const struct stat *, int, struct FTW *) { return std::remove(path); },
+      16,
+      FTW_DEPTH | FTW_PHYS);
+}
+
+TEST_CASE("ProofCache", "[ProofCache]")
+{
+    const std::string directory = "proof_cache_test";
+    const std::string proof(100, 'p');
+
+    SECTION("Get and put")
+    {
+        ProofCache cache(directory, 1000);
+        std::string value;
+        REQUIRE(!cache.get("a", value));
+        REQUIRE(cache.put("a", proof));
+        REQUIRE(cache.get("a", value));
+        REQUIRE(value == proof);
+        REQUIRE(cache.getSize() == proof.size());
+
+        // The entries are kept when the cache is reopened
+        ProofCache otherCache(directory, 1000);
+        REQUIRE(otherCache.get("a", value));
+        REQUIRE(value == proof);
+    }
+
+    SECTION("Eviction")
+    {
+        ProofCache cache(directory, 350);
+        std::string value;
+        time_t modified = 1000;
+        for (const std::string key : {"a", "b", "c"})
+        {
+            REQUIRE(cache.put(key, proof));
+            setModified(directory + "/" + key, modified++);
+        }
+        // "a" is now more recently used than "b"
+        REQUIRE(cache.get("a", value));
+        REQUIRE(cache.put("d", proof));
+        REQUIRE(cache.getSize() <= 350);
+        REQUIRE(cache.get("a", value));
+        REQUIRE(!cache.get("b", value));
+        REQUIRE(cache.get("c", value));
+        REQUIRE(cache.get("d", value));
+    }
+
+    SECTION("Entry larger than the cache")
+    {
+        ProofCache cache(directory, 50);
+        std::string value;
+        REQUIRE(cache.put("a", proof));
+        REQUIRE(cache.put("b", proof));
+        REQUIRE(!cache.get("a", value));
+        REQUIRE(cache.get("b", value));
+    }
+
+    SECTION("Hashes")
+    {
+        const std::string filename = directory + "_block.json";
+        {
+            std::ofstream file(filename, std::ios::trunc);
+            file << "{\"blockSize\": 4}";
+        }
+        uint64_t hash;
+        REQUIRE(ProofCache::hashFile(filename, hash));
+        REQUIRE(hash == ProofCache::hashString("{\"blockSize\": 4}"));
+        REQUIRE(hash != ProofCache::hashString("{\"blockSize\": 8}"));
+        REQUIRE(!ProofCache::hashFile(filename + ".missing", hash));
+        REQUIRE(ProofCache::toHex(0xabc) == "0000000000000abc");
+        std::remove(filename.c_str());
+
+        protoboard<FieldT> pb;
+        VariableT input = make_variable(pb, FieldT(0x1234), "input");
+        make_variable(pb, FieldT(7), "x");
+        pb.set_input_sizes(1);
+        const std::string hex = ProofCache::primaryInputToHex(pb);
+        REQUIRE(hex.substr(hex.size() - 16) == "0000000000001234");
+        pb.val(input) = FieldT(0x1235);
+        REQUIRE(ProofCache::primaryInputToHex(pb) != hex);
+    }
+
+    removeDirectory(directory);
+}
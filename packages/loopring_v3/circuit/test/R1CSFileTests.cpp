@@ -0,0 +1,70 @@
+#include "../ThirdParty/catch.hpp"
+#include "TestUtils.h"
+
+#include "../Utils/R1CSFile.h"
+
+#include <cstdio>
+
+TEST_CASE("R1CSFile", "[R1CSFile]")
+{
+    const std::string r1csFilename = "r1cs_file_test.r1cs";
+    const std::string wtnsFilename = "r1cs_file_test.wtns";
+
+    protoboard<FieldT> pb;
+    VariableT input = make_variable(pb, FieldT(7), "input");
+    pb.set_input_sizes(1);
+    SquaresCircuit circuit = addSquaresCircuit(pb, 100);
+    // Linear combinations with coefficients: (2*y[i] + x[i]) * x[i] == z[i]
+    for (unsigned int i = 0; i < circuit.x.size(); i++)
+    {
+        const VariableT &x = circuit.x[i];
+        const VariableT &y = circuit.y[i];
+        VariableT z = make_variable(pb, (FieldT(2) * pb.val(y) + pb.val(x)) * pb.val(x), "z");
+        pb.add_r1cs_constraint(ConstraintT(y * 2 + x, x, z), "constraint");
+    }
+    pb.add_r1cs_constraint(ConstraintT(input, FieldT::one(), FieldT(7)), "input == 7");
+    REQUIRE(pb.is_satisfied());
+
+    // Small chunks so the constraints and values are split over multiple chunks
+    REQUIRE(R1CSFile::writeConstraints(pb, r1csFilename, 7));
+    REQUIRE(R1CSFile::writeWitness(pb, wtnsFilename, 7));
+
+    SECTION("Magic")
+    {
+        std::ifstream r1csFile(r1csFilename, std::ios::binary);
+        char magic[4];
+        r1csFile.read(magic, 4);
+        REQUIRE(std::string(magic, 4) == "r1cs");
+        std::ifstream wtnsFile(wtnsFilename, std::ios::binary);
+        wtnsFile.read(magic, 4);
+        REQUIRE(std::string(magic, 4) == "wtns");
+    }
+
+    SECTION("Import")
+    {
+        protoboard<FieldT> otherPb;
+        REQUIRE(R1CSFile::readConstraints(r1csFilename, otherPb));
+        REQUIRE(otherPb.num_constraints() == pb.num_constraints());
+        REQUIRE(otherPb.num_inputs() == pb.num_inputs());
+        REQUIRE(otherPb.num_variables() == pb.num_variables());
+
+        REQUIRE(R1CSFile::readWitness(wtnsFilename, otherPb, 7));
+        REQUIRE(otherPb.values == pb.values);
+        REQUIRE(otherPb.is_satisfied());
+
+        // The imported constraints still check the witness
+        otherPb.values[5] += FieldT::one();
+        REQUIRE(!otherPb.is_satisfied());
+    }
+
+    SECTION("Witness of a different circuit")
+    {
+        protoboard<FieldT> otherPb;
+        make_variable(otherPb, FieldT::one(), "x");
+        REQUIRE(!R1CSFile::readWitness(wtnsFilename, otherPb));
+        REQUIRE(!R1CSFile::readConstraints(wtnsFilename, otherPb));
+    }
+
+    std::remove(r1csFilename.c_str());
+    std::remove(wtnsFilename.c_str());
+}
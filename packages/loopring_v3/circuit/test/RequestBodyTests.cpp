@@ -0,0 +1,91 @@
+#include "../ThirdParty/catch.hpp"
+
+#include "../Utils/RequestBody.h"
+
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace Loopring;
+
+// Sends the raw request to the server on `port`, returns the status line of the response
+static std::string sendRequest(int port, const std::string &request)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    std::string response;
+    if (connect(sock, (sockaddr *)&addr, sizeof(addr)) == 0)
+    {
+        send(sock, request.data(), request.size(), 0);
+        // The body is shorter than the Content-Length, end the request
+        shutdown(sock, SHUT_WR);
+        char buffer[1024];
+        ssize_t length;
+        while ((length = recv(sock, buffer, sizeof(buffer), 0)) > 0)
+        {
+            response.append(buffer, length);
+        }
+    }
+    close(sock);
+    return response.substr(0, response.find("\r\n"));
+}
+
+TEST_CASE("RequestBody", "[RequestBody]")
+{
+    const size_t maxLength = 16;
+    httplib::Server server;
+    server.set_payload_max_length(maxLength);
+    std::shared_ptr<const std::string> received;
+    bool called = false;
+    server.Post(
+      "/upload",
+      [&](const httplib::Request &req, httplib::Response &res, const httplib::ContentReader &reader) {
+          called = true;
+          if (!readRequestBody(req, reader, maxLength, received))
+          {
+              return;
+          }
+          res.set_content(received ? *received : std::string("empty"), "text/plain");
+      });
+    int port = server.bind_to_any_port("127.0.0.1");
+    REQUIRE(port > 0);
+    std::thread listener([&]() { server.listen_after_bind(); });
+    while (!server.is_running())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    SECTION("Body")
+    {
+        std::string request = "POST /upload HTTP/1.1\r\nConnection: close\r\nContent-Length: 5\r\n\r\nblock";
+        REQUIRE(sendRequest(port, request) == "HTTP/1.1 200 OK");
+        REQUIRE(received);
+        REQUIRE(*received == "block");
+    }
+
+    SECTION("Empty body")
+    {
+        std::string request = "POST /upload HTTP/1.1\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+        REQUIRE(sendRequest(port, request) == "HTTP/1.1 200 OK");
+        REQUIRE(!received);
+    }
+
+    SECTION("Oversized Content-Length")
+    {
+        // A Content-Length of 1TB without the data is rejected without reserving memory for it
+        std::string request =
+          "POST /upload HTTP/1.1\r\nConnection: close\r\nContent-Length: 1099511627776\r\n\r\nblock";
+        REQUIRE(sendRequest(port, request) == "HTTP/1.1 413 Payload Too Large");
+        REQUIRE(called);
+        REQUIRE(!received);
+    }
+
+    server.stop();
+    listener.join();
+}
@@ -122,6 +122,26 @@ static bool compareBits(const libff::bit_vector &A, const libff::bit_vector &B)
     return true;
 }
 
+// A small circuit for the tests of the tools working on any circuit:
+// x[i] * x[i] == y[i] with x[i] = i + offset
+struct SquaresCircuit
+{
+    std::vector<VariableT> x;
+    std::vector<VariableT> y;
+};
+
+static SquaresCircuit addSquaresCircuit(protoboard<FieldT> &pb, unsigned int numConstraints, unsigned int offset = 0)
+{
+    SquaresCircuit circuit;
+    for (unsigned int i = 0; i < numConstraints; i++)
+    {
+        circuit.x.push_back(make_variable(pb, FieldT(i + offset), "x"));
+        circuit.y.push_back(make_variable(pb, FieldT((i + offset) * (i + offset)), "y"));
+        pb.add_r1cs_constraint(ConstraintT(circuit.x[i], circuit.x[i], circuit.y[i]), "x * x == y");
+    }
+    return circuit;
+}
+
 static Block getBlock()
 {
     // Read the JSON file
@@ -0,0 +1,96 @@
+#include "../ThirdParty/catch.hpp"
+
+#include "../Utils/ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <set>
+
+using namespace Loopring;
+
+TEST_CASE("ThreadPool", "[ThreadPool]")
+{
+    ThreadPool pool(4);
+
+    SECTION("Nested tasks")
+    {
+        ThreadPool::Job job(pool, 0);
+        std::vector<unsigned int> results(64, 0);
+        ThreadPool::TaskGroup group(job);
+        for (unsigned int i = 0; i < results.size(); i++)
+        {
+            group.run([&, i]() {
+                std::atomic<unsigned int> sum(0);
+                ThreadPool::TaskGroup stages(job);
+                for (unsigned int j = 0; j < 8; j++)
+                {
+                    stages.run([&, j]() { sum += i * j; });
+                }
+                stages.wait();
+                results[i] = sum;
+            });
+        }
+        group.wait();
+        for (unsigned int i = 0; i < results.size(); i++)
+        {
+            REQUIRE(results[i] == i * 28);
+        }
+    }
+
+    SECTION("Thread budget")
+    {
+        for (unsigned int budget : {1, 2, 3})
+        {
+            ThreadPool::Job job(pool, budget);
+            std::atomic<unsigned int> running(0);
+            std::atomic<unsigned int> maxRunning(0);
+            {
+                ThreadPool::TaskGroup group(job);
+                for (unsigned int i = 0; i < 32; i++)
+                {
+                    group.run([&]() {
+                        unsigned int current = ++running;
+                        unsigned int seen = maxRunning;
+                        while (current > seen && !maxRunning.compare_exchange_weak(seen, current))
+                        {
+                        }
+                        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                        running--;
+                    });
+                }
+            }
+            REQUIRE(maxRunning <= budget);
+        }
+    }
+
+    SECTION("Budget of one runs on the waiting thread")
+    {
+        ThreadPool::Job job(pool, 1);
+        std::set<std::thread::id> threads;
+        ThreadPool::TaskGroup group(job);
+        for (unsigned int i = 0; i < 16; i++)
+        {
+            group.run([&]() { threads.insert(std::this_thread::get_id()); });
+        }
+        group.wait();
+        REQUIRE(threads == std::set<std::thread::id>({std::this_thread::get_id()}));
+    }
+
+    SECTION("Thread budget of the calling thread")
+    {
+        ThreadPool::setThreadBudget(2, {0});
+        ThreadPool::Job job(pool);
+        REQUIRE(ThreadPool::getThreadBudget() == 2);
+        REQUIRE(ThreadPool::getThreadCpus() == std::vector<unsigned int>({0}));
+        std::atomic<unsigned int> count(0);
+        {
+            ThreadPool::TaskGroup group(job);
+            for (unsigned int i = 0; i < 16; i++)
+            {
+                group.run([&]() { count++; });
+            }
+        }
+        REQUIRE(count == 16);
+        ThreadPool::setThreadBudget(0);
+    }
+}
@@ -0,0 +1,53 @@
+#include "../ThirdParty/catch.hpp"
+
+#include "../Utils/Trace.h"
+
+#include <thread>
+
+using namespace Loopring;
+
+TEST_CASE("Trace", "[Trace]")
+{
+    Trace &trace = Trace::get();
+
+    SECTION("Disabled")
+    {
+        TraceScope scope("witness", "stage");
+        REQUIRE(!trace.isEnabled());
+        REQUIRE(!scope.isActive());
+    }
+
+    SECTION("Session")
+    {
+        uint64_t start = trace.begin();
+        REQUIRE(trace.isEnabled());
+        {
+            TraceScope scope("transaction", "witness");
+            REQUIRE(scope.isActive());
+            scope.args["index"] = 3;
+        }
+        trace.add("prove", "stage", start, 10);
+        json result = trace.end(start);
+        REQUIRE(!trace.isEnabled());
+
+        const json &events = result["traceEvents"];
+        REQUIRE(events.size() == 2);
+        REQUIRE(events[0]["name"].get<std::string>() == "transaction");
+        REQUIRE(events[0]["ph"].get<std::string>() == "X");
+        REQUIRE(events[0]["args"]["index"].get<int>() == 3);
+        REQUIRE(events[1]["name"].get<std::string>() == "prove");
+        REQUIRE(events[1]["dur"].get<uint64_t>() == 10);
+    }
+
+    SECTION("Overlapping sessions")
+    {
+        uint64_t startA = trace.begin();
+        trace.add("a", "stage", startA, 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        uint64_t startB = trace.begin();
+        trace.add("b", "stage", startB, 1);
+        REQUIRE(trace.end(startA)["traceEvents"].size() == 2);
+        // Events from before the session are not included
+        REQUIRE(trace.end(startB)["traceEvents"].size() == 1);
+    }
+}
@@ -0,0 +1,59 @@
+#include "../ThirdParty/catch.hpp"
+
+#include "../Utils/Tuner.h"
+
+using namespace Loopring;
+
+TEST_CASE("Tuner", "[Tuner]")
+{
+    std::vector<TunerParameter> parameters = {{"threads", "total", 4}, {"c", "multiexp", 6}, {"fft", "fft", 3}};
+    // Separable costs with the best values at threads = 2, c = 4, fft = 1
+    auto getCosts = [](const Tuner::CandidateT &candidate) {
+        double threads = std::abs(double(candidate[0]) - 2.0);
+        double multiexp = 10.0 + threads + std::abs(double(candidate[1]) - 4.0);
+        double fft = 5.0 + threads + std::abs(double(candidate[2]) - 1.0);
+        TunerScores scores;
+        scores["multiexp"] = multiexp;
+        scores["fft"] = fft;
+        scores["total"] = multiexp + fft;
+        return scores;
+    };
+
+    SECTION("Finds the best candidate")
+    {
+        Tuner tuner(parameters, getCosts, 4);
+        Tuner::CandidateT best = tuner.run({0, 0, 0});
+        REQUIRE(best == Tuner::CandidateT({2, 4, 1}));
+        // Far fewer measurements than the full grid with 4 samples each
+        REQUIRE(tuner.getNumMeasurements() < 4 * 6 * 3 * 4);
+    }
+
+    SECTION("Robust against outliers")
+    {
+        unsigned int call = 0;
+        Tuner tuner(
+          parameters,
+          [&](const Tuner::CandidateT &candidate) {
+              TunerScores scores = getCosts(candidate);
+              // Every 5th measurement is disturbed
+              if (++call % 5 == 0)
+              {
+                  scores["total"] += 100.0;
+                  scores["multiexp"] += 100.0;
+                  scores["fft"] += 100.0;
+              }
+              return scores;
+          },
+          8);
+        Tuner::CandidateT best = tuner.run({0, 0, 0});
+        REQUIRE(best == Tuner::CandidateT({2, 4, 1}));
+        REQUIRE(tuner.getStats(best, "total").numSamples >= 1);
+    }
+
+    SECTION("Median")
+    {
+        REQUIRE(Tuner::median({}) == 0.0);
+        REQUIRE(Tuner::median({3.0, 1.0, 2.0}) == 2.0);
+        REQUIRE(Tuner::median({4.0, 1.0, 2.0, 3.0}) == 2.5);
+    }
+}
@@ -0,0 +1,126 @@
+#include "../ThirdParty/catch.hpp"
+#include "TestUtils.h"
+
+#include "../Circuits/UniversalCircuit.h"
+#include "../Utils/ConstraintChecker.h"
+
+#include <fstream>
+#include <sstream>
+
+TEST_CASE("Witness templates", "[UniversalCircuit]")
+{
+    Block block = getBlock();
+
+    protoboard<FieldT> pb;
+    UniversalCircuit circuit(pb, "circuit");
+    circuit.generateConstraints(block.transactions.size());
+    REQUIRE(circuit.generateWitness(block));
+
+    protoboard<FieldT> pbTemplates;
+    UniversalCircuit circuitTemplates(pbTemplates, "circuit");
+    circuitTemplates.generateConstraints(block.transactions.size());
+    circuitTemplates.enableWitnessTemplates();
+    for (const WitnessTemplateLayout &layout : circuitTemplates.transactions[0].templateLayouts)
+    {
+        REQUIRE(layout.valid);
+    }
+
+    SECTION("Same witness")
+    {
+        REQUIRE(circuitTemplates.generateWitness(block));
+        REQUIRE(pbTemplates.full_variable_assignment() == pb.full_variable_assignment());
+        REQUIRE(pbTemplates.is_satisfied());
+    }
+
+    SECTION("Cached witness")
+    {
+        // The second time all inactive transaction circuits are taken from the templates
+        REQUIRE(circuitTemplates.generateWitness(block));
+        REQUIRE(circuitTemplates.generateWitness(block));
+        REQUIRE(pbTemplates.full_variable_assignment() == pb.full_variable_assignment());
+        size_t hits = 0;
+        for (const WitnessTemplateCache &cache : circuitTemplates.templates->caches)
+        {
+            hits += cache.hits;
+        }
+        REQUIRE(hits > 0);
+    }
+}
+
+TEST_CASE("Streamed witness", "[UniversalCircuit]")
+{
+    Block block = getBlock();
+    std::string filename = string(TEST_DATA_PATH) + "block.json";
+
+    protoboard<FieldT> pb;
+    UniversalCircuit circuit(pb, "circuit");
+    circuit.generateConstraints(block.transactions.size());
+    REQUIRE(circuit.generateWitness(block));
+
+    protoboard<FieldT> pbStream;
+    UniversalCircuit circuitStream(pbStream, "circuit");
+    circuitStream.generateConstraints(block.transactions.size());
+
+    SECTION("Transactions before the header")
+    {
+        ifstream file(filename);
+        REQUIRE(circuitStream.generateWitness(file));
+        REQUIRE(pbStream.full_variable_assignment() == pb.full_variable_assignment());
+    }
+
+    SECTION("Header before the transactions")
+    {
+        ifstream file(filename);
+        json input;
+        file >> input;
+        // The keys are written in sorted order, so the transactions are written last
+        stringstream stream(input.dump());
+        REQUIRE(circuitStream.generateWitness(stream));
+        REQUIRE(pbStream.full_variable_assignment() == pb.full_variable_assignment());
+    }
+
+    SECTION("Invalid block size")
+    {
+        ifstream file(filename);
+        json input;
+        file >> input;
+        input["blockSize"] = block.transactions.size() + 1;
+        stringstream stream(input.dump());
+        REQUIRE(!circuitStream.generateWitness(stream));
+    }
+
+    SECTION("Incomplete block")
+    {
+        ifstream file(filename);
+        json input;
+        file >> input;
+        std::string data = input.dump();
+        stringstream stream(data.substr(0, data.size() / 2));
+        REQUIRE(!circuitStream.generateWitness(stream));
+    }
+}
+
+TEST_CASE("Invalid transaction", "[UniversalCircuit]")
+{
+    Block block = getBlock();
+    REQUIRE(block.transactions.size() > 1);
+
+    protoboard<FieldT> pb;
+    UniversalCircuit circuit(pb, "circuit");
+    circuit.generateConstraints(block.transactions.size());
+    REQUIRE(circuit.generateWitness(block));
+    REQUIRE(findUnsatisfiedConstraints(pb).size() == 0);
+    REQUIRE(circuit.describeConstraint(0) == "block");
+
+    // Break the type of the second transaction
+    const TransactionGadget &transaction = circuit.transactions[1];
+    pb.val(transaction.type.packed) += FieldT::one();
+    std::vector<size_t> failures = findUnsatisfiedConstraints(pb, 4);
+    REQUIRE(failures.size() > 0);
+    for (size_t index : failures)
+    {
+        REQUIRE(index >= transaction.constraintsBegin);
+        REQUIRE(index < transaction.constraintsEnd);
+        REQUIRE(circuit.describeConstraint(index).find("tx_1 (") == 0);
+    }
+}
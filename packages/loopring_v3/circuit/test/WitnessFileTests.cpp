@@ -0,0 +1,92 @@
+#include "../ThirdParty/catch.hpp"
+#include "TestUtils.h"
+
+#include "../Utils/MemoryStream.h"
+#include "../Utils/WitnessFile.h"
+
+#include <cstdio>
+#include <sstream>
+#include <unistd.h>
+
+TEST_CASE("WitnessFile", "[WitnessFile]")
+{
+    const std::string filename = "witness_file_test.wit";
+
+    protoboard<FieldT> pb;
+    addSquaresCircuit(pb, 100, 3);
+    const uint64_t fingerprint = WitnessFile::getFingerprint(pb);
+    REQUIRE(WitnessFile::write(pb, 1, 100, fingerprint, filename));
+    REQUIRE(WitnessFile::isWitnessFile(filename));
+
+    WitnessFileHeader header;
+    REQUIRE(WitnessFile::readHeader(filename, header));
+    REQUIRE(header.blockType == 1);
+    REQUIRE(header.blockSize == 100);
+    REQUIRE(header.fingerprint == fingerprint);
+    REQUIRE(header.numValues == pb.values.size());
+
+    SECTION("Same circuit")
+    {
+        // Same constraints, different witness
+        protoboard<FieldT> otherPb;
+        addSquaresCircuit(otherPb, 100, 0);
+        REQUIRE(WitnessFile::getFingerprint(otherPb) == fingerprint);
+        REQUIRE(WitnessFile::load(filename, fingerprint, otherPb));
+        REQUIRE(otherPb.values == pb.values);
+        REQUIRE(otherPb.is_satisfied());
+    }
+
+    SECTION("From memory")
+    {
+        std::ifstream file(filename, std::ios::binary);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        MemoryStream stream(std::make_shared<const std::string>(buffer.str()));
+        REQUIRE(WitnessFile::isWitnessFile(stream));
+
+        protoboard<FieldT> otherPb;
+        addSquaresCircuit(otherPb, 100, 0);
+        REQUIRE(WitnessFile::load(stream, fingerprint, otherPb));
+        REQUIRE(otherPb.values == pb.values);
+    }
+
+    SECTION("Different circuit")
+    {
+        protoboard<FieldT> otherPb;
+        addSquaresCircuit(otherPb, 101, 0);
+        const uint64_t otherFingerprint = WitnessFile::getFingerprint(otherPb);
+        REQUIRE(otherFingerprint != fingerprint);
+        REQUIRE(!WitnessFile::load(filename, otherFingerprint, otherPb));
+    }
+
+    SECTION("Different coefficients")
+    {
+        // Same variables in every constraint, the last constraint is x * x == 2 * y
+        protoboard<FieldT> otherPb;
+        addSquaresCircuit(otherPb, 99, 0);
+        pb_variable<FieldT> x = make_variable(otherPb, FieldT(99), "x");
+        pb_variable<FieldT> y = make_variable(otherPb, FieldT(99 * 99), "y");
+        otherPb.add_r1cs_constraint(ConstraintT(x, x, FieldT(2) * y), "x * x == 2 * y");
+        REQUIRE(WitnessFile::getFingerprint(otherPb) != fingerprint);
+    }
+
+    SECTION("Truncated file")
+    {
+        REQUIRE(truncate(filename.c_str(), sizeof(WitnessFileHeader) + sizeof(FieldT)) == 0);
+
+        protoboard<FieldT> otherPb;
+        addSquaresCircuit(otherPb, 100, 0);
+        REQUIRE(!WitnessFile::load(filename, fingerprint, otherPb));
+    }
+
+    SECTION("Not a witness file")
+    {
+        std::ofstream file(filename, std::ios::trunc);
+        file << "{}";
+        file.close();
+        REQUIRE(!WitnessFile::isWitnessFile(filename));
+        REQUIRE(!WitnessFile::readHeader(filename, header));
+    }
+
+    std::remove(filename.c_str());
+}
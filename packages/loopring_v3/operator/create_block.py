@@ -15,7 +15,11 @@ class Block(object):
 
     def toJSON(self):
         self.blockSize = len(self.transactions)
-        data = json.dumps(self, default=lambda o: o.__dict__, sort_keys=False, indent=4)
+        # Write the transactions last so the prover can already process them
+        # while the rest of the block is still being read
+        block = dict(self.__dict__)
+        block["transactions"] = block.pop("transactions")
+        data = json.dumps(block, default=lambda o: o.__dict__, sort_keys=False, indent=4)
         # Work around the reserved keyword "from" in python
         data = data.replace('"from_"','"from"')
         return data